@@ -33,13 +33,31 @@
 typedef enum {
     STATE_0,
     STATE_API,
+    STATE_BRANCHES,
+    /* VM cdrom branch */
     STATE_VM,
-    STATE_STORAGE_DOMAIN,
     STATE_VM_CDROM,
     STATE_CDROM_FILE,
-    STATE_ISOS
+    STATE_CDROM_DONE,
+    /* ISO list branch */
+    STATE_STORAGE_DOMAIN,
+    STATE_ISOS,
+    STATE_ISOS_DONE
 } OvirtForeignMenuState;
 
+/* Shared by the steps of ovirt_foreign_menu_fetch_iso_names_async(), some
+ * of which run in parallel */
+typedef struct {
+    /* number of branches which have not completed yet */
+    guint pending;
+    /* first error reported by a branch */
+    GError *error;
+    /* cancelled by the caller or when a branch fails */
+    GCancellable *cancellable;
+    GCancellable *caller_cancellable;
+    gulong cancelled_id;
+} FetchIsoNamesData;
+
 static void ovirt_foreign_menu_next_async_step(OvirtForeignMenu *menu, GTask *task, OvirtForeignMenuState state);
 static void ovirt_foreign_menu_fetch_api_async(OvirtForeignMenu *menu, GTask *task);
 static void ovirt_foreign_menu_fetch_vm_async(OvirtForeignMenu *menu, GTask *task);
@@ -278,15 +296,82 @@ OvirtForeignMenu* ovirt_foreign_menu_new(OvirtProxy *proxy)
 }
 
 
+static void
+fetch_iso_names_data_free(FetchIsoNamesData *data)
+{
+    g_clear_error(&data->error);
+    g_clear_object(&data->cancellable);
+    g_clear_object(&data->caller_cancellable);
+    g_free(data);
+}
+
+
+static void
+fetch_iso_names_cancelled(GCancellable *cancellable G_GNUC_UNUSED,
+                          FetchIsoNamesData *data)
+{
+    g_cancellable_cancel(data->cancellable);
+}
+
+
+static GCancellable *
+ovirt_foreign_menu_get_cancellable(GTask *task)
+{
+    FetchIsoNamesData *data = g_task_get_task_data(task);
+
+    return data->cancellable;
+}
+
+
+/* Called when a branch of the state machine completes, the task is returned
+ * once all of them did */
+static void
+ovirt_foreign_menu_branch_done(GTask *task, GError *error)
+{
+    OvirtForeignMenu *menu = OVIRT_FOREIGN_MENU(g_task_get_source_object(task));
+    FetchIsoNamesData *data = g_task_get_task_data(task);
+
+    if (error != NULL) {
+        if (data->error == NULL) {
+            data->error = error;
+            /* the other branch is useless now */
+            g_cancellable_cancel(data->cancellable);
+        } else {
+            g_error_free(error);
+        }
+    }
+
+    g_return_if_fail(data->pending > 0);
+    data->pending--;
+    if (data->pending == 0) {
+        if (data->caller_cancellable != NULL) {
+            g_cancellable_disconnect(data->caller_cancellable, data->cancelled_id);
+            data->cancelled_id = 0;
+        }
+        if (data->error != NULL) {
+            g_task_return_error(task, data->error);
+            data->error = NULL;
+        } else {
+            g_task_return_pointer(task, menu->priv->iso_names, NULL);
+        }
+    }
+    g_object_unref(task);
+}
+
+
 static void
 ovirt_foreign_menu_next_async_step(OvirtForeignMenu *menu,
                                    GTask *task,
                                    OvirtForeignMenuState current_state)
 {
+    FetchIsoNamesData *data = g_task_get_task_data(task);
+
     /* Each state will check if the member is initialized, falling directly to
      * the next one if so. If not, the callback for the asynchronous call will
      * be responsible for calling is function again with the next state as
      * argument.
+     * Once the API root is known, the VM cdrom and the ISO list do not depend
+     * on each other, they are fetched by 2 branches running in parallel.
      */
     switch (current_state + 1) {
     case STATE_API:
@@ -294,16 +379,18 @@ ovirt_foreign_menu_next_async_step(OvirtForeignMenu *menu,
             ovirt_foreign_menu_fetch_api_async(menu, task);
             break;
         }
+    case STATE_BRANCHES:
+        /* the task reference of the caller is used by the cdrom branch */
+        data->pending++;
+        g_object_ref(task);
+        ovirt_foreign_menu_next_async_step(menu, task, STATE_CDROM_DONE);
+        ovirt_foreign_menu_next_async_step(menu, task, STATE_BRANCHES);
+        break;
     case STATE_VM:
         if (menu->priv->vm == NULL) {
             ovirt_foreign_menu_fetch_vm_async(menu, task);
             break;
         }
-    case STATE_STORAGE_DOMAIN:
-        if (menu->priv->files == NULL) {
-            ovirt_foreign_menu_fetch_storage_domain_async(menu, task);
-            break;
-        }
     case STATE_VM_CDROM:
         if (menu->priv->cdrom == NULL) {
             ovirt_foreign_menu_fetch_vm_cdrom_async(menu, task);
@@ -312,19 +399,31 @@ ovirt_foreign_menu_next_async_step(OvirtForeignMenu *menu,
     case STATE_CDROM_FILE:
         ovirt_foreign_menu_refresh_cdrom_file_async(menu, task);
         break;
+    case STATE_CDROM_DONE:
+        g_warn_if_fail(menu->priv->vm != NULL);
+        g_warn_if_fail(menu->priv->cdrom != NULL);
+
+        ovirt_foreign_menu_branch_done(task, NULL);
+        break;
+    case STATE_STORAGE_DOMAIN:
+        if (menu->priv->files == NULL) {
+            ovirt_foreign_menu_fetch_storage_domain_async(menu, task);
+            break;
+        }
     case STATE_ISOS:
         g_warn_if_fail(menu->priv->api != NULL);
-        g_warn_if_fail(menu->priv->vm != NULL);
         g_warn_if_fail(menu->priv->files != NULL);
-        g_warn_if_fail(menu->priv->cdrom != NULL);
 
         ovirt_foreign_menu_fetch_iso_list_async(menu, task);
         break;
+    case STATE_ISOS_DONE:
+        ovirt_foreign_menu_branch_done(task, NULL);
+        break;
     default:
         g_warn_if_reached();
-        g_task_return_new_error(task, OVIRT_ERROR, OVIRT_ERROR_FAILED,
-                                "Invalid state: %d", current_state);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task,
+                                       g_error_new(OVIRT_ERROR, OVIRT_ERROR_FAILED,
+                                                   "Invalid state: %d", current_state));
     }
 }
 
@@ -336,6 +435,19 @@ ovirt_foreign_menu_fetch_iso_names_async(OvirtForeignMenu *menu,
                                          gpointer user_data)
 {
     GTask *task = g_task_new(menu, cancellable, callback, user_data);
+    FetchIsoNamesData *data = g_new0(FetchIsoNamesData, 1);
+
+    data->pending = 1;
+    data->cancellable = g_cancellable_new();
+    if (cancellable != NULL) {
+        data->caller_cancellable = g_object_ref(cancellable);
+        /* runs the handler right away if it is cancelled already */
+        data->cancelled_id = g_cancellable_connect(cancellable,
+                                                   G_CALLBACK(fetch_iso_names_cancelled),
+                                                   data, NULL);
+    }
+    g_task_set_task_data(task, data, (GDestroyNotify)fetch_iso_names_data_free);
+
     ovirt_foreign_menu_next_async_step(menu, task, STATE_0);
 }
 
@@ -449,9 +561,11 @@ static void ovirt_foreign_menu_set_files(OvirtForeignMenu *menu,
             g_free(name);
             continue;
         }
-        sorted_files = g_list_insert_sorted(sorted_files, name,
-                                            (GCompareFunc)g_strcmp0);
+        sorted_files = g_list_prepend(sorted_files, name);
     }
+    /* sorting once is much cheaper than inserting thousands of names in
+     * order */
+    sorted_files = g_list_sort(sorted_files, (GCompareFunc)g_strcmp0);
 
     for (it = sorted_files, it2 = menu->priv->iso_names;
          (it != NULL) && (it2 != NULL);
@@ -484,8 +598,7 @@ static void cdrom_file_refreshed_cb(GObject *source_object,
     ovirt_resource_refresh_finish(cdrom, result, &error);
     if (error != NULL) {
         g_warning("failed to refresh cdrom content: %s", error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
 
@@ -500,9 +613,9 @@ static void cdrom_file_refreshed_cb(GObject *source_object,
         ovirt_foreign_menu_next_async_step(menu, task, STATE_CDROM_FILE);
     } else {
         g_debug("Could not find VM cdrom through oVirt REST API");
-        g_task_return_new_error(task, OVIRT_ERROR, OVIRT_ERROR_FAILED,
-                                "Could not find VM cdrom through oVirt REST API");
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task,
+                                       g_error_new(OVIRT_ERROR, OVIRT_ERROR_FAILED,
+                                                   "Could not find VM cdrom through oVirt REST API"));
     }
 }
 
@@ -513,7 +626,7 @@ static void ovirt_foreign_menu_refresh_cdrom_file_async(OvirtForeignMenu *menu,
     g_return_if_fail(OVIRT_IS_RESOURCE(menu->priv->cdrom));
 
     ovirt_resource_refresh_async(OVIRT_RESOURCE(menu->priv->cdrom),
-                                 menu->priv->proxy, g_task_get_cancellable(task),
+                                 menu->priv->proxy, ovirt_foreign_menu_get_cancellable(task),
                                  cdrom_file_refreshed_cb, task);
 }
 
@@ -533,8 +646,7 @@ static void cdroms_fetched_cb(GObject *source_object,
     ovirt_collection_fetch_finish(cdrom_collection, result, &error);
     if (error != NULL) {
         g_warning("failed to fetch cdrom collection: %s", error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
 
@@ -559,9 +671,9 @@ static void cdroms_fetched_cb(GObject *source_object,
         ovirt_foreign_menu_next_async_step(menu, task, STATE_VM_CDROM);
     } else {
         g_debug("Could not find VM cdrom through oVirt REST API");
-        g_task_return_new_error(task, OVIRT_ERROR, OVIRT_ERROR_FAILED,
-                                "Could not find VM cdrom through oVirt REST API");
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task,
+                                       g_error_new(OVIRT_ERROR, OVIRT_ERROR_FAILED,
+                                                   "Could not find VM cdrom through oVirt REST API"));
     }
 }
 
@@ -573,7 +685,7 @@ static void ovirt_foreign_menu_fetch_vm_cdrom_async(OvirtForeignMenu *menu,
 
     cdrom_collection = ovirt_vm_get_cdroms(menu->priv->vm);
     ovirt_collection_fetch_async(cdrom_collection, menu->priv->proxy,
-                                 g_task_get_cancellable(task),
+                                 ovirt_foreign_menu_get_cancellable(task),
                                  cdroms_fetched_cb, task);
 }
 
@@ -592,8 +704,7 @@ static void storage_domains_fetched_cb(GObject *source_object,
     ovirt_collection_fetch_finish(collection, result, &error);
     if (error != NULL) {
         g_warning("failed to fetch storage domains: %s", error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
 
@@ -627,9 +738,9 @@ static void storage_domains_fetched_cb(GObject *source_object,
         ovirt_foreign_menu_next_async_step(menu, task, STATE_STORAGE_DOMAIN);
     } else {
         g_debug("Could not find iso file collection");
-        g_task_return_new_error(task, OVIRT_ERROR, OVIRT_ERROR_FAILED,
-                                "Could not find ISO file collection");
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task,
+                                       g_error_new(OVIRT_ERROR, OVIRT_ERROR_FAILED,
+                                                   "Could not find ISO file collection"));
     }
 }
 
@@ -641,7 +752,7 @@ static void ovirt_foreign_menu_fetch_storage_domain_async(OvirtForeignMenu *menu
 
     g_debug("Start fetching oVirt REST collection");
     ovirt_collection_fetch_async(collection, menu->priv->proxy,
-                                 g_task_get_cancellable(task),
+                                 ovirt_foreign_menu_get_cancellable(task),
                                  storage_domains_fetched_cb, task);
 }
 
@@ -660,8 +771,7 @@ static void vms_fetched_cb(GObject *source_object,
     ovirt_collection_fetch_finish(collection, result, &error);
     if (error != NULL) {
         g_debug("failed to fetch VM list: %s", error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
 
@@ -681,9 +791,9 @@ static void vms_fetched_cb(GObject *source_object,
         ovirt_foreign_menu_next_async_step(menu, task, STATE_VM);
     } else {
         g_warning("failed to find a VM with guid \"%s\"", menu->priv->vm_guid);
-        g_task_return_new_error(task, OVIRT_ERROR, OVIRT_ERROR_FAILED,
-                                "Could not find a VM with guid \"%s\"", menu->priv->vm_guid);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task,
+                                       g_error_new(OVIRT_ERROR, OVIRT_ERROR_FAILED,
+                                                   "Could not find a VM with guid \"%s\"", menu->priv->vm_guid));
     }
 }
 
@@ -699,7 +809,7 @@ static void ovirt_foreign_menu_fetch_vm_async(OvirtForeignMenu *menu,
 
     vms = ovirt_api_get_vms(menu->priv->api);
     ovirt_collection_fetch_async(vms, menu->priv->proxy,
-                                 g_task_get_cancellable(task),
+                                 ovirt_foreign_menu_get_cancellable(task),
                                  vms_fetched_cb, task);
 }
 
@@ -716,8 +826,7 @@ static void api_fetched_cb(GObject *source_object,
     menu->priv->api = ovirt_proxy_fetch_api_finish(proxy, result, &error);
     if (error != NULL) {
         g_debug("failed to fetch toplevel API object: %s", error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
     g_return_if_fail(OVIRT_IS_API(menu->priv->api));
@@ -736,7 +845,7 @@ static void ovirt_foreign_menu_fetch_api_async(OvirtForeignMenu *menu,
     g_return_if_fail(OVIRT_IS_PROXY(menu->priv->proxy));
 
     ovirt_proxy_fetch_api_async(menu->priv->proxy,
-                                g_task_get_cancellable(task),
+                                ovirt_foreign_menu_get_cancellable(task),
                                 api_fetched_cb, task);
 }
 
@@ -755,16 +864,14 @@ static void iso_list_fetched_cb(GObject *source_object,
     if (error != NULL) {
         g_warning("failed to fetch files for ISO storage domain: %s",
                    error->message);
-        g_task_return_error(task, error);
-        g_object_unref(task);
+        ovirt_foreign_menu_branch_done(task, error);
         return;
     }
 
     files = g_hash_table_get_values(ovirt_collection_get_resources(collection));
     ovirt_foreign_menu_set_files(menu, files);
     g_list_free(files);
-    g_task_return_pointer(task, menu->priv->iso_names, NULL);
-    g_object_unref(task);
+    ovirt_foreign_menu_next_async_step(menu, task, STATE_ISOS);
 }
 
 
@@ -776,7 +883,7 @@ static void ovirt_foreign_menu_fetch_iso_list_async(OvirtForeignMenu *menu,
     }
 
     ovirt_collection_fetch_async(menu->priv->files, menu->priv->proxy,
-                                 g_task_get_cancellable(task),
+                                 ovirt_foreign_menu_get_cancellable(task),
                                  iso_list_fetched_cb, task);
 }
 
@@ -24,14 +24,192 @@
 #include "virt-viewer-util.h"
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
+#include <errno.h>
+#include <unistd.h>
+
+/*
+ * While the dialog is open, the address being typed or selected is resolved
+ * and connected to in the background, so that pressing Connect only leaves
+ * the protocol handshake to do. The address must have settled for
+ * PRECONNECT_DELAY milliseconds, and an idle connection is dropped after
+ * PRECONNECT_TIMEOUT seconds.
+ */
+#define PRECONNECT_DELAY 500
+#define PRECONNECT_TIMEOUT 20
+
+typedef struct
+{
+    gchar *uri;
+    GCancellable *cancellable;
+    GSocketConnection *connection;
+    gboolean pending;
+    gboolean dropped;
+    guint timeout_id;
+} Preconnect;
 
 typedef struct
 {
     gboolean response;
     GMainLoop *loop;
     GtkWidget *entry;
+    GtkWidget *connect_button;
+    Preconnect *preconnect;
+    guint preconnect_delay_id;
 } ConnectionInfo;
 
+static void
+preconnect_free(Preconnect *pc)
+{
+    if (pc->timeout_id > 0)
+        g_source_remove(pc->timeout_id);
+    g_clear_object(&pc->connection);
+    g_clear_object(&pc->cancellable);
+    g_free(pc->uri);
+    g_free(pc);
+}
+
+static void
+preconnect_drop(Preconnect *pc)
+{
+    if (pc == NULL)
+        return;
+
+    g_debug("Dropping pre-connection to %s", pc->uri);
+    if (pc->pending) {
+        /* freed by preconnect_ready() */
+        pc->dropped = TRUE;
+        g_cancellable_cancel(pc->cancellable);
+        return;
+    }
+    preconnect_free(pc);
+}
+
+static gboolean
+preconnect_expired(gpointer data)
+{
+    Preconnect *pc = data;
+
+    g_debug("Pre-connection to %s unused, closing it", pc->uri);
+    pc->timeout_id = 0;
+    g_clear_object(&pc->connection);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+preconnect_ready(GObject *source, GAsyncResult *result, gpointer data)
+{
+    Preconnect *pc = data;
+    GError *error = NULL;
+
+    pc->pending = FALSE;
+    pc->connection = g_socket_client_connect_finish(G_SOCKET_CLIENT(source),
+                                                    result, &error);
+    if (pc->dropped) {
+        g_clear_error(&error);
+        preconnect_free(pc);
+        return;
+    }
+
+    if (pc->connection == NULL) {
+        g_debug("Pre-connection to %s failed: %s", pc->uri, error->message);
+        g_clear_error(&error);
+        return;
+    }
+
+    g_debug("Pre-connected to %s", pc->uri);
+    pc->timeout_id = g_timeout_add_seconds(PRECONNECT_TIMEOUT,
+                                           preconnect_expired, pc);
+}
+
+static void
+preconnect_start(ConnectionInfo *ci)
+{
+    GSocketConnectable *address;
+    GSocketClient *client;
+    Preconnect *pc;
+    gchar *uri, *scheme;
+
+    uri = g_strstrip(g_strdup(gtk_entry_get_text(GTK_ENTRY(ci->entry))));
+    if (ci->preconnect != NULL && g_str_equal(ci->preconnect->uri, uri) &&
+        (ci->preconnect->pending || ci->preconnect->connection != NULL)) {
+        g_free(uri);
+        return;
+    }
+    preconnect_drop(ci->preconnect);
+    ci->preconnect = NULL;
+
+    /* Only plain addresses with an explicit port are worth connecting to:
+     * files, tunnels and TLS-only addresses are set up by the session */
+    scheme = g_uri_parse_scheme(uri);
+    if (scheme == NULL ||
+        (g_ascii_strcasecmp(scheme, "spice") != 0 &&
+         g_ascii_strcasecmp(scheme, "vnc") != 0)) {
+        g_free(scheme);
+        g_free(uri);
+        return;
+    }
+    g_free(scheme);
+
+    address = g_network_address_parse_uri(uri, 0, NULL);
+    if (address == NULL ||
+        g_network_address_get_port(G_NETWORK_ADDRESS(address)) == 0) {
+        g_clear_object(&address);
+        g_free(uri);
+        return;
+    }
+
+    g_debug("Pre-connecting to %s", uri);
+    pc = g_new0(Preconnect, 1);
+    pc->uri = uri;
+    pc->cancellable = g_cancellable_new();
+    pc->pending = TRUE;
+    ci->preconnect = pc;
+
+    client = g_socket_client_new();
+    g_socket_client_connect_async(client, address, pc->cancellable,
+                                  preconnect_ready, pc);
+    g_object_unref(client);
+    g_object_unref(address);
+}
+
+static gboolean
+preconnect_delay_cb(gpointer data)
+{
+    ConnectionInfo *ci = data;
+
+    ci->preconnect_delay_id = 0;
+    preconnect_start(ci);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+preconnect_schedule(ConnectionInfo *ci, guint delay)
+{
+    if (ci->preconnect_delay_id > 0)
+        g_source_remove(ci->preconnect_delay_id);
+    ci->preconnect_delay_id = g_timeout_add(delay, preconnect_delay_cb, ci);
+}
+
+/* Returns a duplicate of the pre-connected socket if it leads to @uri */
+static int
+preconnect_steal_fd(ConnectionInfo *ci, const gchar *uri)
+{
+    Preconnect *pc = ci->preconnect;
+    int fd = -1;
+
+#ifndef G_OS_WIN32
+    if (pc != NULL && pc->connection != NULL && g_str_equal(pc->uri, uri)) {
+        GSocket *sock = g_socket_connection_get_socket(pc->connection);
+        fd = dup(g_socket_get_fd(sock));
+        if (fd < 0)
+            g_debug("Failed to duplicate pre-connected socket: %s",
+                    g_strerror(errno));
+    }
+#endif
+
+    return fd;
+}
+
 static void
 shutdown_loop(GMainLoop *loop)
 {
@@ -93,11 +271,12 @@ entry_icon_release_cb(GtkEntry* entry, gpointer data G_GNUC_UNUSED)
 static void
 entry_changed_cb(GtkEditable* entry, gpointer data)
 {
-    GtkButton *connect_button = data;
+    ConnectionInfo *ci = data;
     gboolean rtl = (gtk_widget_get_direction(GTK_WIDGET(entry)) == GTK_TEXT_DIR_RTL);
     gboolean active = (gtk_entry_get_text_length(GTK_ENTRY(entry)) > 0);
 
-    gtk_widget_set_sensitive(GTK_WIDGET(connect_button), active);
+    gtk_widget_set_sensitive(ci->connect_button, active);
+    preconnect_schedule(ci, PRECONNECT_DELAY);
 
     g_object_set(entry,
                  "secondary-icon-name", active ? (rtl ? "edit-clear-rtl-symbolic" : "edit-clear-symbolic") : NULL,
@@ -129,7 +308,7 @@ static void
 recent_selection_changed_dialog_cb(GtkRecentChooser *chooser, gpointer data)
 {
     GtkRecentInfo *info;
-    GtkWidget *entry = data;
+    ConnectionInfo *ci = data;
     const gchar *uri;
 
     info = gtk_recent_chooser_get_current_item(chooser);
@@ -139,7 +318,9 @@ recent_selection_changed_dialog_cb(GtkRecentChooser *chooser, gpointer data)
     uri = gtk_recent_info_get_uri(info);
     g_return_if_fail(uri != NULL);
 
-    gtk_entry_set_text(GTK_ENTRY(entry), uri);
+    gtk_entry_set_text(GTK_ENTRY(ci->entry), uri);
+    /* a recent entry is a deliberate choice, no need to wait */
+    preconnect_schedule(ci, 0);
 
     gtk_recent_info_unref(info);
 }
@@ -167,12 +348,14 @@ make_label_small(GtkLabel* label)
 * @brief Opens connect dialog for remote viewer
 *
 * @param uri For returning the uri of chosen server, must be NULL
+* @param fd For returning a socket already connected to the chosen server,
+*           or -1
 *
 * @return TRUE if Connect or ENTER is pressed
 * @return FALSE if Cancel is pressed or dialog is closed
 */
 gboolean
-remote_viewer_connect_dialog(gchar **uri)
+remote_viewer_connect_dialog(gchar **uri, int *fd)
 {
     GtkWidget *window, *label, *entry, *recent, *connect_button, *cancel_button;
     GtkRecentFilter *rfilter;
@@ -182,17 +365,21 @@ remote_viewer_connect_dialog(gchar **uri)
     ConnectionInfo ci = {
         FALSE,
         NULL,
-        NULL
+        NULL,
+        NULL,
+        NULL,
+        0
     };
 
     g_return_val_if_fail(uri && *uri == NULL, FALSE);
+    g_return_val_if_fail(fd != NULL, FALSE);
 
     /* Create the widgets */
     builder = virt_viewer_util_load_ui("remote-viewer-connect.ui");
     g_return_val_if_fail(builder != NULL, GTK_RESPONSE_NONE);
 
     window = GTK_WIDGET(gtk_builder_get_object(builder, "remote-viewer-connection-window"));
-    connect_button = GTK_WIDGET(gtk_builder_get_object(builder, "connect-button"));
+    connect_button = ci.connect_button = GTK_WIDGET(gtk_builder_get_object(builder, "connect-button"));
     cancel_button = GTK_WIDGET(gtk_builder_get_object(builder, "cancel-button"));
     label = GTK_WIDGET(gtk_builder_get_object(builder, "example-label"));
     entry = ci.entry = GTK_WIDGET(gtk_builder_get_object(builder, "connection-address-entry"));
@@ -225,12 +412,12 @@ remote_viewer_connect_dialog(gchar **uri)
     g_signal_connect(entry, "activate",
                      G_CALLBACK(entry_activated_cb), &ci);
     g_signal_connect(entry, "changed",
-                     G_CALLBACK(entry_changed_cb), connect_button);
+                     G_CALLBACK(entry_changed_cb), &ci);
     g_signal_connect(entry, "icon-release",
                      G_CALLBACK(entry_icon_release_cb), entry);
 
     g_signal_connect(recent, "selection-changed",
-                     G_CALLBACK(recent_selection_changed_dialog_cb), entry);
+                     G_CALLBACK(recent_selection_changed_dialog_cb), &ci);
     g_signal_connect(recent, "item-activated",
                      G_CALLBACK(recent_item_activated_dialog_cb), &ci);
     g_signal_connect(entry, "focus-in-event",
@@ -240,13 +427,19 @@ remote_viewer_connect_dialog(gchar **uri)
     gtk_widget_show_all(window);
 
     connect_dialog_run(&ci);
+    *fd = -1;
     if (ci.response == TRUE) {
         *uri = g_strdup(gtk_entry_get_text(GTK_ENTRY(entry)));
         g_strstrip(*uri);
+        *fd = preconnect_steal_fd(&ci, *uri);
     } else {
         *uri = NULL;
     }
 
+    if (ci.preconnect_delay_id > 0)
+        g_source_remove(ci.preconnect_delay_id);
+    preconnect_drop(ci.preconnect);
+
     g_object_unref(builder);
     gtk_widget_destroy(window);
 
@@ -23,7 +23,7 @@
 
 #include <gtk/gtk.h>
 
-gboolean remote_viewer_connect_dialog(gchar **uri);
+gboolean remote_viewer_connect_dialog(gchar **uri, int *fd);
 
 #endif /* REMOTE_VIEWER_CONNECT_H */
 
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include <glib/gi18n.h>
+#include <string.h>
 
 #include "remote-viewer-iso-list-dialog.h"
 #include "virt-viewer-util.h"
@@ -41,8 +42,14 @@ struct _RemoteViewerISOListDialogPrivate
     GtkWidget *spinner;
     GtkWidget *stack;
     GtkWidget *tree_view;
+    GtkTreeModelFilter *filter;
+    /* casefolded text typed in the search entry */
+    gchar *filter_text;
     OvirtForeignMenu *foreign_menu;
-    GCancellable *cancellable;
+    GCancellable *cancellable; /* current ISO change */
+    GCancellable *refresh_cancellable; /* ISO list refresh */
+    /* monotonic time at which the ISO list was requested */
+    gint64 fetch_start;
 };
 
 enum RemoteViewerISOListDialogModel
@@ -60,6 +67,7 @@ enum RemoteViewerISOListDialogProperties {
 
 void remote_viewer_iso_list_dialog_toggled(GtkCellRendererToggle *cell_renderer, gchar *path, gpointer user_data);
 void remote_viewer_iso_list_dialog_row_activated(GtkTreeView *view, GtkTreePath *path, GtkTreeViewColumn *col, gpointer user_data);
+void remote_viewer_iso_list_dialog_search_changed(GtkSearchEntry *entry, gpointer user_data);
 
 static void
 remote_viewer_iso_list_dialog_dispose(GObject *object)
@@ -67,7 +75,16 @@ remote_viewer_iso_list_dialog_dispose(GObject *object)
     RemoteViewerISOListDialog *self = REMOTE_VIEWER_ISO_LIST_DIALOG(object);
     RemoteViewerISOListDialogPrivate *priv = self->priv;
 
-    g_clear_object(&priv->cancellable);
+    /* the callbacks of the cancelled operations don't touch the dialog */
+    if (priv->cancellable) {
+        g_cancellable_cancel(priv->cancellable);
+        g_clear_object(&priv->cancellable);
+    }
+    if (priv->refresh_cancellable) {
+        g_cancellable_cancel(priv->refresh_cancellable);
+        g_clear_object(&priv->refresh_cancellable);
+    }
+    g_clear_pointer(&priv->filter_text, g_free);
 
     if (priv->foreign_menu) {
         g_signal_handlers_disconnect_by_data(priv->foreign_menu, object);
@@ -121,26 +138,97 @@ remote_viewer_iso_list_dialog_show_files(RemoteViewerISOListDialog *self)
 }
 
 static void
-remote_viewer_iso_list_dialog_foreach(char *name, RemoteViewerISOListDialog *self)
+remote_viewer_iso_list_dialog_select(RemoteViewerISOListDialog *self, gint position)
 {
     RemoteViewerISOListDialogPrivate *priv = self->priv;
-    gchar *current_iso = ovirt_foreign_menu_get_current_iso_name(self->priv->foreign_menu);
-    gboolean active = (g_strcmp0(current_iso, name) == 0);
-    gint weight = active ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL;
-    GtkTreeIter iter;
-
-    gtk_list_store_append(priv->list_store, &iter);
-    gtk_list_store_set(priv->list_store, &iter,
-                       ISO_IS_ACTIVE, active,
-                       ISO_NAME, name,
-                       FONT_WEIGHT, weight, -1);
+    GtkTreePath *child_path = gtk_tree_path_new_from_indices(position, -1);
+    GtkTreePath *path = gtk_tree_model_filter_convert_child_path_to_path(priv->filter, child_path);
 
-    if (active) {
-        GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(priv->list_store), &iter);
+    if (path != NULL) {
         gtk_tree_view_set_cursor(GTK_TREE_VIEW(priv->tree_view), path, NULL, FALSE);
         gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(priv->tree_view), path, NULL, TRUE, 0.5, 0.5);
         gtk_tree_path_free(path);
     }
+    gtk_tree_path_free(child_path);
+}
+
+/*
+ * Brings the list store in line with @iso_list. Both are sorted, so they
+ * are merged in a single pass and only the rows which changed are touched,
+ * ISO domains can hold thousands of images.
+ */
+static void
+remote_viewer_iso_list_dialog_update(RemoteViewerISOListDialog *self, GList *iso_list)
+{
+    RemoteViewerISOListDialogPrivate *priv = self->priv;
+    GtkTreeModel *model = GTK_TREE_MODEL(priv->list_store);
+    gchar *current_iso = ovirt_foreign_menu_get_current_iso_name(priv->foreign_menu);
+    GtkTreeIter iter;
+    gboolean valid = gtk_tree_model_get_iter_first(model, &iter);
+    gboolean initial = !valid;
+    gint position = 0;
+    gint active_position = -1;
+    GList *it = iso_list;
+
+    /* filling the store is much faster when no view watches it */
+    if (initial)
+        gtk_tree_view_set_model(GTK_TREE_VIEW(priv->tree_view), NULL);
+
+    while (valid || it != NULL) {
+        gchar *name = NULL;
+        gboolean active = FALSE;
+        gint cmp;
+
+        if (valid)
+            gtk_tree_model_get(model, &iter,
+                               ISO_IS_ACTIVE, &active,
+                               ISO_NAME, &name, -1);
+
+        if (!valid)
+            cmp = 1;
+        else if (it == NULL)
+            cmp = -1;
+        else
+            cmp = g_strcmp0(name, it->data);
+
+        if (cmp < 0) {
+            /* the image is gone */
+            valid = gtk_list_store_remove(priv->list_store, &iter);
+        } else if (cmp > 0) {
+            /* new image */
+            gboolean is_current = (g_strcmp0(current_iso, it->data) == 0);
+
+            gtk_list_store_insert_with_values(priv->list_store, NULL, position,
+                                              ISO_IS_ACTIVE, is_current,
+                                              ISO_NAME, it->data,
+                                              FONT_WEIGHT, is_current ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL,
+                                              -1);
+            if (is_current)
+                active_position = position;
+            position++;
+            it = it->next;
+        } else {
+            gboolean is_current = (g_strcmp0(current_iso, name) == 0);
+
+            if (active != is_current)
+                gtk_list_store_set(priv->list_store, &iter,
+                                   ISO_IS_ACTIVE, is_current,
+                                   FONT_WEIGHT, is_current ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL,
+                                   -1);
+            if (is_current)
+                active_position = position;
+            position++;
+            valid = gtk_tree_model_iter_next(model, &iter);
+            it = it->next;
+        }
+        g_free(name);
+    }
+
+    if (initial) {
+        gtk_tree_view_set_model(GTK_TREE_VIEW(priv->tree_view), GTK_TREE_MODEL(priv->filter));
+        if (active_position != -1)
+            remote_viewer_iso_list_dialog_select(self, active_position);
+    }
 
     g_free(current_iso);
 }
@@ -150,20 +238,28 @@ fetch_iso_names_cb(OvirtForeignMenu *foreign_menu,
                    GAsyncResult *result,
                    RemoteViewerISOListDialog *self)
 {
-    RemoteViewerISOListDialogPrivate *priv = self->priv;
+    RemoteViewerISOListDialogPrivate *priv;
     GError *error = NULL;
     GList *iso_list;
 
     iso_list = ovirt_foreign_menu_fetch_iso_names_finish(foreign_menu, result, &error);
 
+    /* the dialog may be gone already */
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_debug("Fetching ISO names cancelled");
+        goto end;
+    }
+
+    priv = self->priv;
+    g_debug("Fetching ISO names took %" G_GINT64_FORMAT " ms",
+            (g_get_monotonic_time() - priv->fetch_start) / 1000);
+    g_clear_object(&priv->refresh_cancellable);
+
     if (!iso_list) {
         const gchar *msg = error ? error->message : _("Failed to fetch CD names");
         gchar *markup = g_strdup_printf("<b>%s</b>", msg);
 
         g_debug("Error fetching ISO names: %s", msg);
-        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-            goto end;
-
         gtk_label_set_markup(GTK_LABEL(priv->status), markup);
         gtk_spinner_stop(GTK_SPINNER(priv->spinner));
         remote_viewer_iso_list_dialog_show_error(self, msg);
@@ -172,8 +268,7 @@ fetch_iso_names_cb(OvirtForeignMenu *foreign_menu,
         goto end;
     }
 
-    g_clear_object(&priv->cancellable);
-    g_list_foreach(iso_list, (GFunc) remote_viewer_iso_list_dialog_foreach, self);
+    remote_viewer_iso_list_dialog_update(self, iso_list);
     remote_viewer_iso_list_dialog_show_files(self);
 
 end:
@@ -186,11 +281,14 @@ remote_viewer_iso_list_dialog_refresh_iso_list(RemoteViewerISOListDialog *self)
 {
     RemoteViewerISOListDialogPrivate *priv = self->priv;
 
-    gtk_list_store_clear(priv->list_store);
-
-    priv->cancellable = g_cancellable_new();
+    if (priv->refresh_cancellable) {
+        g_cancellable_cancel(priv->refresh_cancellable);
+        g_object_unref(priv->refresh_cancellable);
+    }
+    priv->refresh_cancellable = g_cancellable_new();
+    priv->fetch_start = g_get_monotonic_time();
     ovirt_foreign_menu_fetch_iso_names_async(priv->foreign_menu,
-                                             priv->cancellable,
+                                             priv->refresh_cancellable,
                                              (GAsyncReadyCallback) fetch_iso_names_cb,
                                              self);
 }
@@ -204,7 +302,10 @@ remote_viewer_iso_list_dialog_response(GtkDialog *dialog,
     RemoteViewerISOListDialogPrivate *priv = self->priv;
 
     if (response_id != GTK_RESPONSE_NONE) {
-        g_cancellable_cancel(priv->cancellable);
+        if (priv->cancellable)
+            g_cancellable_cancel(priv->cancellable);
+        if (priv->refresh_cancellable)
+            g_cancellable_cancel(priv->refresh_cancellable);
         return;
     }
 
@@ -223,7 +324,7 @@ remote_viewer_iso_list_dialog_toggled(GtkCellRendererToggle *cell_renderer G_GNU
 {
     RemoteViewerISOListDialog *self = REMOTE_VIEWER_ISO_LIST_DIALOG(user_data);
     RemoteViewerISOListDialogPrivate *priv = self->priv;
-    GtkTreeModel *model = GTK_TREE_MODEL(priv->list_store);
+    GtkTreeModel *model = GTK_TREE_MODEL(priv->filter);
     GtkTreePath *tree_path = gtk_tree_path_new_from_string(path);
     GtkTreeIter iter;
     gboolean active;
@@ -238,6 +339,7 @@ remote_viewer_iso_list_dialog_toggled(GtkCellRendererToggle *cell_renderer G_GNU
     gtk_dialog_set_response_sensitive(GTK_DIALOG(self), GTK_RESPONSE_NONE, FALSE);
     gtk_widget_set_sensitive(priv->tree_view, FALSE);
 
+    g_clear_object(&priv->cancellable);
     priv->cancellable = g_cancellable_new();
     ovirt_foreign_menu_set_current_iso_name_async(priv->foreign_menu, active ? NULL : name,
                                                   priv->cancellable,
@@ -258,6 +360,43 @@ remote_viewer_iso_list_dialog_row_activated(GtkTreeView *view G_GNUC_UNUSED,
     g_free(path_str);
 }
 
+void
+remote_viewer_iso_list_dialog_search_changed(GtkSearchEntry *entry,
+                                             gpointer user_data)
+{
+    RemoteViewerISOListDialog *self = REMOTE_VIEWER_ISO_LIST_DIALOG(user_data);
+    RemoteViewerISOListDialogPrivate *priv = self->priv;
+    const gchar *text = gtk_entry_get_text(GTK_ENTRY(entry));
+
+    g_free(priv->filter_text);
+    priv->filter_text = (*text != '\0') ? g_utf8_casefold(text, -1) : NULL;
+    gtk_tree_model_filter_refilter(priv->filter);
+}
+
+static gboolean
+remote_viewer_iso_list_dialog_visible(GtkTreeModel *model,
+                                      GtkTreeIter *iter,
+                                      gpointer user_data)
+{
+    RemoteViewerISOListDialog *self = REMOTE_VIEWER_ISO_LIST_DIALOG(user_data);
+    gchar *name, *key;
+    gboolean visible;
+
+    if (self->priv->filter_text == NULL)
+        return TRUE;
+
+    gtk_tree_model_get(model, iter, ISO_NAME, &name, -1);
+    if (name == NULL)
+        return FALSE;
+
+    key = g_utf8_casefold(name, -1);
+    visible = (strstr(key, self->priv->filter_text) != NULL);
+    g_free(key);
+    g_free(name);
+
+    return visible;
+}
+
 static void
 remote_viewer_iso_list_dialog_init(RemoteViewerISOListDialog *self)
 {
@@ -265,6 +404,7 @@ remote_viewer_iso_list_dialog_init(RemoteViewerISOListDialog *self)
     RemoteViewerISOListDialogPrivate *priv = self->priv = DIALOG_PRIVATE(self);
     GtkBuilder *builder = virt_viewer_util_load_ui("remote-viewer-iso-list.ui");
     GtkCellRendererToggle *cell_renderer;
+    gint toggle_width;
 
     gtk_builder_connect_signals(builder, self);
 
@@ -274,11 +414,24 @@ remote_viewer_iso_list_dialog_init(RemoteViewerISOListDialog *self)
     gtk_box_pack_start(GTK_BOX(content), priv->stack, TRUE, TRUE, 0);
 
     priv->list_store = GTK_LIST_STORE(gtk_builder_get_object(builder, "liststore"));
+    priv->filter = GTK_TREE_MODEL_FILTER(gtk_builder_get_object(builder, "filter"));
+    gtk_tree_model_filter_set_visible_func(priv->filter,
+                                           remote_viewer_iso_list_dialog_visible,
+                                           self, NULL);
     priv->tree_view = GTK_WIDGET(gtk_builder_get_object(builder, "view"));
+    gtk_tree_view_set_search_entry(GTK_TREE_VIEW(priv->tree_view),
+                                   GTK_ENTRY(gtk_builder_get_object(builder, "search")));
     cell_renderer = GTK_CELL_RENDERER_TOGGLE(gtk_builder_get_object(builder, "cellrenderertoggle"));
     gtk_cell_renderer_toggle_set_radio(cell_renderer, TRUE);
     gtk_cell_renderer_set_padding(GTK_CELL_RENDERER(cell_renderer), 6, 6);
 
+    /* the rows all have the same height, which the view can then skip
+     * measuring, this requires fixed width columns */
+    gtk_cell_renderer_get_preferred_width(GTK_CELL_RENDERER(cell_renderer), priv->tree_view,
+                                          NULL, &toggle_width);
+    gtk_tree_view_column_set_fixed_width(GTK_TREE_VIEW_COLUMN(gtk_builder_get_object(builder, "selected_column")),
+                                         toggle_width);
+
     g_object_unref(builder);
 
     gtk_dialog_add_buttons(GTK_DIALOG(self),
@@ -313,8 +466,8 @@ ovirt_foreign_menu_iso_name_changed(OvirtForeignMenu *foreign_menu,
                                     GAsyncResult *result,
                                     RemoteViewerISOListDialog *self)
 {
-    RemoteViewerISOListDialogPrivate *priv = self->priv;
-    GtkTreeModel *model = GTK_TREE_MODEL(priv->list_store);
+    RemoteViewerISOListDialogPrivate *priv;
+    GtkTreeModel *model;
     gchar *current_iso;
     GtkTreeIter iter;
     gchar *name;
@@ -328,12 +481,15 @@ ovirt_foreign_menu_iso_name_changed(OvirtForeignMenu *foreign_menu,
         const gchar *msg = error ? error->message : _("Failed to change CD");
         g_debug("Error changing ISO: %s", msg);
 
+        /* the dialog may be gone already */
         if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
             goto end;
 
         remote_viewer_iso_list_dialog_show_error(self, msg);
     }
 
+    priv = self->priv;
+    model = GTK_TREE_MODEL(priv->list_store);
     g_clear_object(&priv->cancellable);
     if (!gtk_tree_model_get_iter_first(model, &iter))
         goto end;
@@ -373,6 +529,7 @@ remote_viewer_iso_list_dialog_new(GtkWindow *parent, GObject *foreign_menu)
 {
     GtkWidget *dialog;
     RemoteViewerISOListDialog *self;
+    GList *iso_names;
 
     g_return_val_if_fail(foreign_menu != NULL, NULL);
 
@@ -386,6 +543,15 @@ remote_viewer_iso_list_dialog_new(GtkWindow *parent, GObject *foreign_menu)
                           NULL);
 
     self = REMOTE_VIEWER_ISO_LIST_DIALOG(dialog);
+
+    /* show the names known from a previous opening right away, they are
+     * revalidated in the background */
+    iso_names = ovirt_foreign_menu_get_iso_names(self->priv->foreign_menu);
+    if (iso_names != NULL) {
+        remote_viewer_iso_list_dialog_update(self, iso_names);
+        remote_viewer_iso_list_dialog_show_files(self);
+        gtk_dialog_set_response_sensitive(GTK_DIALOG(self), GTK_RESPONSE_NONE, FALSE);
+    }
     remote_viewer_iso_list_dialog_refresh_iso_list(self);
     return dialog;
 }
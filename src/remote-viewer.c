@@ -28,6 +28,13 @@
 #include <glib/gprintf.h>
 #include <glib/gi18n.h>
 #include <libxml/uri.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef G_OS_UNIX
+#include <gio/gunixinputstream.h>
+#endif
 
 #ifdef HAVE_OVIRT
 #include <govirt/govirt.h>
@@ -55,10 +62,26 @@ struct _RemoteViewerPrivate {
 #endif
 #ifdef HAVE_OVIRT
     OvirtForeignMenu *ovirt_foreign_menu;
+    struct _OvirtConnect *ovirt_connect; /* ovirt:// URI being opened */
 #endif
     gboolean open_recent_dialog;
+
+    gboolean reconnect; /* --reconnect */
+    gboolean reconnectable; /* the session was connected once */
+    gchar *reconnect_uri;
+    gchar *reconnect_type;
+    VirtViewerFile *reconnect_file;
+    gboolean reconnect_streamed;
+    guint reconnect_attempt;
+    guint reconnect_id;
+
+    GCancellable *stream_cancellable; /* connection file being read */
 };
 
+/* Delays between reconnection attempts, in milliseconds */
+#define RECONNECT_DELAY_MIN 200
+#define RECONNECT_DELAY_MAX 30000
+
 G_DEFINE_TYPE (RemoteViewer, remote_viewer, VIRT_VIEWER_TYPE_APP)
 #define GET_PRIVATE(o)                                                        \
     (G_TYPE_INSTANCE_GET_PRIVATE ((o), REMOTE_VIEWER_TYPE, RemoteViewerPrivate))
@@ -75,9 +98,13 @@ static OvirtVm * choose_vm(GtkWindow *main_window,
                            char **vm_name,
                            OvirtCollection *vms,
                            GError **error);
+static void ovirt_connect_abandon(RemoteViewer *self);
 #endif
 
 static gboolean remote_viewer_start(VirtViewerApp *self, GError **error);
+static void remote_viewer_reconnect_connected(VirtViewerSession *session, RemoteViewer *self);
+static void remote_viewer_schedule_reconnect(RemoteViewer *self);
+static void remote_viewer_open_failed(RemoteViewer *self, GError *error);
 #ifdef HAVE_SPICE_GTK
 static gboolean remote_viewer_activate(VirtViewerApp *self, GError **error);
 static void remote_viewer_window_added(GtkApplication *app, GtkWindow *w);
@@ -88,10 +115,8 @@ static void foreign_menu_title_changed(SpiceCtrlForeignMenu *menu, GParamSpec *p
 static void
 remote_viewer_dispose (GObject *object)
 {
-#if defined(HAVE_SPICE_GTK) || defined(HAVE_OVIRT)
     RemoteViewer *self = REMOTE_VIEWER(object);
     RemoteViewerPrivate *priv = self->priv;
-#endif
 
 #ifdef HAVE_SPICE_GTK
     if (priv->controller) {
@@ -110,8 +135,22 @@ remote_viewer_dispose (GObject *object)
         g_object_unref(priv->ovirt_foreign_menu);
         priv->ovirt_foreign_menu = NULL;
     }
+    ovirt_connect_abandon(self);
 #endif
 
+    if (priv->reconnect_id != 0) {
+        g_source_remove(priv->reconnect_id);
+        priv->reconnect_id = 0;
+    }
+    g_clear_pointer(&priv->reconnect_uri, g_free);
+    g_clear_pointer(&priv->reconnect_type, g_free);
+    g_clear_object(&priv->reconnect_file);
+
+    if (priv->stream_cancellable != NULL) {
+        g_cancellable_cancel(priv->stream_cancellable);
+        g_clear_object(&priv->stream_cancellable);
+    }
+
     G_OBJECT_CLASS(remote_viewer_parent_class)->dispose (object);
 }
 
@@ -121,6 +160,13 @@ remote_viewer_deactivated(VirtViewerApp *app, gboolean connect_error)
     RemoteViewer *self = REMOTE_VIEWER(app);
     RemoteViewerPrivate *priv = self->priv;
 
+    /* --reconnect takes precedence over --kiosk-quit on-disconnect */
+    if (priv->reconnectable && !virt_viewer_app_get_session_cancelled(app)) {
+        virt_viewer_app_trace(app, "Guest display has disconnected, reconnecting");
+        remote_viewer_schedule_reconnect(self);
+        return;
+    }
+
     if (connect_error && priv->open_recent_dialog) {
         if (virt_viewer_app_start(app, NULL)) {
             return;
@@ -133,6 +179,9 @@ remote_viewer_deactivated(VirtViewerApp *app, gboolean connect_error)
 static gchar **opt_args = NULL;
 static char *opt_title = NULL;
 static gboolean opt_controller = FALSE;
+static gboolean opt_resident = FALSE;
+static gboolean opt_use_launcher = FALSE;
+static gboolean opt_reconnect = FALSE;
 
 static void
 remote_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOptionGroup *group)
@@ -144,6 +193,12 @@ remote_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, G
         { "spice-controller", '\0', 0, G_OPTION_ARG_NONE, &opt_controller,
           N_("Open connection using Spice controller communication"), NULL },
 #endif
+        { "resident", '\0', 0, G_OPTION_ARG_NONE, &opt_resident,
+          N_("Stay in the background and open the connections given with --use-launcher"), NULL },
+        { "use-launcher", '\0', 0, G_OPTION_ARG_NONE, &opt_use_launcher,
+          N_("Open the connection in the resident instance if one is running"), NULL },
+        { "reconnect", 'r', 0, G_OPTION_ARG_NONE, &opt_reconnect,
+          N_("Reconnect automatically when the connection is lost"), NULL },
         { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &opt_args,
           NULL, "URI|VV-FILE" },
         { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
@@ -158,6 +213,261 @@ remote_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, G
 #endif
 }
 
+/*
+ * Besides paths and URIs, the connection file may be given as "-" for
+ * standard input, as "fd:N" for a file descriptor inherited from the parent
+ * process, or as an http(s) URI, so that browsers can hand it over without
+ * writing it, and its ticket, to disk.
+ */
+static gboolean
+remote_viewer_is_file_stream(const gchar *location)
+{
+    gchar *scheme;
+    gboolean stream;
+
+    if (g_str_equal(location, "-") || g_str_has_prefix(location, "fd:"))
+        return TRUE;
+
+    scheme = g_uri_parse_scheme(location);
+    stream = scheme != NULL &&
+        (g_ascii_strcasecmp(scheme, "http") == 0 ||
+         g_ascii_strcasecmp(scheme, "https") == 0);
+    g_free(scheme);
+    return stream;
+}
+
+/* Seconds a connection file stream may take to reach end of file */
+#define FILE_STREAM_TIMEOUT 30
+
+typedef struct {
+    GCancellable *cancellable; /* cancelled by the caller or on timeout */
+    GCancellable *caller_cancellable;
+    gulong cancelled_id;
+    guint timeout_id;
+    gboolean timed_out;
+} FileStreamLoad;
+
+static void
+file_stream_load_free(FileStreamLoad *load)
+{
+    if (load->timeout_id != 0)
+        g_source_remove(load->timeout_id);
+    if (load->caller_cancellable != NULL) {
+        g_cancellable_disconnect(load->caller_cancellable, load->cancelled_id);
+        g_object_unref(load->caller_cancellable);
+    }
+    g_object_unref(load->cancellable);
+    g_free(load);
+}
+
+static void
+file_stream_caller_cancelled(GCancellable *caller G_GNUC_UNUSED, gpointer data)
+{
+    g_cancellable_cancel(data);
+}
+
+static gboolean
+file_stream_timeout(gpointer opaque)
+{
+    FileStreamLoad *load = opaque;
+
+    load->timeout_id = 0;
+    load->timed_out = TRUE;
+    g_cancellable_cancel(load->cancellable);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+file_stream_read_cb(GObject *source G_GNUC_UNUSED, GAsyncResult *result, gpointer opaque)
+{
+    GTask *task = opaque;
+    FileStreamLoad *load = g_task_get_task_data(task);
+    GError *error = NULL;
+    VirtViewerFile *vvfile = virt_viewer_file_new_from_stream_finish(result, &error);
+
+    if (vvfile != NULL) {
+        g_task_return_pointer(task, vvfile, g_object_unref);
+    } else if (load->timed_out) {
+        g_clear_error(&error);
+        g_task_return_new_error(task, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                _("Timed out after %d seconds"), FILE_STREAM_TIMEOUT);
+    } else {
+        g_task_return_error(task, error);
+    }
+    g_object_unref(task);
+}
+
+static void
+file_stream_read(GTask *task, GInputStream *stream)
+{
+    FileStreamLoad *load = g_task_get_task_data(task);
+
+    virt_viewer_file_new_from_stream_async(stream, load->cancellable,
+                                           file_stream_read_cb, task);
+}
+
+static void
+file_stream_opened_cb(GObject *source, GAsyncResult *result, gpointer opaque)
+{
+    GTask *task = opaque;
+    FileStreamLoad *load = g_task_get_task_data(task);
+    GError *error = NULL;
+    GFileInputStream *stream = g_file_read_finish(G_FILE(source), result, &error);
+
+    if (stream == NULL) {
+        if (load->timed_out) {
+            g_clear_error(&error);
+            g_task_return_new_error(task, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                    _("Timed out after %d seconds"), FILE_STREAM_TIMEOUT);
+        } else {
+            g_task_return_error(task, error);
+        }
+        g_object_unref(task);
+        return;
+    }
+
+    file_stream_read(task, G_INPUT_STREAM(stream));
+    g_object_unref(stream);
+}
+
+/*
+ * Reads the connection file given as a stream location from the main
+ * loop, the reading being given up after FILE_STREAM_TIMEOUT seconds, so
+ * that a stalled download or a pipe which is never closed does not hang
+ * the client.
+ */
+static void
+remote_viewer_file_load_async(const gchar *location,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data)
+{
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+    FileStreamLoad *load = g_new0(FileStreamLoad, 1);
+    GInputStream *stream = NULL;
+
+    load->cancellable = g_cancellable_new();
+    if (cancellable != NULL) {
+        load->caller_cancellable = g_object_ref(cancellable);
+        load->cancelled_id = g_cancellable_connect(cancellable,
+                                                   G_CALLBACK(file_stream_caller_cancelled),
+                                                   g_object_ref(load->cancellable),
+                                                   g_object_unref);
+    }
+    load->timeout_id = g_timeout_add_seconds(FILE_STREAM_TIMEOUT, file_stream_timeout, load);
+    g_task_set_task_data(task, load, (GDestroyNotify)file_stream_load_free);
+
+    if (g_str_equal(location, "-")) {
+#ifdef G_OS_UNIX
+        stream = g_unix_input_stream_new(STDIN_FILENO, FALSE);
+#endif
+    } else if (g_str_has_prefix(location, "fd:")) {
+#ifdef G_OS_UNIX
+        gchar *end;
+        gint64 fd = g_ascii_strtoll(location + 3, &end, 10);
+
+        if (end == location + 3 || *end != '\0' ||
+            fd < 0 || fd > G_MAXINT || fcntl(fd, F_GETFD) < 0) {
+            g_task_return_new_error(task, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                    _("Invalid file descriptor %s"), location + 3);
+            g_object_unref(task);
+            return;
+        }
+        stream = g_unix_input_stream_new(fd, TRUE);
+#endif
+    } else {
+        GFile *file = g_file_new_for_uri(location);
+
+        g_file_read_async(file, G_PRIORITY_DEFAULT, load->cancellable,
+                          file_stream_opened_cb, task);
+        g_object_unref(file);
+        return;
+    }
+
+    if (stream == NULL) {
+        g_task_return_new_error(task, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                _("Reading a connection file from %s is not supported on this platform"),
+                                location);
+        g_object_unref(task);
+        return;
+    }
+
+    file_stream_read(task, stream);
+    g_object_unref(stream);
+}
+
+static VirtViewerFile *
+remote_viewer_file_load_finish(GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static void
+remote_viewer_file_loaded_sync(GObject *source G_GNUC_UNUSED,
+                               GAsyncResult *result,
+                               gpointer opaque)
+{
+    GAsyncResult **ret = opaque;
+
+    *ret = g_object_ref(result);
+}
+
+/* Nothing is shown yet when the command line is parsed, waiting for the
+ * file is all there is to do, within FILE_STREAM_TIMEOUT */
+static VirtViewerFile *
+remote_viewer_file_load_sync(const gchar *location, GError **error)
+{
+    GAsyncResult *result = NULL;
+    VirtViewerFile *vvfile;
+
+    remote_viewer_file_load_async(location, NULL, remote_viewer_file_loaded_sync, &result);
+    while (result == NULL)
+        g_main_context_iteration(NULL, TRUE);
+
+    vvfile = remote_viewer_file_load_finish(result, error);
+    g_object_unref(result);
+    return vvfile;
+}
+
+/* With --dashboard or --load-test, every argument is a connection file */
+static gboolean
+remote_viewer_add_session_files(VirtViewerApp *app, gchar **files)
+{
+    int i;
+
+    if (files == NULL) {
+        g_printerr(_("\nError: at least one connection file is needed\n\n"));
+        return FALSE;
+    }
+
+    for (i = 0; files[i] != NULL; i++) {
+        GError *error = NULL;
+        VirtViewerFile *vvfile;
+        gchar *name;
+
+        if (remote_viewer_is_file_stream(files[i]))
+            vvfile = remote_viewer_file_load_sync(files[i], &error);
+        else
+            vvfile = virt_viewer_file_new(files[i], &error);
+
+        if (vvfile == NULL) {
+            g_printerr(_("\nError: invalid file %s: %s\n\n"), files[i], error->message);
+            g_clear_error(&error);
+            return FALSE;
+        }
+
+        name = g_path_get_basename(files[i]);
+        virt_viewer_app_add_session_file(app, name, vvfile);
+        g_free(name);
+        g_object_unref(vvfile);
+    }
+
+    return TRUE;
+}
+
 static gboolean
 remote_viewer_local_command_line (GApplication   *gapp,
                                   gchar        ***args,
@@ -166,12 +476,42 @@ remote_viewer_local_command_line (GApplication   *gapp,
     gboolean ret = FALSE;
     VirtViewerApp *app = VIRT_VIEWER_APP(gapp);
     RemoteViewer *self = REMOTE_VIEWER(app);
+    GError *error = NULL;
 
     ret = G_APPLICATION_CLASS(remote_viewer_parent_class)->local_command_line(gapp, args, status);
     if (ret)
         goto end;
 
-    if (!opt_args) {
+    if (opt_resident) {
+        if (opt_args || virt_viewer_app_get_multi_session(app)) {
+            g_printerr(_("\nError: --resident doesn't open any connection by itself\n\n"));
+            ret = TRUE;
+            *status = 1;
+        } else if (!virt_viewer_app_become_resident(app, &error)) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            ret = TRUE;
+            *status = 1;
+        }
+        goto end;
+    }
+
+    /* the launcher can't read our standard input or file descriptors */
+    if (opt_use_launcher && opt_args && g_strv_length(opt_args) == 1 &&
+        !virt_viewer_app_get_multi_session(app) &&
+        !remote_viewer_is_file_stream(opt_args[0]) &&
+        virt_viewer_app_open_in_launcher(app, opt_args[0])) {
+        ret = TRUE;
+        goto end;
+    }
+
+    if (virt_viewer_app_get_multi_session(app)) {
+        if (!remote_viewer_add_session_files(app, opt_args)) {
+            ret = TRUE;
+            *status = 1;
+            goto end;
+        }
+    } else if (!opt_args) {
         self->priv->open_recent_dialog = TRUE;
     } else {
         if (g_strv_length(opt_args) > 1) {
@@ -207,6 +547,12 @@ remote_viewer_local_command_line (GApplication   *gapp,
     if (opt_title && !opt_controller)
         g_object_set(app, "title", opt_title, NULL);
 
+    /* the Spice controller and the multi-session modes manage their own connections */
+    if (opt_reconnect && !opt_controller && !virt_viewer_app_get_multi_session(app)) {
+        self->priv->reconnect = TRUE;
+        virt_viewer_app_set_reconnect(app, TRUE);
+    }
+
 end:
     if (ret && *status)
         g_printerr(_("Run '%s --help' to see a full list of available command line options\n"), g_get_prgname());
@@ -812,162 +1158,368 @@ virt_viewer_app_set_ovirt_foreign_menu(VirtViewerApp *app,
     ovirt_foreign_menu_updated(self);
 }
 
-static gboolean
-create_ovirt_session(VirtViewerApp *app, const char *uri, GError **err)
-{
-    OvirtProxy *proxy = NULL;
-    OvirtApi *api = NULL;
+/*
+ * State of the REST calls made to open an ovirt:// URI. Each call completes
+ * in its own callback, so that the main loop keeps running and the main
+ * window shows the progress of each step.
+ */
+typedef struct _OvirtConnect {
+    RemoteViewer *self; /* NULL once the application went away */
+    VirtViewerFile *vvfile;
+    gboolean recent;
+    gchar *rest_uri;
+    gchar *vm_name;
+    gchar *username;
+    GKeyFile *cache;
+    gboolean use_cache;
+    OvirtProxy *proxy;
+    OvirtApi *api;
     OvirtCollection *vms;
-    OvirtVm *vm = NULL;
-    OvirtVmDisplay *display = NULL;
-    OvirtVmState state;
-    GError *error = NULL;
-    char *rest_uri = NULL;
-    char *vm_name = NULL;
-    char *username = NULL;
-    gboolean success = FALSE;
-    guint port;
-    guint secure_port;
-    char *proxy_url = NULL;
+    OvirtVm *vm;
+    OvirtVmDisplay *display;
     OvirtVmDisplayType type;
-    const char *session_type;
+    gchar *ghost;
+    gchar *gport;
+    gchar *gtlsport;
+    GError *error; /* found while the ticket was being requested */
+    GCancellable *cancellable;
+} OvirtConnect;
 
-    gchar *gport = NULL;
-    gchar *gtlsport = NULL;
-    gchar *ghost = NULL;
-    gchar *ticket = NULL;
-    gchar *host_subject = NULL;
-    gchar *guid = NULL;
+static gboolean remote_viewer_session_opened(RemoteViewer *self, VirtViewerFile *vvfile,
+                                             gboolean recent, GError **error);
 
-    g_return_val_if_fail(VIRT_VIEWER_IS_APP(app), FALSE);
+static void
+ovirt_connect_free(OvirtConnect *conn)
+{
+    g_clear_object(&conn->vvfile);
+    g_free(conn->rest_uri);
+    g_free(conn->vm_name);
+    g_free(conn->username);
+    if (conn->cache != NULL)
+        g_key_file_free(conn->cache);
+    g_clear_object(&conn->proxy);
+    g_clear_object(&conn->api);
+    g_clear_object(&conn->vms);
+    g_clear_object(&conn->vm);
+    g_clear_object(&conn->display);
+    g_free(conn->ghost);
+    g_free(conn->gport);
+    g_free(conn->gtlsport);
+    g_clear_error(&conn->error);
+    g_clear_object(&conn->cancellable);
+    g_free(conn);
+}
 
-    if (!parse_ovirt_uri(uri, &rest_uri, &vm_name, &username)) {
-        g_set_error_literal(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                            _("failed to parse ovirt uri"));
-        goto error;
+/*
+ * Fetches the VMs matching @query, or all of them if the oVirt library
+ * cannot search. Engines can have thousands of VMs, so downloading the
+ * whole collection is best avoided.
+ */
+static void
+ovirt_connect_fetch_vms(OvirtConnect *conn, const char *query,
+                        GAsyncReadyCallback callback)
+{
+#ifdef HAVE_OVIRT_SEARCH
+    g_debug("Searching oVirt VMs with '%s'", query);
+    conn->vms = ovirt_api_search_vms(conn->api, query);
+#else
+    conn->vms = g_object_ref(ovirt_api_get_vms(conn->api));
+#endif
+
+    ovirt_collection_fetch_async(conn->vms, conn->proxy, conn->cancellable,
+                                 callback, conn);
+}
+
+/* Builds the search for the VM named @name, quoted as it may hold spaces */
+static gchar *
+ovirt_search_name(const gchar *name)
+{
+    GString *query = g_string_new("name=\"");
+    const gchar *c;
+
+    for (c = name; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\')
+            g_string_append_c(query, '\\');
+        g_string_append_c(query, *c);
     }
+    g_string_append_c(query, '"');
 
-    proxy = ovirt_proxy_new(rest_uri);
-    g_object_set(proxy,
-                 "username", username,
-                 NULL);
-    ovirt_set_proxy_options(proxy);
-    g_signal_connect(G_OBJECT(proxy), "authenticate",
-                     G_CALLBACK(authenticate_cb), app);
+    return g_string_free(query, FALSE);
+}
 
-    api = ovirt_proxy_fetch_api(proxy, &error);
-    if (error != NULL) {
-        g_debug("failed to get oVirt 'api' collection: %s", error->message);
-#ifdef HAVE_OVIRT_CANCEL
-        if (g_error_matches(error, OVIRT_REST_CALL_ERROR, OVIRT_REST_CALL_ERROR_CANCELLED)) {
-            g_clear_error(&error);
-            g_set_error_literal(&error,
-                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
-                                _("Authentication was cancelled"));
-        }
-#endif
-        goto error;
+/*
+ * The engine details which are the same from one launch to the next are
+ * kept in a cache so that repeated connections can skip the CA download
+ * and the authentication round trips. Engines expire idle sessions after
+ * 30 minutes by default, older tokens are not worth trying.
+ */
+#define OVIRT_CACHE_SESSION_TTL (30 * 60)
+
+static gchar *
+ovirt_cache_get_filename(void)
+{
+    return g_build_filename(g_get_user_config_dir(),
+                            "virt-viewer", "ovirt-cache", NULL);
+}
+
+static GKeyFile *
+ovirt_cache_load(void)
+{
+    GKeyFile *cache = g_key_file_new();
+    gchar *filename = ovirt_cache_get_filename();
+    GError *error = NULL;
+
+    if (!g_key_file_load_from_file(cache, filename, G_KEY_FILE_NONE, &error)) {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_debug("Couldn't load oVirt cache %s: %s", filename, error->message);
+        g_clear_error(&error);
     }
-    vms = ovirt_api_get_vms(api);
-    ovirt_collection_fetch(vms, proxy, &error);
-    if (error != NULL) {
-        g_debug("failed to fetch oVirt 'vms' collection: %s", error->message);
-        goto error;
-    }
-    if (vm_name == NULL ||
-        (vm = OVIRT_VM(ovirt_collection_lookup_resource(vms, vm_name))) == NULL) {
-        VirtViewerWindow *main_window = virt_viewer_app_get_main_window(app);
-        vm = choose_vm(virt_viewer_window_get_window(main_window),
-                       &vm_name,
-                       vms,
-                       &error);
-        if (vm == NULL) {
-            goto error;
-        }
+    g_free(filename);
+
+    return cache;
+}
+
+/* The cache holds session tokens, it must only be readable by its owner */
+static void
+ovirt_cache_save(GKeyFile *cache)
+{
+    gchar *filename = ovirt_cache_get_filename();
+    gchar *tmp = g_strdup_printf("%s.XXXXXX", filename);
+    gchar *dir = g_path_get_dirname(filename);
+    gchar *data;
+    gsize length;
+    int fd;
+
+    if (g_mkdir_with_parents(dir, S_IRWXU) == -1) {
+        g_warning("failed to create config directory");
+        goto end;
     }
-    g_object_get(G_OBJECT(vm), "state", &state, NULL);
-    if (state != OVIRT_VM_STATE_UP) {
-        g_set_error(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                    _("oVirt VM %s is not running"), vm_name);
-        g_debug("%s", error->message);
-        goto error;
+
+    data = g_key_file_to_data(cache, &length, NULL);
+    fd = g_mkstemp_full(tmp, O_WRONLY, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        g_debug("Couldn't create %s: %s", tmp, g_strerror(errno));
+    } else if (write(fd, data, length) != (gssize)length) {
+        g_debug("Couldn't write %s: %s", tmp, g_strerror(errno));
+        close(fd);
+        g_unlink(tmp);
+    } else if (close(fd) == -1 || g_rename(tmp, filename) == -1) {
+        g_debug("Couldn't save oVirt cache %s: %s", filename, g_strerror(errno));
+        g_unlink(tmp);
+    }
+    g_free(data);
+
+end:
+    g_free(dir);
+    g_free(tmp);
+    g_free(filename);
+}
+
+/* The session properties only exist in recent libgovirt versions */
+static gboolean
+ovirt_proxy_has_property(OvirtProxy *proxy, const gchar *name)
+{
+    return g_object_class_find_property(G_OBJECT_GET_CLASS(proxy), name) != NULL;
+}
+
+static void
+ovirt_cache_restore(GKeyFile *cache, const gchar *rest_uri,
+                    const gchar *username, OvirtProxy *proxy)
+{
+    gchar *ca_str = g_key_file_get_string(cache, rest_uri, "ca-cert", NULL);
+    gchar *cached_username = g_key_file_get_string(cache, rest_uri, "username", NULL);
+    gint64 timestamp = g_key_file_get_int64(cache, rest_uri, "timestamp", NULL);
+
+    if (ca_str != NULL) {
+        GByteArray *ca = g_byte_array_new_take((guint8 *)ca_str, strlen(ca_str) + 1);
+
+        g_debug("Using cached CA certificate for %s", rest_uri);
+        g_object_set(G_OBJECT(proxy), "ca-cert", ca, NULL);
+        g_byte_array_unref(ca);
+    }
+
+    /* tokens are only reused for the user who got them */
+    if (g_strcmp0(cached_username, username) == 0 &&
+        g_get_real_time() / G_USEC_PER_SEC - timestamp < OVIRT_CACHE_SESSION_TTL) {
+        gchar *session_id = g_key_file_get_string(cache, rest_uri, "session-id", NULL);
+        gchar *sso_token = g_key_file_get_string(cache, rest_uri, "sso-token", NULL);
+
+        g_debug("Using cached oVirt session for %s", rest_uri);
+        if (session_id != NULL && ovirt_proxy_has_property(proxy, "session-id"))
+            g_object_set(G_OBJECT(proxy), "session-id", session_id, NULL);
+        if (sso_token != NULL && ovirt_proxy_has_property(proxy, "sso-token"))
+            g_object_set(G_OBJECT(proxy), "sso-token", sso_token, NULL);
+        g_free(session_id);
+        g_free(sso_token);
+    }
+
+    g_free(cached_username);
+}
+
+static void
+ovirt_cache_store(GKeyFile *cache, const gchar *rest_uri,
+                  const gchar *username, OvirtProxy *proxy)
+{
+    GByteArray *ca = NULL;
+    gchar *session_id = NULL;
+    gchar *sso_token = NULL;
+
+    g_key_file_remove_group(cache, rest_uri, NULL);
+
+    g_object_get(G_OBJECT(proxy), "ca-cert", &ca, NULL);
+    if (ovirt_proxy_has_property(proxy, "session-id"))
+        g_object_get(G_OBJECT(proxy), "session-id", &session_id, NULL);
+    if (ovirt_proxy_has_property(proxy, "sso-token"))
+        g_object_get(G_OBJECT(proxy), "sso-token", &sso_token, NULL);
+
+    if (ca != NULL) {
+        gchar *ca_str = g_strndup((const gchar *)ca->data, ca->len);
+        g_key_file_set_string(cache, rest_uri, "ca-cert", ca_str);
+        g_free(ca_str);
+        g_byte_array_unref(ca);
+    }
+    if (session_id != NULL || sso_token != NULL) {
+        if (username != NULL)
+            g_key_file_set_string(cache, rest_uri, "username", username);
+        if (session_id != NULL)
+            g_key_file_set_string(cache, rest_uri, "session-id", session_id);
+        if (sso_token != NULL)
+            g_key_file_set_string(cache, rest_uri, "sso-token", sso_token);
+        g_key_file_set_int64(cache, rest_uri, "timestamp",
+                             g_get_real_time() / G_USEC_PER_SEC);
     }
-    g_object_set(app, "guest-name", vm_name, NULL);
 
-    if (!ovirt_vm_get_ticket(vm, proxy, &error)) {
-        g_debug("failed to get ticket for %s: %s", vm_name, error->message);
-        goto error;
+    ovirt_cache_save(cache);
+
+    g_free(session_id);
+    g_free(sso_token);
+}
+
+/* The pending REST calls complete without reporting anything */
+static void
+ovirt_connect_abandon(RemoteViewer *self)
+{
+    OvirtConnect *conn = self->priv->ovirt_connect;
+
+    if (conn == NULL)
+        return;
+
+    conn->self = NULL;
+    g_cancellable_cancel(conn->cancellable);
+    self->priv->ovirt_connect = NULL;
+}
+
+/* Reports the outcome of opening an ovirt:// URI, and forgets @conn */
+static void
+ovirt_connect_done(OvirtConnect *conn, GError *error)
+{
+    RemoteViewer *self = conn->self;
+
+    self->priv->ovirt_connect = NULL;
+    if (error != NULL) {
+        g_prefix_error(&error, _("Couldn't open oVirt session: "));
+    } else {
+        remote_viewer_session_opened(self, conn->vvfile, conn->recent, &error);
     }
+    if (error != NULL)
+        remote_viewer_open_failed(self, error);
+
+    g_clear_error(&error);
+    ovirt_connect_free(conn);
+}
+
+/* Reads the display details of the VM, while its ticket is requested */
+static gboolean
+ovirt_connect_check_display(OvirtConnect *conn, GError **error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(conn->self);
+    gchar *guid = NULL;
+    guint port;
+    guint secure_port;
 
-    g_object_get(G_OBJECT(vm), "display", &display, "guid", &guid, NULL);
-    if (display == NULL) {
-        g_set_error(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                    _("oVirt VM %s has no display"), vm_name);
-        goto error;
+    g_object_get(G_OBJECT(conn->vm), "display", &conn->display, "guid", &guid, NULL);
+    if (conn->display == NULL) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("oVirt VM %s has no display"), conn->vm_name);
+        g_free(guid);
+        return FALSE;
     }
 
     if (guid != NULL) {
         g_object_set(app, "uuid", guid, NULL);
+        g_free(guid);
     }
 
-    g_object_get(G_OBJECT(display),
-                 "type", &type,
-                 "address", &ghost,
+    g_object_get(G_OBJECT(conn->display),
+                 "type", &conn->type,
+                 "address", &conn->ghost,
                  "port", &port,
                  "secure-port", &secure_port,
-                 "ticket", &ticket,
-                 "host-subject", &host_subject,
-                 "proxy-url", &proxy_url,
                  NULL);
     if (port != 0) {
-        gport = g_strdup_printf("%d", port);
+        conn->gport = g_strdup_printf("%d", port);
     }
     if (secure_port != 0) {
-        gtlsport = g_strdup_printf("%d", secure_port);
+        conn->gtlsport = g_strdup_printf("%d", secure_port);
     }
 
-    if (ghost == NULL) {
-        g_set_error(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                    _("oVirt VM %s has no host information"), vm_name);
-        g_debug("%s", error->message);
-        goto error;
+    if (conn->ghost == NULL) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("oVirt VM %s has no host information"), conn->vm_name);
+        g_debug("%s", (*error)->message);
+        return FALSE;
     }
 
-    if (type == OVIRT_VM_DISPLAY_SPICE) {
-        session_type = "spice";
-    } else if (type == OVIRT_VM_DISPLAY_VNC) {
-        session_type = "vnc";
-    } else {
-        g_set_error(&error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                    _("oVirt VM %s has unknown display type: %d"), vm_name, type);
-        g_debug("%s", error->message);
-        goto error;
+    if (conn->type != OVIRT_VM_DISPLAY_SPICE && conn->type != OVIRT_VM_DISPLAY_VNC) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("oVirt VM %s has unknown display type: %d"), conn->vm_name, conn->type);
+        g_debug("%s", (*error)->message);
+        return FALSE;
     }
 
-    {
-        OvirtForeignMenu *ovirt_menu = ovirt_foreign_menu_new(proxy);
-        g_object_set(G_OBJECT(ovirt_menu), "api", api, "vm", vm, NULL);
-        virt_viewer_app_set_ovirt_foreign_menu(app, ovirt_menu);
-    }
+    return TRUE;
+}
+
+static gboolean
+ovirt_connect_create_session(OvirtConnect *conn, GError **error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(conn->self);
+    const char *session_type = conn->type == OVIRT_VM_DISPLAY_SPICE ? "spice" : "vnc";
+    OvirtForeignMenu *ovirt_menu;
+
+    ovirt_menu = ovirt_foreign_menu_new(conn->proxy);
+    g_object_set(G_OBJECT(ovirt_menu), "api", conn->api, "vm", conn->vm, NULL);
+    virt_viewer_app_set_ovirt_foreign_menu(app, ovirt_menu);
 
-    virt_viewer_app_set_connect_info(app, NULL, ghost, gport, gtlsport,
+    virt_viewer_app_set_connect_info(app, NULL, conn->ghost, conn->gport, conn->gtlsport,
                                      session_type, NULL, NULL, 0, NULL);
 
-    if (!virt_viewer_app_create_session(app, session_type, &error))
-        goto error;
+    if (!virt_viewer_app_create_session(app, session_type, error))
+        return FALSE;
 
 #ifdef HAVE_SPICE_GTK
-    if (type == OVIRT_VM_DISPLAY_SPICE) {
+    if (conn->type == OVIRT_VM_DISPLAY_SPICE) {
         SpiceSession *session;
         GByteArray *ca_cert;
-
-        session = remote_viewer_get_spice_session(REMOTE_VIEWER(app));
+        gchar *ticket = NULL;
+        gchar *host_subject = NULL;
+        gchar *proxy_url = NULL;
+
+        g_object_get(G_OBJECT(conn->display),
+                     "ticket", &ticket,
+                     "host-subject", &host_subject,
+                     "proxy-url", &proxy_url,
+                     NULL);
+        session = remote_viewer_get_spice_session(conn->self);
         g_object_set(G_OBJECT(session),
                      "password", ticket,
                      "cert-subject", host_subject,
                      "proxy", proxy_url,
                      NULL);
-        g_object_get(G_OBJECT(proxy), "ca-cert", &ca_cert, NULL);
+        g_free(ticket);
+        g_free(host_subject);
+        g_free(proxy_url);
+        g_object_get(G_OBJECT(conn->proxy), "ca-cert", &ca_cert, NULL);
         if (ca_cert != NULL) {
             g_object_set(G_OBJECT(session),
                     "ca", ca_cert,
@@ -977,30 +1529,248 @@ create_ovirt_session(VirtViewerApp *app, const char *uri, GError **err)
     }
 #endif
 
-    success = TRUE;
+    return TRUE;
+}
 
-error:
-    g_free(username);
-    g_free(rest_uri);
-    g_free(vm_name);
-    g_free(ticket);
-    g_free(gport);
-    g_free(gtlsport);
-    g_free(ghost);
-    g_free(host_subject);
-    g_free(guid);
-    g_free(proxy_url);
+static void
+ovirt_connect_ticket_cb(GObject *source G_GNUC_UNUSED,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+    OvirtConnect *conn = user_data;
+    GError *error = NULL;
 
-    if (error != NULL)
-        g_propagate_error(err, error);
-    if (display != NULL)
-        g_object_unref(display);
-    if (vm != NULL)
-        g_object_unref(vm);
-    if (proxy != NULL)
-        g_object_unref(proxy);
+    if (conn->self == NULL) {
+        ovirt_connect_free(conn);
+        return;
+    }
 
-    return success;
+    /* the request was cancelled because the display is not usable */
+    if (conn->error != NULL) {
+        error = conn->error;
+        conn->error = NULL;
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    if (!ovirt_vm_get_ticket_finish(conn->vm, result, &error)) {
+        g_debug("failed to get ticket for %s: %s", conn->vm_name, error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    ovirt_connect_create_session(conn, &error);
+    ovirt_connect_done(conn, error);
+}
+
+static void
+ovirt_connect_vm_found(OvirtConnect *conn)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(conn->self);
+    OvirtVmState state;
+
+    g_object_get(G_OBJECT(conn->vm), "state", &state, NULL);
+    if (state != OVIRT_VM_STATE_UP) {
+        GError *error = g_error_new(VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                    _("oVirt VM %s is not running"), conn->vm_name);
+        g_debug("%s", error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+    g_object_set(app, "guest-name", conn->vm_name, NULL);
+
+    /* the display details are already known, check them while the ticket
+     * is being requested */
+    virt_viewer_app_show_status(app, _("Requesting a ticket for oVirt VM %s..."), conn->vm_name);
+    ovirt_vm_get_ticket_async(conn->vm, conn->proxy, conn->cancellable,
+                              ovirt_connect_ticket_cb, conn);
+    if (!ovirt_connect_check_display(conn, &conn->error))
+        g_cancellable_cancel(conn->cancellable);
+}
+
+static void
+ovirt_connect_vm_cb(GObject *source G_GNUC_UNUSED,
+                    GAsyncResult *result,
+                    gpointer user_data)
+{
+    OvirtConnect *conn = user_data;
+    GError *error = NULL;
+
+    if (conn->self == NULL) {
+        ovirt_connect_free(conn);
+        return;
+    }
+
+    if (!ovirt_collection_fetch_finish(conn->vms, result, &error)) {
+        g_debug("failed to fetch oVirt 'vms' collection: %s", error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    conn->vm = OVIRT_VM(ovirt_collection_lookup_resource(conn->vms, conn->vm_name));
+    if (conn->vm == NULL) {
+        error = g_error_new(VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("oVirt VM %s not found"), conn->vm_name);
+        g_debug("%s", error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    ovirt_connect_vm_found(conn);
+}
+
+static void
+ovirt_connect_vms_cb(GObject *source G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer user_data)
+{
+    OvirtConnect *conn = user_data;
+    VirtViewerWindow *main_window;
+    GError *error = NULL;
+
+    if (conn->self == NULL) {
+        ovirt_connect_free(conn);
+        return;
+    }
+
+    if (!ovirt_collection_fetch_finish(conn->vms, result, &error)) {
+        g_debug("failed to fetch oVirt 'vms' collection: %s", error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    /* only the running VMs can be chosen */
+    main_window = virt_viewer_app_get_main_window(VIRT_VIEWER_APP(conn->self));
+    conn->vm = choose_vm(virt_viewer_window_get_window(main_window),
+                         &conn->vm_name,
+                         conn->vms,
+                         &error);
+    if (conn->vm == NULL) {
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    ovirt_connect_vm_found(conn);
+}
+
+static void ovirt_connect_fetch_api(OvirtConnect *conn);
+
+static void
+ovirt_connect_api_cb(GObject *source G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer user_data)
+{
+    OvirtConnect *conn = user_data;
+    VirtViewerApp *app;
+    GError *error = NULL;
+
+    if (conn->self == NULL) {
+        ovirt_connect_free(conn);
+        return;
+    }
+
+    conn->api = ovirt_proxy_fetch_api_finish(conn->proxy, result, &error);
+    if (conn->api == NULL) {
+#ifdef HAVE_OVIRT_CANCEL
+        /* the user gave up, don't ask again */
+        if (g_error_matches(error, OVIRT_REST_CALL_ERROR, OVIRT_REST_CALL_ERROR_CANCELLED)) {
+            g_clear_error(&error);
+            g_set_error_literal(&error,
+                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
+                                _("Authentication was cancelled"));
+            ovirt_connect_done(conn, error);
+            return;
+        }
+#endif
+        if (conn->use_cache) {
+            g_debug("Connection with the cached oVirt state failed: %s", error->message);
+            g_clear_error(&error);
+            g_clear_object(&conn->proxy);
+            g_key_file_remove_group(conn->cache, conn->rest_uri, NULL);
+            ovirt_cache_save(conn->cache);
+            conn->use_cache = FALSE;
+            ovirt_connect_fetch_api(conn);
+            return;
+        }
+        g_debug("failed to get oVirt 'api' collection: %s", error->message);
+        ovirt_connect_done(conn, error);
+        return;
+    }
+
+    ovirt_cache_store(conn->cache, conn->rest_uri, conn->username, conn->proxy);
+
+    app = VIRT_VIEWER_APP(conn->self);
+    if (conn->vm_name != NULL) {
+        gchar *query = ovirt_search_name(conn->vm_name);
+
+        virt_viewer_app_show_status(app, _("Looking up oVirt VM %s..."), conn->vm_name);
+        ovirt_connect_fetch_vms(conn, query, ovirt_connect_vm_cb);
+        g_free(query);
+    } else {
+        virt_viewer_app_show_status(app, _("Looking up the running oVirt VMs..."));
+        ovirt_connect_fetch_vms(conn, "status=up", ovirt_connect_vms_cb);
+    }
+}
+
+/*
+ * Creates the REST proxy and fetches the API root. The cached state for the
+ * engine is tried first, if the engine rejects it the connection is retried
+ * with a full handshake.
+ */
+static void
+ovirt_connect_fetch_api(OvirtConnect *conn)
+{
+    conn->proxy = ovirt_proxy_new(conn->rest_uri);
+    g_object_set(conn->proxy,
+                 "username", conn->username,
+                 NULL);
+    /* the options given explicitly, such as the CA file, override the
+     * cached state */
+    if (conn->use_cache)
+        ovirt_cache_restore(conn->cache, conn->rest_uri, conn->username, conn->proxy);
+    ovirt_set_proxy_options(conn->proxy);
+    g_signal_connect(G_OBJECT(conn->proxy), "authenticate",
+                     G_CALLBACK(authenticate_cb), conn->self);
+
+    ovirt_proxy_fetch_api_async(conn->proxy, conn->cancellable,
+                                ovirt_connect_api_cb, conn);
+}
+
+/*
+ * Starts opening the ovirt:// @uri, the session is created and connected
+ * once the REST calls complete, see ovirt_connect_done(). A connection
+ * being opened is abandoned by ovirt_connect_abandon().
+ */
+static gboolean
+ovirt_connect_start(RemoteViewer *self, const char *uri, VirtViewerFile *vvfile,
+                    gboolean recent, GError **error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    OvirtConnect *conn = g_new0(OvirtConnect, 1);
+
+    if (!parse_ovirt_uri(uri, &conn->rest_uri, &conn->vm_name, &conn->username)) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("failed to parse ovirt uri"));
+        ovirt_connect_free(conn);
+        return FALSE;
+    }
+
+    conn->self = self;
+    conn->vvfile = vvfile ? g_object_ref(vvfile) : NULL;
+    conn->recent = recent;
+    conn->cache = ovirt_cache_load();
+    conn->use_cache = g_key_file_has_group(conn->cache, conn->rest_uri);
+    conn->cancellable = g_cancellable_new();
+    ovirt_connect_abandon(self);
+    self->priv->ovirt_connect = conn;
+
+    /* the REST calls can take a while, show their progress */
+    virt_viewer_window_show(virt_viewer_app_get_main_window(app));
+    virt_viewer_app_show_status(app, _("Connecting to the oVirt engine..."));
+
+    ovirt_connect_fetch_api(conn);
+
+    return TRUE;
 }
 
 static OvirtVm *
@@ -1074,116 +1844,318 @@ remote_viewer_session_connected(VirtViewerSession *session,
     g_free(uri);
 }
 
+/*
+ * Connects the session just created for @vvfile, the connection file it
+ * was opened from if any. @recent adds it to the recently used ones once
+ * connected.
+ */
 static gboolean
-remote_viewer_start(VirtViewerApp *app, GError **err)
+remote_viewer_session_opened(RemoteViewer *self, VirtViewerFile *vvfile,
+                             gboolean recent, GError **error)
 {
-    g_return_val_if_fail(REMOTE_VIEWER_IS(app), FALSE);
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *err = NULL;
 
-    RemoteViewer *self = REMOTE_VIEWER(app);
+    if (self->priv->reconnect)
+        g_signal_connect(virt_viewer_app_get_session(app), "session-connected",
+                         G_CALLBACK(remote_viewer_reconnect_connected), self);
+    if (recent)
+        g_signal_connect(virt_viewer_app_get_session(app), "session-connected",
+                         G_CALLBACK(remote_viewer_session_connected), app);
+
+    virt_viewer_session_set_file(virt_viewer_app_get_session(app), vvfile);
+#ifdef HAVE_OVIRT
+    if (vvfile != NULL) {
+        OvirtForeignMenu *ovirt_menu;
+        ovirt_menu = ovirt_foreign_menu_new_from_file(vvfile);
+        if (ovirt_menu != NULL) {
+            virt_viewer_app_set_ovirt_foreign_menu(app, ovirt_menu);
+        }
+    }
+#endif
+
+    if (!virt_viewer_app_initial_connect(app, &err)) {
+        if (err == NULL) {
+            g_set_error_literal(&err,
+                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                _("Failed to initiate connection"));
+        }
+        g_propagate_error(error, err);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Creates the session of @type for @guri, @vvfile being the connection file
+ * @guri refers to if any, and starts connecting it. An oVirt session is
+ * only created once the engine answered, a failure is then reported by
+ * remote_viewer_open_failed().
+ */
+static gboolean
+remote_viewer_open_session(RemoteViewer *self, const gchar *guri, const gchar *type,
+                           VirtViewerFile *vvfile, int *preconnected_fd,
+                           gboolean recent, GError **error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *err = NULL;
+
+#ifdef HAVE_OVIRT
+    if (g_strcmp0(type, "ovirt") == 0) {
+        if (!ovirt_connect_start(self, guri, vvfile, recent, &err)) {
+            g_prefix_error(&err, _("Couldn't open oVirt session: "));
+            g_propagate_error(error, err);
+            return FALSE;
+        }
+        return TRUE;
+    }
+#endif
+
+    if (!virt_viewer_app_create_session(app, type, error))
+        return FALSE;
+    if (preconnected_fd != NULL && *preconnected_fd >= 0) {
+        virt_viewer_session_set_preconnected_fd(virt_viewer_app_get_session(app),
+                                                *preconnected_fd);
+        *preconnected_fd = -1;
+    }
+
+    return remote_viewer_session_opened(self, vvfile, recent, error);
+}
+
+/*
+ * With --reconnect, a session that was connected once is opened again when
+ * it drops, after a delay that doubles with each failed attempt, from
+ * RECONNECT_DELAY_MIN up to RECONNECT_DELAY_MAX milliseconds, and is
+ * randomized so that the clients of a restarted server don't all come back
+ * at once. The windows are kept meanwhile, see virt_viewer_app_set_reconnect().
+ */
+static void
+remote_viewer_reconnect_connected(VirtViewerSession *session G_GNUC_UNUSED,
+                                  RemoteViewer *self)
+{
+    if (self->priv->reconnect_attempt > 0)
+        g_debug("Reconnected after %u attempts", self->priv->reconnect_attempt);
+    self->priv->reconnect_attempt = 0;
+    self->priv->reconnectable = TRUE;
+}
+
+static guint
+remote_viewer_reconnect_delay(guint attempt)
+{
+    guint delay = RECONNECT_DELAY_MAX;
+
+    if (attempt < 16)
+        delay = MIN(RECONNECT_DELAY_MIN << attempt, RECONNECT_DELAY_MAX);
+
+    return g_random_int_range(delay / 2, delay + 1);
+}
+
+/* Connection files given as a path are read again, a broker may have
+ * refreshed their ticket */
+static VirtViewerFile *
+remote_viewer_reconnect_file(RemoteViewer *self)
+{
     RemoteViewerPrivate *priv = self->priv;
-    GFile *file = NULL;
     VirtViewerFile *vvfile = NULL;
-    gboolean ret = FALSE;
-    gchar *guri = NULL;
-    gchar *type = NULL;
     GError *error = NULL;
+    GFile *file;
 
-#ifdef HAVE_SPICE_GTK
-    g_signal_connect(app, "notify", G_CALLBACK(app_notified), self);
+    if (priv->reconnect_file == NULL || priv->reconnect_streamed)
+        return priv->reconnect_file ? g_object_ref(priv->reconnect_file) : NULL;
 
-    if (priv->controller) {
-        if (!virt_viewer_app_create_session(app, "spice", &error)) {
-            g_debug("Couldn't create a Spice session");
-            goto cleanup;
+    file = g_file_new_for_commandline_arg(priv->reconnect_uri);
+    if (g_file_query_exists(file, NULL)) {
+        gchar *path = g_file_get_path(file);
+        vvfile = virt_viewer_file_new(path, &error);
+        if (vvfile == NULL) {
+            g_debug("Couldn't read %s again: %s", path, error->message);
+            g_clear_error(&error);
         }
+        g_free(path);
+    }
+    g_object_unref(file);
 
-        g_signal_connect(priv->controller, "notify", G_CALLBACK(spice_ctrl_notified), self);
-        g_signal_connect(priv->controller, "do_connect", G_CALLBACK(spice_ctrl_do_connect), self);
-        g_signal_connect(priv->controller, "show", G_CALLBACK(spice_ctrl_show), self);
-        g_signal_connect(priv->controller, "hide", G_CALLBACK(spice_ctrl_hide), self);
+    return vvfile != NULL ? vvfile : g_object_ref(priv->reconnect_file);
+}
 
-        spice_ctrl_controller_listen(priv->controller, NULL, spice_ctrl_listen_async_cb, self);
+static gboolean
+remote_viewer_reconnect_cb(gpointer opaque)
+{
+    RemoteViewer *self = opaque;
+    RemoteViewerPrivate *priv = self->priv;
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *error = NULL;
+    gboolean ok;
 
-        g_signal_connect(priv->ctrl_foreign_menu, "notify", G_CALLBACK(spice_ctrl_foreign_menu_notified), self);
-        spice_ctrl_foreign_menu_listen(priv->ctrl_foreign_menu, NULL, spice_ctrl_listen_async_cb, self);
+    priv->reconnect_id = 0;
+    priv->reconnect_attempt++;
+    g_debug("Reconnection attempt %u to %s", priv->reconnect_attempt, priv->reconnect_uri);
 
-        virt_viewer_app_show_status(VIRT_VIEWER_APP(self), _("Setting up Spice session..."));
+    /* a session whose connection failed to start is tried again as is */
+    if (virt_viewer_app_has_session(app)) {
+        ok = virt_viewer_app_initial_connect(app, &error);
     } else {
-#endif
+        VirtViewerFile *vvfile = remote_viewer_reconnect_file(self);
+
+        ok = remote_viewer_open_session(self, priv->reconnect_uri, priv->reconnect_type,
+                                        vvfile, NULL, FALSE, &error);
+        g_clear_object(&vvfile);
+    }
+
+    if (!ok) {
+        g_debug("Couldn't reconnect: %s", error ? error->message : "unknown error");
+        g_clear_error(&error);
+        remote_viewer_schedule_reconnect(self);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+remote_viewer_schedule_reconnect(RemoteViewer *self)
+{
+    RemoteViewerPrivate *priv = self->priv;
+    guint delay;
+
+    if (priv->reconnect_id != 0)
+        return;
+
+    delay = remote_viewer_reconnect_delay(priv->reconnect_attempt);
+    g_debug("Reconnecting in %u ms", delay);
+    virt_viewer_app_show_status(VIRT_VIEWER_APP(self),
+                                _("Connection to the graphic server lost, reconnecting..."));
+    priv->reconnect_id = g_timeout_add(delay, remote_viewer_reconnect_cb, self);
+}
+
+/* Keeps what --reconnect needs to open the session again */
+static void
+remote_viewer_remember_session(RemoteViewer *self, const gchar *guri, const gchar *type,
+                               VirtViewerFile *vvfile, gboolean streamed)
+{
+    RemoteViewerPrivate *priv = self->priv;
+
+    if (!priv->reconnect)
+        return;
+
+    g_free(priv->reconnect_uri);
+    priv->reconnect_uri = g_strdup(guri);
+    g_free(priv->reconnect_type);
+    priv->reconnect_type = g_strdup(type);
+    priv->reconnect_streamed = streamed;
+    g_clear_object(&priv->reconnect_file);
+    if (vvfile != NULL)
+        priv->reconnect_file = g_object_ref(vvfile);
+}
+
+static void
+remote_viewer_stream_loaded(GObject *source G_GNUC_UNUSED,
+                            GAsyncResult *result,
+                            gpointer opaque)
+{
+    RemoteViewer *self = opaque;
+    VirtViewerFile *vvfile;
+    GError *error = NULL;
+    gchar *guri = NULL;
+    gchar *type = NULL;
+
+    vvfile = remote_viewer_file_load_finish(result, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_clear_error(&error);
+        g_object_unref(self);
+        return;
+    }
+    g_clear_object(&self->priv->stream_cancellable);
+
+    g_object_get(self, "guri", &guri, NULL);
+    if (vvfile == NULL) {
+        g_prefix_error(&error, _("Invalid file %s: "), guri);
+        g_warning("%s", error->message);
+    } else {
+        g_object_get(G_OBJECT(vvfile), "type", &type, NULL);
+        /* a streamed file can't be opened again, and may hold a ticket */
+        if (remote_viewer_open_session(self, guri, type, vvfile, NULL, FALSE, &error))
+            remote_viewer_remember_session(self, guri, type, vvfile, TRUE);
+    }
+    if (error != NULL)
+        remote_viewer_open_failed(self, error);
+
+    g_clear_error(&error);
+    g_clear_object(&vvfile);
+    g_free(type);
+    g_free(guri);
+    g_object_unref(self);
+}
+
+/*
+ * Opens the URI given on the command line, or chosen in the connection
+ * dialog, which is shown again until a connection can be started. A
+ * connection file given as a stream is read asynchronously, a failure is
+ * then reported by remote_viewer_open_failed().
+ */
+static gboolean
+remote_viewer_open_guri(RemoteViewer *self, GError **err)
+{
+    RemoteViewerPrivate *priv = self->priv;
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GFile *file = NULL;
+    VirtViewerFile *vvfile = NULL;
+    gboolean ret = FALSE;
+    gchar *guri = NULL;
+    gchar *type = NULL;
+    GError *error = NULL;
+    int preconnected_fd = -1;
+
 retry_dialog:
-        if (priv->open_recent_dialog) {
-            if (!remote_viewer_connect_dialog(&guri)) {
-                g_set_error_literal(&error,
-                            VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
-                            _("No connection was chosen"));
-                g_propagate_error(err, error);
-                return FALSE;
-            }
-            g_object_set(app, "guri", guri, NULL);
-        } else
-            g_object_get(app, "guri", &guri, NULL);
-
-        g_return_val_if_fail(guri != NULL, FALSE);
-
-        g_debug("Opening display to %s", guri);
-
-        file = g_file_new_for_commandline_arg(guri);
-        if (g_file_query_exists(file, NULL)) {
-            gchar *path = g_file_get_path(file);
-            vvfile = virt_viewer_file_new(path, &error);
-            g_free(path);
-            if (error) {
-                g_prefix_error(&error, _("Invalid file %s: "), guri);
-                g_warning("%s", error->message);
-                goto cleanup;
-            }
-            g_object_get(G_OBJECT(vvfile), "type", &type, NULL);
-        } else if (virt_viewer_util_extract_host(guri, &type, NULL, NULL, NULL, NULL) < 0 || type == NULL) {
+    if (priv->open_recent_dialog) {
+        if (!remote_viewer_connect_dialog(&guri, &preconnected_fd)) {
             g_set_error_literal(&error,
-                                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                                _("Cannot determine the connection type from URI"));
-            goto cleanup;
-        }
-#ifdef HAVE_OVIRT
-        if (g_strcmp0(type, "ovirt") == 0) {
-            if (!create_ovirt_session(app, guri, &error)) {
-                g_prefix_error(&error, _("Couldn't open oVirt session: "));
-                goto cleanup;
-            }
-        } else
-#endif
-        {
-            if (!virt_viewer_app_create_session(app, type, &error))
-                goto cleanup;
+                        VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
+                        _("No connection was chosen"));
+            g_propagate_error(err, error);
+            return FALSE;
         }
+        g_object_set(app, "guri", guri, NULL);
+    } else
+        g_object_get(app, "guri", &guri, NULL);
 
-        g_signal_connect(virt_viewer_app_get_session(app), "session-connected",
-                         G_CALLBACK(remote_viewer_session_connected), app);
+    g_return_val_if_fail(guri != NULL, FALSE);
 
-        virt_viewer_session_set_file(virt_viewer_app_get_session(app), vvfile);
-#ifdef HAVE_OVIRT
-        if (vvfile != NULL) {
-            OvirtForeignMenu *ovirt_menu;
-            ovirt_menu = ovirt_foreign_menu_new_from_file(vvfile);
-            if (ovirt_menu != NULL) {
-                virt_viewer_app_set_ovirt_foreign_menu(app, ovirt_menu);
-            }
-        }
-#endif
+    g_debug("Opening display to %s", guri);
+
+    if (remote_viewer_is_file_stream(guri)) {
+        /* the session is opened once the file was read */
+        g_return_val_if_fail(priv->stream_cancellable == NULL, FALSE);
+        priv->stream_cancellable = g_cancellable_new();
+        remote_viewer_file_load_async(guri, priv->stream_cancellable,
+                                      remote_viewer_stream_loaded, g_object_ref(self));
+        ret = TRUE;
+        goto cleanup;
+    }
 
-        if (!virt_viewer_app_initial_connect(app, &error)) {
-            if (error == NULL) {
-                g_set_error_literal(&error,
-                                    VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                                    _("Failed to initiate connection"));
-            }
+    file = g_file_new_for_commandline_arg(guri);
+    if (g_file_query_exists(file, NULL)) {
+        gchar *path = g_file_get_path(file);
+        vvfile = virt_viewer_file_new(path, &error);
+        g_free(path);
+        if (error) {
+            g_prefix_error(&error, _("Invalid file %s: "), guri);
+            g_warning("%s", error->message);
             goto cleanup;
         }
-#ifdef HAVE_SPICE_GTK
+        g_object_get(G_OBJECT(vvfile), "type", &type, NULL);
+    } else if (virt_viewer_util_extract_host(guri, &type, NULL, NULL, NULL, NULL) < 0 || type == NULL) {
+        g_set_error_literal(&error,
+                            VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Cannot determine the connection type from URI"));
+        goto cleanup;
     }
-#endif
+    if (!remote_viewer_open_session(self, guri, type, vvfile, &preconnected_fd,
+                                    TRUE, &error))
+        goto cleanup;
 
-    ret = VIRT_VIEWER_APP_CLASS(remote_viewer_parent_class)->start(app, &error);
+    remote_viewer_remember_session(self, guri, type, vvfile, FALSE);
+    ret = TRUE;
 
 cleanup:
     g_clear_object(&file);
@@ -1192,6 +2164,10 @@ cleanup:
     guri = NULL;
     g_free(type);
     type = NULL;
+    if (preconnected_fd >= 0) {
+        close(preconnected_fd);
+        preconnected_fd = -1;
+    }
 
     if (!ret && priv->open_recent_dialog) {
         if (error != NULL) {
@@ -1206,6 +2182,77 @@ cleanup:
     return ret;
 }
 
+/*
+ * Handles a session which could not be opened once remote_viewer_start()
+ * returned: a reconnection is tried again later, otherwise the connection
+ * dialog is shown again, or the application quits.
+ */
+static void
+remote_viewer_open_failed(RemoteViewer *self, GError *error)
+{
+    VirtViewerApp *app = VIRT_VIEWER_APP(self);
+    GError *err = NULL;
+
+    if (self->priv->reconnect_attempt > 0) {
+        g_debug("Couldn't reconnect: %s", error->message);
+        remote_viewer_schedule_reconnect(self);
+        return;
+    }
+
+    if (!self->priv->open_recent_dialog) {
+        virt_viewer_app_start_failed(app, error);
+        return;
+    }
+
+    if (!g_error_matches(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED))
+        virt_viewer_app_simple_message_dialog(app, _("Unable to connect: %s"), error->message);
+    if (!remote_viewer_open_guri(self, &err)) {
+        virt_viewer_app_start_failed(app, err);
+        g_clear_error(&err);
+    }
+}
+
+static gboolean
+remote_viewer_start(VirtViewerApp *app, GError **err)
+{
+    g_return_val_if_fail(REMOTE_VIEWER_IS(app), FALSE);
+
+    RemoteViewer *self = REMOTE_VIEWER(app);
+#ifdef HAVE_SPICE_GTK
+    RemoteViewerPrivate *priv = self->priv;
+#endif
+
+    if (virt_viewer_app_get_multi_session(app))
+        return virt_viewer_app_start_sessions(app, err);
+
+#ifdef HAVE_SPICE_GTK
+    g_signal_connect(app, "notify", G_CALLBACK(app_notified), self);
+
+    if (priv->controller) {
+        if (!virt_viewer_app_create_session(app, "spice", err)) {
+            g_debug("Couldn't create a Spice session");
+            return FALSE;
+        }
+
+        g_signal_connect(priv->controller, "notify", G_CALLBACK(spice_ctrl_notified), self);
+        g_signal_connect(priv->controller, "do_connect", G_CALLBACK(spice_ctrl_do_connect), self);
+        g_signal_connect(priv->controller, "show", G_CALLBACK(spice_ctrl_show), self);
+        g_signal_connect(priv->controller, "hide", G_CALLBACK(spice_ctrl_hide), self);
+
+        spice_ctrl_controller_listen(priv->controller, NULL, spice_ctrl_listen_async_cb, self);
+
+        g_signal_connect(priv->ctrl_foreign_menu, "notify", G_CALLBACK(spice_ctrl_foreign_menu_notified), self);
+        spice_ctrl_foreign_menu_listen(priv->ctrl_foreign_menu, NULL, spice_ctrl_listen_async_cb, self);
+
+        virt_viewer_app_show_status(VIRT_VIEWER_APP(self), _("Setting up Spice session..."));
+    } else
+#endif
+    if (!remote_viewer_open_guri(self, err))
+        return FALSE;
+
+    return VIRT_VIEWER_APP_CLASS(remote_viewer_parent_class)->start(app, err);
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <gio/gio.h>
 #include <glib/gprintf.h>
@@ -55,6 +56,14 @@
 #include "virt-viewer-window.h"
 #include "virt-viewer-session.h"
 #include "virt-viewer-util.h"
+#include "virt-viewer-load.h"
+#include "virt-viewer-dashboard.h"
+#include "virt-viewer-settings.h"
+#include "virt-viewer-launcher.h"
+#include "virt-viewer-race.h"
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+#include "virt-viewer-broker.h"
+#endif
 #ifdef HAVE_GTK_VNC
 #include "virt-viewer-session-vnc.h"
 #endif
@@ -104,6 +113,42 @@ static void virt_viewer_app_set_fullscreen(VirtViewerApp *self, gboolean fullscr
 static void virt_viewer_app_update_menu_displays(VirtViewerApp *self);
 static void virt_viewer_update_smartcard_accels(VirtViewerApp *self);
 static void virt_viewer_app_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOptionGroup *group);
+static void virt_viewer_app_probe_finish(VirtViewerApp *self, gint status, const gchar *error);
+static void virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error);
+static void virt_viewer_app_resume_window(VirtViewerApp *self, VirtViewerWindow *win);
+static void virt_viewer_app_settle_suspended(VirtViewerApp *self);
+
+/* Milestones reported by --probe, in the order they are reached */
+typedef enum {
+    PROBE_PHASE_HYPERVISOR,
+    PROBE_PHASE_TUNNEL,
+    PROBE_PHASE_MAIN_CHANNEL,
+    PROBE_PHASE_DISPLAY_CHANNEL,
+    PROBE_PHASE_FIRST_FRAME,
+    PROBE_N_PHASES
+} ProbePhase;
+
+static const char *const probe_phase_names[PROBE_N_PHASES] = {
+    "hypervisor",
+    "tunnel",
+    "main-channel",
+    "display-channel",
+    "first-frame",
+};
+
+/* Exit status of --probe */
+#define PROBE_STATUS_OK 0
+#define PROBE_STATUS_FAILED 1
+#define PROBE_STATUS_TIMEOUT 2
+
+#define PROBE_DEFAULT_TIMEOUT 30
+
+/* How long suspended windows keep showing the last frame of their display
+ * before showing the connection status instead */
+#define SUSPEND_GRACE_MS 2000
+/* How long after the last display of the next session appeared the windows
+ * still waiting for theirs are torn down */
+#define SUSPEND_SETTLE_MS 10000
 
 
 struct _VirtViewerAppPrivate {
@@ -125,6 +170,12 @@ struct _VirtViewerAppPrivate {
     gboolean attach;
     gboolean quitting;
     gboolean kiosk;
+    gboolean reconnect; /* the session is re-established after a disconnect */
+    GList *suspended; /* windows waiting for the displays of the next session */
+    guint suspend_timeout_id;
+    guint settle_timeout_id;
+    gchar *suspend_status; /* status not shown yet by suspended windows */
+    gchar *disconnect_reason; /* why the session is being disconnected, or NULL */
 
     VirtViewerSession *session;
     gboolean active;
@@ -146,14 +197,35 @@ struct _VirtViewerAppPrivate {
     char *uuid;
 
     gint focused;
-    GKeyFile *config;
-    gchar *config_file;
+    VirtViewerSettings *settings;
 
     guint insert_smartcard_accel_key;
     GdkModifierType insert_smartcard_accel_mods;
     guint remove_smartcard_accel_key;
     GdkModifierType remove_smartcard_accel_mods;
     gboolean quit_on_disconnect;
+    guint render_scale; /* 0 means use the settings file */
+    guint config_render_scale;
+    const VirtViewerProfile *profile; /* NULL means use the settings file */
+    const VirtViewerProfile *config_profile;
+
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+    VirtViewerBroker *broker; /* NULL without --broker-fd */
+#endif
+    GCancellable *race_cancellable; /* while racing connections to ghost */
+    gint64 race_start;
+
+    gint64 launch_time;
+    gboolean probe;
+    gboolean probe_done;
+    gint64 probe_start;
+    gint64 probe_marks[PROBE_N_PHASES]; /* 0 when not reached */
+    guint probe_timeout_id;
+    gint exit_status;
+
+    VirtViewerLoad *load;
+    VirtViewerDashboard *dashboard;
+    VirtViewerLauncher *launcher;
 };
 
 
@@ -232,6 +304,12 @@ virt_viewer_app_simple_message_dialog(VirtViewerApp *self,
     msg = g_strdup_vprintf(fmt, vargs);
     va_end(vargs);
 
+    if (self->priv->probe) {
+        virt_viewer_app_probe_finish(self, PROBE_STATUS_FAILED, msg);
+        g_free(msg);
+        return;
+    }
+
     dialog = virt_viewer_app_make_message_dialog(self, msg);
     gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_destroy(dialog);
@@ -240,37 +318,95 @@ virt_viewer_app_simple_message_dialog(VirtViewerApp *self,
 }
 
 static void
-virt_viewer_app_save_config(VirtViewerApp *self)
+virt_viewer_app_probe_mark(VirtViewerApp *self, ProbePhase phase)
 {
     VirtViewerAppPrivate *priv = self->priv;
-    GError *error = NULL;
-    gchar *dir, *data;
-
-    dir = g_path_get_dirname(priv->config_file);
-    if (g_mkdir_with_parents(dir, S_IRWXU) == -1)
-        g_warning("failed to create config directory");
-    g_free(dir);
-
-    if (priv->uuid && priv->guest_name && g_key_file_has_group(priv->config, priv->uuid)) {
-        // if there's no comment for this uuid settings group, add a comment
-        // with the vm name so user can make sense of it later.
-        gchar *comment = g_key_file_get_comment(priv->config, priv->uuid, NULL, &error);
-        if (error) {
-            g_debug("Unable to get comment from key file: %s", error->message);
-            g_clear_error(&error);
-        } else {
-            if (!comment || *comment == '\0')
-                g_key_file_set_comment(priv->config, priv->uuid, NULL, priv->guest_name, NULL);
-        }
-        g_free(comment);
+
+    if (!priv->probe || priv->probe_done || priv->probe_marks[phase] != 0)
+        return;
+
+    priv->probe_marks[phase] = g_get_monotonic_time();
+    g_debug("probe: %s reached after %" G_GINT64_FORMAT " us", probe_phase_names[phase],
+            priv->probe_marks[phase] - priv->probe_start);
+}
+
+static gboolean
+virt_viewer_app_probe_quit(gpointer opaque)
+{
+    VirtViewerApp *self = opaque;
+
+    virt_viewer_app_deactivate(self, FALSE);
+    g_application_quit(G_APPLICATION(self));
+
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Prints the outcome of --probe as a single JSON object on stdout and
+ * quits. Each phase holds the milliseconds elapsed since startup when
+ * it was reached, or null; startup itself is timed from the creation of
+ * the application, so that cold and --use-launcher starts compare.
+ */
+static void
+virt_viewer_app_probe_finish(VirtViewerApp *self, gint status, const gchar *error)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+    GString *json;
+    int i;
+
+    if (!priv->probe || priv->probe_done)
+        return;
+    priv->probe_done = TRUE;
+    priv->exit_status = status;
+
+    if (priv->probe_timeout_id != 0) {
+        g_source_remove(priv->probe_timeout_id);
+        priv->probe_timeout_id = 0;
     }
 
-    if ((data = g_key_file_to_data(priv->config, NULL, &error)) == NULL ||
-        !g_file_set_contents(priv->config_file, data, -1, &error)) {
-        g_warning("Couldn't save configuration: %s", error->message);
-        g_clear_error(&error);
+    json = g_string_new("{\"result\": ");
+    virt_viewer_util_json_append_string(json, status == PROBE_STATUS_OK ? "ok" :
+                                        status == PROBE_STATUS_TIMEOUT ? "timeout" : "failed");
+    if (error != NULL) {
+        g_string_append(json, ", \"error\": ");
+        virt_viewer_util_json_append_string(json, error);
     }
-    g_free(data);
+    g_string_append(json, ", \"startup\": ");
+    virt_viewer_util_json_append_ms(json, priv->probe_start - priv->launch_time);
+    g_string_append(json, ", \"phases\": {");
+    for (i = 0; i < PROBE_N_PHASES; i++) {
+        g_string_append_printf(json, "%s\"%s\": ", i ? ", " : "", probe_phase_names[i]);
+        if (priv->probe_marks[i] != 0)
+            virt_viewer_util_json_append_ms(json, priv->probe_marks[i] - priv->probe_start);
+        else
+            g_string_append(json, "null");
+    }
+    g_string_append(json, "}, \"total\": ");
+    virt_viewer_util_json_append_ms(json, g_get_monotonic_time() - priv->probe_start);
+    g_string_append(json, "}\n");
+
+    g_print("%s", json->str);
+    g_string_free(json, TRUE);
+
+    /* this may run from a session signal handler, don't close it under its feet */
+    g_idle_add(virt_viewer_app_probe_quit, self);
+}
+
+static gboolean
+virt_viewer_app_probe_timeout(gpointer opaque)
+{
+    VirtViewerApp *self = opaque;
+
+    self->priv->probe_timeout_id = 0;
+    virt_viewer_app_probe_finish(self, PROBE_STATUS_TIMEOUT, _("Timed out"));
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_app_save_config(VirtViewerApp *self)
+{
+    virt_viewer_settings_flush(self->priv->settings);
 }
 
 static void
@@ -363,6 +499,16 @@ app_window_try_fullscreen(VirtViewerApp *self G_GNUC_UNUSED,
     virt_viewer_window_enter_fullscreen(win, monitor);
 }
 
+/* Guest sections are only read from disk when first looked up */
+static GKeyFile *
+virt_viewer_app_get_config_for_section(VirtViewerApp *self, const gchar *section)
+{
+    if (g_str_equal(section, "fallback"))
+        return virt_viewer_settings_get_global(self->priv->settings);
+
+    return virt_viewer_settings_get_guest(self->priv->settings, section);
+}
+
 static GHashTable*
 virt_viewer_app_get_monitor_mapping_for_section(VirtViewerApp *self, const gchar *section)
 {
@@ -371,7 +517,10 @@ virt_viewer_app_get_monitor_mapping_for_section(VirtViewerApp *self, const gchar
     gchar **mappings = NULL;
     GHashTable *mapping = NULL;
 
-    mappings = g_key_file_get_string_list(self->priv->config,
+    if (section == NULL)
+        return NULL;
+
+    mappings = g_key_file_get_string_list(virt_viewer_app_get_config_for_section(self, section),
                                           section, "monitor-mapping", &nmappings, &error);
     if (error) {
         if (error->code != G_KEY_FILE_ERROR_GROUP_NOT_FOUND
@@ -419,6 +568,77 @@ void virt_viewer_app_apply_monitor_mapping(VirtViewerApp *self)
     }
 }
 
+static guint
+virt_viewer_app_get_render_scale_for_section(VirtViewerApp *self, const gchar *section)
+{
+    GError *error = NULL;
+    gint scale;
+
+    if (section == NULL)
+        return 0;
+
+    scale = g_key_file_get_integer(virt_viewer_app_get_config_for_section(self, section),
+                                   section, "render-scale", &error);
+    if (error) {
+        if (error->code != G_KEY_FILE_ERROR_GROUP_NOT_FOUND
+            && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND)
+            g_warning("Error reading render scale for %s: %s", section, error->message);
+        g_clear_error(&error);
+        return 0;
+    }
+
+    if (scale < 1 || scale > MAX_RENDER_SCALE) {
+        g_warning("Invalid render scale for %s: %d", section, scale);
+        return 0;
+    }
+
+    return scale;
+}
+
+static void
+virt_viewer_app_update_config_render_scale(VirtViewerApp *self)
+{
+    guint scale = virt_viewer_app_get_render_scale_for_section(self, self->priv->uuid);
+
+    if (scale == 0)
+        scale = virt_viewer_app_get_render_scale_for_section(self, "fallback");
+
+    self->priv->config_render_scale = scale;
+}
+
+static const VirtViewerProfile*
+virt_viewer_app_get_profile_for_section(VirtViewerApp *self, const gchar *section)
+{
+    const VirtViewerProfile *profile;
+    gchar *name;
+
+    if (section == NULL)
+        return NULL;
+
+    name = g_key_file_get_string(virt_viewer_app_get_config_for_section(self, section),
+                                 section, "profile", NULL);
+    if (name == NULL)
+        return NULL;
+
+    profile = virt_viewer_profile_lookup(name);
+    if (profile == NULL)
+        g_warning("Invalid profile for %s: %s", section, name);
+    g_free(name);
+
+    return profile;
+}
+
+static void
+virt_viewer_app_update_config_profile(VirtViewerApp *self)
+{
+    const VirtViewerProfile *profile = virt_viewer_app_get_profile_for_section(self, self->priv->uuid);
+
+    if (profile == NULL)
+        profile = virt_viewer_app_get_profile_for_section(self, "fallback");
+
+    self->priv->config_profile = profile;
+}
+
 static
 void virt_viewer_app_set_uuid_string(VirtViewerApp *self, const gchar *uuid_string)
 {
@@ -430,6 +650,8 @@ void virt_viewer_app_set_uuid_string(VirtViewerApp *self, const gchar *uuid_stri
     g_free(self->priv->uuid);
     self->priv->uuid = g_strdup(uuid_string);
 
+    virt_viewer_app_update_config_render_scale(self);
+    virt_viewer_app_update_config_profile(self);
     virt_viewer_app_apply_monitor_mapping(self);
 }
 
@@ -438,12 +660,22 @@ virt_viewer_app_maybe_quit(VirtViewerApp *self, VirtViewerWindow *window)
 {
     GError *error = NULL;
 
+    /* closing a window promoted from the dashboard brings it back there */
+    if (self->priv->dashboard != NULL &&
+        virt_viewer_dashboard_demote(self->priv->dashboard, window))
+        return;
+
+    /* a resident launcher outlives the windows it opens */
+    if (self->priv->launcher != NULL &&
+        virt_viewer_launcher_close_window(self->priv->launcher, window))
+        return;
+
     if (self->priv->kiosk) {
         g_warning("The app is in kiosk mode and can't quit");
         return;
     }
 
-    gboolean ask = g_key_file_get_boolean(self->priv->config,
+    gboolean ask = g_key_file_get_boolean(virt_viewer_settings_get_global(self->priv->settings),
                                           "virt-viewer", "ask-quit", &error);
     if (error) {
         ask = TRUE;
@@ -467,8 +699,9 @@ virt_viewer_app_maybe_quit(VirtViewerApp *self, VirtViewerWindow *window)
 
         gboolean dont_ask = FALSE;
         g_object_get(check, "active", &dont_ask, NULL);
-        g_key_file_set_boolean(self->priv->config,
+        g_key_file_set_boolean(virt_viewer_settings_get_global(self->priv->settings),
                     "virt-viewer", "ask-quit", !dont_ask);
+        virt_viewer_settings_changed(self->priv->settings, NULL);
 
         gtk_widget_destroy(dialog);
         switch (result) {
@@ -532,6 +765,10 @@ static void hide_one_window(gpointer value,
     VirtViewerAppPrivate *priv = self->priv;
     gboolean connect_error = !priv->connected && !priv->cancelled;
 
+    /* suspended windows stay in place until the session is back */
+    if (g_list_find(priv->suspended, value) != NULL)
+        return;
+
     if (connect_error || self->priv->main_window != value)
         virt_viewer_window_hide(VIRT_VIEWER_WINDOW(value));
 }
@@ -676,6 +913,84 @@ virt_viewer_app_open_unix_sock(const char *unixsock, GError **error)
     return fd;
 }
 
+typedef struct {
+    VirtViewerApp *app;
+    VirtViewerSession *session;
+    VirtViewerSessionChannel *channel;
+} BrokerChannel;
+
+static void
+virt_viewer_app_broker_channel_ready(GObject *source G_GNUC_UNUSED,
+                                     GAsyncResult *result,
+                                     gpointer opaque)
+{
+    BrokerChannel *data = opaque;
+    GError *error = NULL;
+    int fd = virt_viewer_broker_open_fd_finish(NULL, result, &error);
+
+    if (fd >= 0) {
+        virt_viewer_session_channel_open_fd(data->session, data->channel, fd);
+    } else if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        virt_viewer_app_simple_message_dialog(data->app, "%s", error->message);
+    }
+    g_clear_error(&error);
+
+    g_object_unref(data->channel);
+    g_object_unref(data->session);
+    g_object_unref(data->app);
+    g_free(data);
+}
+
+static void
+virt_viewer_app_broker_open_channel(VirtViewerApp *self,
+                                    VirtViewerSession *session,
+                                    VirtViewerSessionChannel *channel)
+{
+    BrokerChannel *data;
+    const gchar *name = "main";
+    gint id = 0;
+    gboolean tls = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(channel), "virt-viewer-tls"));
+
+#ifdef HAVE_SPICE_GTK
+    if (SPICE_IS_CHANNEL(channel)) {
+        gint type;
+
+        g_object_get(channel, "channel-type", &type, "channel-id", &id, NULL);
+        name = spice_channel_type_to_string(type);
+    }
+#endif
+
+    data = g_new0(BrokerChannel, 1);
+    data->app = g_object_ref(self);
+    data->session = g_object_ref(session);
+    data->channel = g_object_ref(channel);
+    virt_viewer_broker_open_fd_async(self->priv->broker, name, id, tls,
+                                     virt_viewer_app_broker_channel_ready, data);
+}
+
+static void
+virt_viewer_app_broker_main_ready(GObject *source G_GNUC_UNUSED,
+                                  GAsyncResult *result,
+                                  gpointer opaque)
+{
+    VirtViewerApp *self = opaque;
+    GError *error = NULL;
+    int fd = virt_viewer_broker_open_fd_finish(NULL, result, &error);
+
+    if (fd >= 0) {
+        virt_viewer_app_probe_mark(self, PROBE_PHASE_TUNNEL);
+        if (!virt_viewer_session_open_fd(VIRT_VIEWER_SESSION(self->priv->session), fd)) {
+            virt_viewer_app_show_status(self, _("Failed to connect to the graphic server"));
+            virt_viewer_app_deactivate(self, TRUE);
+        }
+    } else if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        virt_viewer_app_show_status(self, "%s", error->message);
+        virt_viewer_app_deactivate(self, TRUE);
+    }
+    g_clear_error(&error);
+    g_object_unref(self);
+}
+
 #endif /* defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK) */
 
 void
@@ -912,6 +1227,11 @@ ensure_window_for_display(VirtViewerApp *self, VirtViewerDisplay *display)
         }
 
         virt_viewer_window_set_display(win, display);
+    } else if (virt_viewer_window_get_display(win) != display) {
+        /* a suspended window, it keeps its size, placement and zoom */
+        g_debug("Resuming window %d %p", nth, win);
+        virt_viewer_window_set_display(win, display);
+        virt_viewer_app_resume_window(self, win);
     }
     virt_viewer_app_set_window_subtitle(self, win, nth);
 
@@ -934,6 +1254,14 @@ display_show_hint(VirtViewerDisplay *display,
                  "show-hint", &hint,
                  NULL);
 
+    if (self->priv->probe) {
+        if (hint & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY) {
+            virt_viewer_app_probe_mark(self, PROBE_PHASE_FIRST_FRAME);
+            virt_viewer_app_probe_finish(self, PROBE_STATUS_OK, NULL);
+        }
+        return;
+    }
+
     win = virt_viewer_app_get_nth_window(self, nth);
 
     if (self->priv->fullscreen &&
@@ -950,7 +1278,8 @@ display_show_hint(VirtViewerDisplay *display,
             virt_viewer_notebook_show_display(nb);
             virt_viewer_window_show(win);
         } else {
-            if (!self->priv->kiosk && win) {
+            if (!self->priv->kiosk && win &&
+                g_list_find(self->priv->suspended, win) == NULL) {
                 nb = virt_viewer_window_get_notebook(win);
                 virt_viewer_notebook_show_status(nb, _("Waiting for display %d..."), nth + 1);
             }
@@ -969,11 +1298,13 @@ virt_viewer_app_display_added(VirtViewerSession *session G_GNUC_UNUSED,
     g_object_get(display, "nth-display", &nth, NULL);
 
     g_debug("Insert display %d %p", nth, display);
+    virt_viewer_app_probe_mark(self, PROBE_PHASE_DISPLAY_CHANNEL);
     g_hash_table_insert(self->priv->displays, GINT_TO_POINTER(nth), g_object_ref(display));
 
     g_signal_connect(display, "notify::show-hint",
                      G_CALLBACK(display_show_hint), NULL);
     g_object_notify(G_OBJECT(display), "show-hint"); /* call display_show_hint */
+    virt_viewer_app_settle_suspended(self);
 }
 
 
@@ -983,6 +1314,7 @@ static void virt_viewer_app_remove_nth_window(VirtViewerApp *self,
     VirtViewerWindow *win = virt_viewer_app_get_nth_window(self, nth);
     if (!win)
         return;
+    virt_viewer_app_resume_window(self, win);
     virt_viewer_window_set_display(win, NULL);
     if (win == self->priv->main_window) {
         g_debug("Not removing main window %d %p", nth, win);
@@ -996,6 +1328,124 @@ static void virt_viewer_app_remove_nth_window(VirtViewerApp *self,
     g_object_unref(win);
 }
 
+/*
+ * When the session is expected to come back, the windows are suspended
+ * instead of being torn down: they show a picture of the last frame of their
+ * display until ensure_window_for_display() rebinds them to the displays of
+ * the next session.
+ */
+static gboolean
+virt_viewer_app_can_suspend(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+
+    return priv->reconnect && priv->connected && !priv->cancelled &&
+        !priv->quitting && !priv->probe;
+}
+
+static gboolean
+virt_viewer_app_suspend_timeout(gpointer opaque)
+{
+    VirtViewerApp *self = opaque;
+    VirtViewerAppPrivate *priv = self->priv;
+    GList *l;
+
+    priv->suspend_timeout_id = 0;
+    for (l = priv->suspended; priv->suspend_status != NULL && l != NULL; l = l->next) {
+        VirtViewerNotebook *nb = virt_viewer_window_get_notebook(VIRT_VIEWER_WINDOW(l->data));
+        virt_viewer_notebook_show_status(nb, "%s", priv->suspend_status);
+    }
+    g_clear_pointer(&priv->suspend_status, g_free);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_app_suspend_window(VirtViewerApp *self, VirtViewerDisplay *display)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+    gint nth = virt_viewer_display_get_nth(display);
+    VirtViewerWindow *win = virt_viewer_app_get_nth_window(self, nth);
+
+    if (win == NULL)
+        return;
+
+    g_debug("Suspending window %d %p", nth, win);
+    virt_viewer_display_release_cursor(display);
+    /* the display widget stops drawing once its channel is gone */
+    if (!virt_viewer_window_freeze_display(win))
+        gtk_widget_set_sensitive(GTK_WIDGET(display), FALSE);
+    priv->suspended = g_list_append(priv->suspended, win);
+    if (priv->suspend_timeout_id == 0)
+        priv->suspend_timeout_id = g_timeout_add(SUSPEND_GRACE_MS,
+                                                 virt_viewer_app_suspend_timeout, self);
+}
+
+static void
+virt_viewer_app_resume_window(VirtViewerApp *self, VirtViewerWindow *win)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+
+    priv->suspended = g_list_remove(priv->suspended, win);
+    if (priv->suspended == NULL && priv->suspend_timeout_id != 0) {
+        g_source_remove(priv->suspend_timeout_id);
+        priv->suspend_timeout_id = 0;
+        g_clear_pointer(&priv->suspend_status, g_free);
+    }
+}
+
+/* Tears down the windows whose display did not come back */
+static void
+virt_viewer_app_release_suspended(VirtViewerApp *self)
+{
+    if (self->priv->settle_timeout_id != 0) {
+        g_source_remove(self->priv->settle_timeout_id);
+        self->priv->settle_timeout_id = 0;
+    }
+
+    while (self->priv->suspended != NULL) {
+        VirtViewerWindow *win = self->priv->suspended->data;
+        VirtViewerDisplay *display = virt_viewer_window_get_display(win);
+
+        virt_viewer_app_resume_window(self, win);
+        if (display != NULL)
+            virt_viewer_app_remove_nth_window(self, virt_viewer_display_get_nth(display));
+    }
+    virt_viewer_app_update_menu_displays(self);
+}
+
+static gboolean
+virt_viewer_app_settle_timeout(gpointer opaque)
+{
+    VirtViewerApp *self = opaque;
+
+    self->priv->settle_timeout_id = 0;
+    g_debug("Releasing %u windows whose display did not come back",
+            g_list_length(self->priv->suspended));
+    virt_viewer_app_release_suspended(self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * The displays of the next session may not all come back, for instance
+ * when the guest restarted with fewer monitors. Once no new display
+ * appeared for a while, the windows still suspended are released.
+ */
+static void
+virt_viewer_app_settle_suspended(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+
+    if (priv->settle_timeout_id != 0)
+        g_source_remove(priv->settle_timeout_id);
+    priv->settle_timeout_id = 0;
+
+    if (priv->suspended != NULL && priv->connected)
+        priv->settle_timeout_id = g_timeout_add(SUSPEND_SETTLE_MS,
+                                                virt_viewer_app_settle_timeout, self);
+}
+
 static void
 virt_viewer_app_display_removed(VirtViewerSession *session G_GNUC_UNUSED,
                                 VirtViewerDisplay *display,
@@ -1004,7 +1454,11 @@ virt_viewer_app_display_removed(VirtViewerSession *session G_GNUC_UNUSED,
     gint nth;
 
     g_object_get(display, "nth-display", &nth, NULL);
-    virt_viewer_app_remove_nth_window(self, nth);
+    g_signal_handlers_disconnect_by_func(display, display_show_hint, NULL);
+    if (virt_viewer_app_can_suspend(self))
+        virt_viewer_app_suspend_window(self, display);
+    else
+        virt_viewer_app_remove_nth_window(self, nth);
     g_hash_table_remove(self->priv->displays, GINT_TO_POINTER(nth));
     virt_viewer_app_update_menu_displays(self);
 }
@@ -1032,6 +1486,42 @@ static void notify_software_reader_cb(GObject    *gobject G_GNUC_UNUSED,
     virt_viewer_update_smartcard_accels(VIRT_VIEWER_APP(user_data));
 }
 
+/**
+ * virt_viewer_app_new_session:
+ * @self: the application
+ * @type: the graphic type, "spice" or "vnc"
+ * @error: return location for a #GError
+ *
+ * Creates a session of the given type that is not tied to the windows of
+ * the application, see virt_viewer_app_create_session() for that.
+ *
+ * Returns: (transfer full): the new session, or %NULL if the type isn't
+ * supported
+ */
+VirtViewerSession *
+virt_viewer_app_new_session(VirtViewerApp *self, const gchar *type, GError **error)
+{
+    GtkWindow *window;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+    g_return_val_if_fail(type != NULL, NULL);
+
+    window = virt_viewer_window_get_window(self->priv->main_window);
+#ifdef HAVE_GTK_VNC
+    if (g_ascii_strcasecmp(type, "vnc") == 0)
+        return virt_viewer_session_vnc_new(self, window);
+#endif
+#ifdef HAVE_SPICE_GTK
+    if (g_ascii_strcasecmp(type, "spice") == 0)
+        return virt_viewer_session_spice_new(self, window);
+#endif
+
+    g_set_error(error,
+                VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                _("Unsupported graphic type '%s'"), type);
+    return NULL;
+}
+
 gboolean
 virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **error)
 {
@@ -1040,31 +1530,14 @@ virt_viewer_app_create_session(VirtViewerApp *self, const gchar *type, GError **
     g_return_val_if_fail(priv->session == NULL, FALSE);
     g_return_val_if_fail(type != NULL, FALSE);
 
-#ifdef HAVE_GTK_VNC
-    if (g_ascii_strcasecmp(type, "vnc") == 0) {
-        GtkWindow *window = virt_viewer_window_get_window(priv->main_window);
-        virt_viewer_app_trace(self, "Guest %s has a %s display",
-                              priv->guest_name, type);
-        priv->session = virt_viewer_session_vnc_new(self, window);
-    } else
-#endif
-#ifdef HAVE_SPICE_GTK
-    if (g_ascii_strcasecmp(type, "spice") == 0) {
-        GtkWindow *window = virt_viewer_window_get_window(priv->main_window);
-        virt_viewer_app_trace(self, "Guest %s has a %s display",
-                              priv->guest_name, type);
-        priv->session = virt_viewer_session_spice_new(self, window);
-    } else
-#endif
-    {
-        g_set_error(error,
-                    VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                    _("Unsupported graphic type '%s'"), type);
-
+    priv->session = virt_viewer_app_new_session(self, type, error);
+    if (priv->session == NULL) {
         virt_viewer_app_trace(self, "Guest %s has unsupported %s display type",
                               priv->guest_name, type);
         return FALSE;
     }
+    virt_viewer_app_trace(self, "Guest %s has a %s display",
+                          priv->guest_name, type);
 
     g_signal_connect(priv->session, "session-initialized",
                      G_CALLBACK(virt_viewer_app_initialized), self);
@@ -1138,11 +1611,15 @@ virt_viewer_app_channel_open(VirtViewerSession *session,
     g_debug("After open connection callback fd=%d", fd);
 
     priv = self->priv;
-    if (priv->transport && g_ascii_strcasecmp(priv->transport, "ssh") == 0 &&
+    if (priv->broker != NULL && fd == -1) {
+        virt_viewer_app_broker_open_channel(self, session, channel);
+    } else if (priv->transport && g_ascii_strcasecmp(priv->transport, "ssh") == 0 &&
         !priv->direct && fd == -1) {
         if ((fd = virt_viewer_app_open_tunnel_ssh(priv->host, priv->port, priv->user,
                                                   priv->ghost, priv->gport, NULL)) < 0)
             virt_viewer_app_simple_message_dialog(self, _("Connect to ssh failed."));
+        else
+            virt_viewer_app_probe_mark(self, PROBE_PHASE_TUNNEL);
     } else if (fd == -1) {
         virt_viewer_app_simple_message_dialog(self, _("Can't connect to channel, SSH only supported."));
     }
@@ -1160,6 +1637,137 @@ virt_viewer_app_channel_open(VirtViewerSession *session G_GNUC_UNUSED,
 }
 #endif
 
+#ifndef G_OS_WIN32
+/*
+ * Returns the ports of the display worth racing connections to, in order of
+ * preference, or NULL when a single connection attempt is all there is to do.
+ * The plain port is left out when the session only accepts a secure main
+ * channel, and the TLS port when the session has no use for it.
+ */
+static gchar **
+virt_viewer_app_race_ports(VirtViewerApp *self)
+{
+    VirtViewerAppPrivate *priv = self->priv;
+    GObject *session = virt_viewer_session_get(VIRT_VIEWER_SESSION(priv->session));
+    GPtrArray *ports = g_ptr_array_new();
+    gboolean plain = TRUE;
+
+    if (session != NULL &&
+        g_object_class_find_property(G_OBJECT_GET_CLASS(session), "secure-channels")) {
+        gchar **secure = NULL, **channel;
+
+        g_object_get(session, "secure-channels", &secure, NULL);
+        for (channel = secure; channel && *channel; channel++) {
+            if (g_str_equal(*channel, "main") || g_str_equal(*channel, "all"))
+                plain = FALSE;
+        }
+        g_strfreev(secure);
+    }
+
+    if (plain && priv->gport && g_strcmp0(priv->gport, "-1") != 0)
+        g_ptr_array_add(ports, g_strdup(priv->gport));
+    if (priv->gtlsport && g_strcmp0(priv->gtlsport, "-1") != 0 &&
+        session != NULL &&
+        g_object_class_find_property(G_OBJECT_GET_CLASS(session), "tls-port"))
+        g_ptr_array_add(ports, g_strdup(priv->gtlsport));
+
+    if (ports->len == 0) {
+        g_ptr_array_free(ports, TRUE);
+        return NULL;
+    }
+    g_ptr_array_add(ports, NULL);
+    return (gchar **)g_ptr_array_free(ports, FALSE);
+}
+
+static gboolean
+virt_viewer_app_has_cert_subject(VirtViewerApp *self)
+{
+    GObject *session = virt_viewer_session_get(VIRT_VIEWER_SESSION(self->priv->session));
+    gchar *subject = NULL;
+    gboolean has_subject;
+
+    if (session == NULL ||
+        !g_object_class_find_property(G_OBJECT_GET_CLASS(session), "cert-subject"))
+        return FALSE;
+
+    g_object_get(session, "cert-subject", &subject, NULL);
+    has_subject = subject != NULL && *subject != '\0';
+    g_free(subject);
+
+    return has_subject;
+}
+
+static void
+virt_viewer_app_race_ready(GObject *source G_GNUC_UNUSED,
+                           GAsyncResult *result,
+                           gpointer data)
+{
+    VirtViewerApp *self = data;
+    VirtViewerAppPrivate *priv = self->priv;
+    GSocketConnection *connection;
+    GError *error = NULL;
+    const gchar *gport = priv->gport;
+    gchar *host = NULL;
+    gboolean ret;
+
+    connection = virt_viewer_race_connect_finish(result, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_clear_error(&error);
+        g_object_unref(self);
+        return;
+    }
+    g_clear_object(&priv->race_cancellable);
+
+    if (connection != NULL) {
+        GSocket *sock = g_socket_connection_get_socket(connection);
+        GSocketAddress *address = g_socket_connection_get_remote_address(connection, NULL);
+        guint16 port = 0;
+
+        if (G_IS_INET_SOCKET_ADDRESS(address)) {
+            GInetSocketAddress *inet = G_INET_SOCKET_ADDRESS(address);
+            port = g_inet_socket_address_get_port(inet);
+            host = g_inet_address_to_string(g_inet_socket_address_get_address(inet));
+        }
+        virt_viewer_app_trace(self, "Connected to display at %s port %u in %" G_GINT64_FORMAT " ms",
+                              host ? host : priv->ghost, port,
+                              (g_get_monotonic_time() - priv->race_start) / 1000);
+        g_clear_object(&address);
+
+        /* any channel may end up on TLS, even if the plain port won.
+         * Without a certificate subject, the certificate is checked
+         * against the host name, which must be kept */
+        if (!virt_viewer_app_has_cert_subject(self))
+            g_clear_pointer(&host, g_free);
+
+        if (priv->gtlsport && port == g_ascii_strtoull(priv->gtlsport, NULL, 10)) {
+            /* the session does the TLS handshake itself, but it can skip
+             * the plain port, which did not answer first */
+            gport = NULL;
+        } else {
+            int fd = dup(g_socket_get_fd(sock));
+            if (fd >= 0)
+                virt_viewer_session_set_preconnected_fd(VIRT_VIEWER_SESSION(priv->session), fd);
+        }
+        g_object_unref(connection);
+    } else {
+        g_debug("Connection race to %s failed, connecting directly: %s",
+                priv->ghost, error->message);
+        g_clear_error(&error);
+    }
+
+    /* when the host name is not needed for TLS, the other channels go to
+     * the address which answered, rather than resolving it again */
+    ret = virt_viewer_session_open_host(VIRT_VIEWER_SESSION(priv->session),
+                                        host ? host : priv->ghost, gport, priv->gtlsport);
+    g_free(host);
+    if (!ret) {
+        virt_viewer_app_show_status(self, _("Failed to connect to the graphic server"));
+        virt_viewer_app_deactivate(self, TRUE);
+    }
+    g_object_unref(self);
+}
+#endif
+
 static gboolean
 virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
 {
@@ -1172,7 +1780,17 @@ virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
     g_debug("After open connection callback fd=%d", fd);
 
 #if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
-    if (priv->transport &&
+    if (priv->broker != NULL && fd == -1) {
+        /* with the TLS port only, the plain attempt would be refused */
+        gboolean tls = (priv->gport == NULL || g_str_equal(priv->gport, "-1")) &&
+            priv->gtlsport != NULL && !g_str_equal(priv->gtlsport, "-1");
+
+        virt_viewer_app_trace(self, "Asking the connection broker for the display connection");
+        virt_viewer_broker_open_fd_async(priv->broker, "main", 0, tls,
+                                         virt_viewer_app_broker_main_ready,
+                                         g_object_ref(self));
+        return TRUE;
+    } else if (priv->transport &&
         g_ascii_strcasecmp(priv->transport, "ssh") == 0 &&
         !priv->direct &&
         fd == -1) {
@@ -1198,6 +1816,7 @@ virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
                                                   priv->user, priv->ghost,
                                                   priv->gport, priv->unixsock)) < 0)
             return FALSE;
+        virt_viewer_app_probe_mark(self, PROBE_PHASE_TUNNEL);
     } else if (priv->unixsock && fd == -1) {
         virt_viewer_app_trace(self, "Opening direct UNIX connection to display at %s",
                               priv->unixsock);
@@ -1212,6 +1831,22 @@ virt_viewer_app_default_activate(VirtViewerApp *self, GError **error)
         virt_viewer_app_trace(self, "Opening connection to display at %s", priv->guri);
         return virt_viewer_session_open_uri(VIRT_VIEWER_SESSION(priv->session), priv->guri, error);
     } else if (priv->ghost) {
+#ifndef G_OS_WIN32
+        gchar **ports = virt_viewer_app_race_ports(self);
+
+        if (ports != NULL) {
+            virt_viewer_app_trace(self, "Racing TCP connections to display at %s:%s:%s",
+                                  priv->ghost, priv->gport, priv->gtlsport ? priv->gtlsport : "-1");
+            priv->race_cancellable = g_cancellable_new();
+            priv->race_start = g_get_monotonic_time();
+            virt_viewer_race_connect_async(priv->ghost, (const gchar * const *)ports,
+                                           priv->race_cancellable,
+                                           virt_viewer_app_race_ready,
+                                           g_object_ref(self));
+            g_strfreev(ports);
+            return TRUE;
+        }
+#endif
         virt_viewer_app_trace(self, "Opening direct TCP connection to display at %s:%s:%s",
                               priv->ghost, priv->gport, priv->gtlsport ? priv->gtlsport : "-1");
         return virt_viewer_session_open_host(VIRT_VIEWER_SESSION(priv->session),
@@ -1236,6 +1871,8 @@ virt_viewer_app_activate(VirtViewerApp *self, GError **error)
     if (priv->active)
         return FALSE;
 
+    /* the guest display has been looked up through libvirt or oVirt */
+    virt_viewer_app_probe_mark(self, PROBE_PHASE_HYPERVISOR);
     ret = VIRT_VIEWER_APP_GET_CLASS(self)->activate(self, error);
 
     if (ret == FALSE) {
@@ -1341,7 +1978,14 @@ virt_viewer_app_default_deactivated(VirtViewerApp *self, gboolean connect_error)
 {
     VirtViewerAppPrivate *priv = self->priv;
 
-    if (!connect_error) {
+    /* the session is not coming back */
+    virt_viewer_app_release_suspended(self);
+
+    if (!connect_error && priv->disconnect_reason != NULL) {
+        virt_viewer_app_show_status(self, "%s", priv->disconnect_reason);
+        virt_viewer_app_trace(self, "Guest %s display has disconnected (%s), shutting down",
+                              priv->guest_name, priv->disconnect_reason);
+    } else if (!connect_error) {
         virt_viewer_app_show_status(self, _("Guest domain has shutdown"));
         virt_viewer_app_trace(self, "Guest %s display has disconnected, shutting down",
                               priv->guest_name);
@@ -1368,6 +2012,11 @@ virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error)
     if (!priv->active)
         return;
 
+    if (priv->race_cancellable) {
+        g_cancellable_cancel(priv->race_cancellable);
+        g_clear_object(&priv->race_cancellable);
+    }
+
     if (priv->session) {
         virt_viewer_session_close(VIRT_VIEWER_SESSION(priv->session));
     }
@@ -1375,6 +2024,8 @@ virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error)
     priv->connected = FALSE;
     priv->active = FALSE;
     priv->started = FALSE;
+    /* the suspended windows wait for the displays of the next session */
+    virt_viewer_app_settle_suspended(self);
 #if 0
     g_free(priv->pretty_address);
     priv->pretty_address = NULL;
@@ -1389,6 +2040,7 @@ virt_viewer_app_deactivate(VirtViewerApp *self, gboolean connect_error)
         g_clear_object(&priv->session);
         virt_viewer_app_deactivated(self, connect_error);
     }
+    g_clear_pointer(&priv->disconnect_reason, g_free);
 
 }
 
@@ -1399,6 +2051,8 @@ virt_viewer_app_connected(VirtViewerSession *session G_GNUC_UNUSED,
     VirtViewerAppPrivate *priv = self->priv;
 
     priv->connected = TRUE;
+    virt_viewer_app_probe_mark(self, PROBE_PHASE_MAIN_CHANNEL);
+    virt_viewer_app_settle_suspended(self);
 
     if (self->priv->kiosk)
         virt_viewer_app_show_status(self, "");
@@ -1428,7 +2082,11 @@ virt_viewer_app_disconnected(VirtViewerSession *session G_GNUC_UNUSED, const gch
     if (priv->quitting)
         g_application_quit(G_APPLICATION(self));
 
-    if (connect_error) {
+    if (priv->probe) {
+        virt_viewer_app_probe_finish(self, PROBE_STATUS_FAILED,
+                                     msg ? msg : _("Disconnected from the graphic server"));
+    } else if (connect_error && priv->suspended == NULL) {
+        /* failed reconnections don't interrupt the suspended windows */
         GtkWidget *dialog = virt_viewer_app_make_message_dialog(self,
             _("Unable to connect to the graphic server %s"), priv->pretty_address);
 
@@ -1626,10 +2284,29 @@ virt_viewer_app_dispose (GObject *object)
     VirtViewerApp *self = VIRT_VIEWER_APP(object);
     VirtViewerAppPrivate *priv = self->priv;
 
+    g_clear_pointer(&priv->load, virt_viewer_load_free);
+    g_clear_pointer(&priv->dashboard, virt_viewer_dashboard_free);
+    g_clear_pointer(&priv->launcher, virt_viewer_launcher_free);
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+    g_clear_pointer(&priv->broker, virt_viewer_broker_free);
+#endif
+
     if (priv->preferences)
         gtk_widget_destroy(priv->preferences);
     priv->preferences = NULL;
 
+    if (priv->suspend_timeout_id != 0) {
+        g_source_remove(priv->suspend_timeout_id);
+        priv->suspend_timeout_id = 0;
+    }
+    if (priv->settle_timeout_id != 0) {
+        g_source_remove(priv->settle_timeout_id);
+        priv->settle_timeout_id = 0;
+    }
+    g_clear_pointer(&priv->suspended, g_list_free);
+    g_clear_pointer(&priv->suspend_status, g_free);
+    g_clear_pointer(&priv->disconnect_reason, g_free);
+
     if (priv->windows) {
         GList *tmp = priv->windows;
         /* null-ify before unrefing, because we need
@@ -1663,9 +2340,7 @@ virt_viewer_app_dispose (GObject *object)
     priv->title = NULL;
     g_free(priv->uuid);
     priv->uuid = NULL;
-    g_free(priv->config_file);
-    priv->config_file = NULL;
-    g_clear_pointer(&priv->config, g_key_file_free);
+    g_clear_pointer(&priv->settings, virt_viewer_settings_free);
     g_clear_pointer(&priv->initial_display_map, g_hash_table_unref);
 
     virt_viewer_app_free_connect_info(self);
@@ -1689,10 +2364,30 @@ gboolean virt_viewer_app_start(VirtViewerApp *self, GError **error)
 
     g_return_val_if_fail(!self->priv->started, TRUE);
 
-    self->priv->started = klass->start(self, error);
+    if (self->priv->launcher != NULL)
+        self->priv->started = virt_viewer_launcher_start(self->priv->launcher, error);
+    else
+        self->priv->started = klass->start(self, error);
     return self->priv->started;
 }
 
+/*
+ * Reports that the application could not start, and quits. Also used by
+ * the subclasses whose start completes asynchronously.
+ */
+void virt_viewer_app_start_failed(VirtViewerApp *self, const GError *error)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    if (error && !g_error_matches(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED))
+        virt_viewer_app_simple_message_dialog(self, error->message);
+    virt_viewer_app_probe_finish(self, PROBE_STATUS_FAILED,
+                                 error ? error->message : _("Unable to start"));
+
+    self->priv->started = FALSE;
+    g_application_quit(G_APPLICATION(self));
+}
+
 static int opt_zoom = NORMAL_ZOOM_LEVEL;
 static gchar *opt_hotkeys = NULL;
 static gboolean opt_version = FALSE;
@@ -1701,6 +2396,16 @@ static gboolean opt_debug = FALSE;
 static gboolean opt_fullscreen = FALSE;
 static gboolean opt_kiosk = FALSE;
 static gboolean opt_kiosk_quit = FALSE;
+static int opt_render_scale = 0;
+static gchar *opt_profile = NULL;
+static gboolean opt_probe = FALSE;
+static int opt_probe_timeout = PROBE_DEFAULT_TIMEOUT;
+static int opt_load_sessions = 0;
+static int opt_load_rate = 5;
+static int opt_load_duration = 60;
+static gchar *opt_load_script = NULL;
+static gboolean opt_dashboard = FALSE;
+static int opt_broker_fd = -1;
 
 static void
 title_maybe_changed(VirtViewerApp *self, GParamSpec* pspec G_GNUC_UNUSED, gpointer user_data G_GNUC_UNUSED)
@@ -1711,26 +2416,20 @@ title_maybe_changed(VirtViewerApp *self, GParamSpec* pspec G_GNUC_UNUSED, gpoint
 static void
 virt_viewer_app_init(VirtViewerApp *self)
 {
-    GError *error = NULL;
+    gchar *config_dir;
     self->priv = GET_PRIVATE(self);
+    self->priv->launch_time = g_get_monotonic_time();
 
     gtk_window_set_default_icon_name("virt-viewer");
 
     self->priv->displays = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_object_unref);
-    self->priv->config = g_key_file_new();
-    self->priv->config_file = g_build_filename(g_get_user_config_dir(),
-                                               "virt-viewer", "settings", NULL);
-    g_key_file_load_from_file(self->priv->config, self->priv->config_file,
-                    G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS, &error);
-
-    if (g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
-        g_debug("No configuration file %s", self->priv->config_file);
-    else if (error)
-        g_warning("Couldn't load configuration: %s", error->message);
-
-    g_clear_error(&error);
+    config_dir = g_build_filename(g_get_user_config_dir(), "virt-viewer", NULL);
+    self->priv->settings = virt_viewer_settings_new(config_dir);
+    g_free(config_dir);
 
     self->priv->initial_display_map = virt_viewer_app_get_monitor_mapping_for_section(self, "fallback");
+    virt_viewer_app_update_config_render_scale(self);
+    virt_viewer_app_update_config_profile(self);
     g_signal_connect(self, "notify::guest-name", G_CALLBACK(title_maybe_changed), NULL);
     g_signal_connect(self, "notify::title", G_CALLBACK(title_maybe_changed), NULL);
     g_signal_connect(self, "notify::guri", G_CALLBACK(title_maybe_changed), NULL);
@@ -1802,8 +2501,27 @@ virt_viewer_app_on_application_startup(GApplication *app)
     virt_viewer_app_set_fullscreen(self, opt_fullscreen);
 
     self->priv->verbose = opt_verbose;
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+    if (opt_broker_fd >= 0) {
+        GError *error = NULL;
+
+        self->priv->broker = virt_viewer_broker_new(opt_broker_fd, &error);
+        if (self->priv->broker == NULL) {
+            g_warning("Can't use the connection broker: %s", error->message);
+            g_clear_error(&error);
+        }
+    }
+#endif
     self->priv->quit_on_disconnect = opt_kiosk ? opt_kiosk_quit : TRUE;
 
+    if (opt_probe) {
+        self->priv->probe = TRUE;
+        self->priv->probe_start = g_get_monotonic_time();
+        self->priv->probe_timeout_id = g_timeout_add_seconds(MAX(opt_probe_timeout, 1),
+                                                             virt_viewer_app_probe_timeout,
+                                                             self);
+    }
+
     self->priv->main_window = virt_viewer_app_window_new(self,
                                                          virt_viewer_app_get_first_monitor(self));
     self->priv->main_notebook = GTK_WIDGET(virt_viewer_window_get_notebook(self->priv->main_window));
@@ -1818,6 +2536,17 @@ virt_viewer_app_on_application_startup(GApplication *app)
 
     virt_viewer_window_set_zoom_level(self->priv->main_window, opt_zoom);
 
+    if (opt_render_scale < 0 || opt_render_scale > MAX_RENDER_SCALE) {
+        g_printerr(_("Render scale must be within %d-%d\n"), 1, MAX_RENDER_SCALE);
+        opt_render_scale = 0;
+    }
+    virt_viewer_app_set_render_scale(self, opt_render_scale);
+
+    if (opt_profile != NULL && !virt_viewer_app_set_profile(self, opt_profile, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+    }
+
     virt_viewer_set_insert_smartcard_accel(self, GDK_KEY_F8, GDK_SHIFT_MASK);
     virt_viewer_set_remove_smartcard_accel(self, GDK_KEY_F9, GDK_SHIFT_MASK);
     gtk_accel_map_add_entry("<virt-viewer>/view/toggle-fullscreen", GDK_KEY_F11, 0);
@@ -1828,11 +2557,8 @@ virt_viewer_app_on_application_startup(GApplication *app)
     gtk_accel_map_add_entry("<virt-viewer>/send/secure-attention", GDK_KEY_End, GDK_CONTROL_MASK | GDK_MOD1_MASK);
 
     if (!virt_viewer_app_start(self, &error)) {
-        if (error && !g_error_matches(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED))
-            virt_viewer_app_simple_message_dialog(self, error->message);
-
+        virt_viewer_app_start_failed(self, error);
         g_clear_error(&error);
-        g_application_quit(app);
         return;
     }
 }
@@ -1874,6 +2600,55 @@ virt_viewer_app_local_command_line (GApplication   *gapp,
         goto end;
     }
 
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+    if (opt_broker_fd >= 0) {
+        struct stat sb;
+
+        if (fstat(opt_broker_fd, &sb) < 0 || !S_ISSOCK(sb.st_mode)) {
+            g_printerr(_("--broker-fd: %d is not an open socket\n"), opt_broker_fd);
+            *status = 1;
+            ret = TRUE;
+            goto end;
+        }
+        /* keep it out of the ssh tunnels */
+        fcntl(opt_broker_fd, F_SETFD, fcntl(opt_broker_fd, F_GETFD) | FD_CLOEXEC);
+    }
+#endif
+
+    if (opt_dashboard && opt_load_sessions > 0) {
+        g_printerr(_("--dashboard and --load-test can't be used together\n"));
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+
+#ifdef HAVE_GTK_VNC
+    if (!virt_viewer_session_vnc_check_options(&error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        *status = 1;
+        ret = TRUE;
+        goto end;
+    }
+#endif
+
+    if (opt_dashboard)
+        self->priv->dashboard = virt_viewer_dashboard_new(self);
+
+    if (opt_load_sessions > 0) {
+        self->priv->load = virt_viewer_load_new(self, opt_load_sessions,
+                                                MAX(opt_load_rate, 1),
+                                                MAX(opt_load_duration, 0));
+        if (opt_load_script != NULL &&
+            !virt_viewer_load_set_script(self->priv->load, opt_load_script, &error)) {
+            g_printerr("%s\n", error->message);
+            g_clear_error(&error);
+            *status = 1;
+            ret = TRUE;
+            goto end;
+        }
+    }
+
     if (opt_version) {
         g_print(_("%s version %s"), g_get_prgname(), VERSION BUILDID);
 #ifdef REMOTE_VIEWER_OS_ID
@@ -1888,6 +2663,50 @@ end:
     return ret;
 }
 
+/* Requests handed over to a resident launcher */
+static void
+virt_viewer_app_open(GApplication *gapp, GFile **files, gint n_files, const gchar *hint)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(gapp);
+
+    g_return_if_fail(self->priv->launcher != NULL);
+
+    virt_viewer_launcher_open(self->priv->launcher, files, n_files, hint);
+}
+
+static gboolean
+virt_viewer_app_dbus_register(GApplication *gapp,
+                              GDBusConnection *connection,
+                              const gchar *object_path,
+                              GError **error)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(gapp);
+
+    if (!G_APPLICATION_CLASS(virt_viewer_app_parent_class)->dbus_register(gapp, connection,
+                                                                          object_path, error))
+        return FALSE;
+
+    /* the probes handed over to a resident launcher */
+    if (self->priv->launcher != NULL)
+        return virt_viewer_launcher_dbus_register(self->priv->launcher, connection, error);
+
+    return TRUE;
+}
+
+static void
+virt_viewer_app_dbus_unregister(GApplication *gapp,
+                                GDBusConnection *connection,
+                                const gchar *object_path)
+{
+    VirtViewerApp *self = VIRT_VIEWER_APP(gapp);
+
+    if (self->priv->launcher != NULL)
+        virt_viewer_launcher_dbus_unregister(self->priv->launcher, connection);
+
+    G_APPLICATION_CLASS(virt_viewer_app_parent_class)->dbus_unregister(gapp, connection,
+                                                                       object_path);
+}
+
 static void
 virt_viewer_app_class_init (VirtViewerAppClass *klass)
 {
@@ -1903,6 +2722,9 @@ virt_viewer_app_class_init (VirtViewerAppClass *klass)
     g_app_class->local_command_line = virt_viewer_app_local_command_line;
     g_app_class->startup = virt_viewer_app_on_application_startup;
     g_app_class->command_line = NULL; /* inhibit GApplication default handler */
+    g_app_class->open = virt_viewer_app_open;
+    g_app_class->dbus_register = virt_viewer_app_dbus_register;
+    g_app_class->dbus_unregister = virt_viewer_app_dbus_unregister;
 
     klass->start = virt_viewer_app_default_start;
     klass->initial_connect = virt_viewer_app_default_initial_connect;
@@ -2126,6 +2948,41 @@ virt_viewer_app_get_attach(VirtViewerApp *self)
     return self->priv->attach;
 }
 
+/**
+ * virt_viewer_app_set_reconnect:
+ * @self: the application
+ * @reconnect: whether a new session follows a disconnection
+ *
+ * When @reconnect is %TRUE, the windows of a session that disconnects after
+ * being connected are suspended rather than torn down, and rebound to the
+ * displays of the next session.
+ */
+void
+virt_viewer_app_set_reconnect(VirtViewerApp *self, gboolean reconnect)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    self->priv->reconnect = reconnect;
+}
+
+/**
+ * virt_viewer_app_set_disconnect_reason:
+ * @self: the application
+ * @reason: a translated message
+ *
+ * Explains why the session is about to be disconnected by the client
+ * itself. If the application then gives up on the session, @reason is
+ * shown instead of reporting that the guest shut down.
+ */
+void
+virt_viewer_app_set_disconnect_reason(VirtViewerApp *self, const gchar *reason)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    g_free(self->priv->disconnect_reason);
+    self->priv->disconnect_reason = g_strdup(reason);
+}
+
 gboolean
 virt_viewer_app_is_active(VirtViewerApp *self)
 {
@@ -2407,6 +3264,7 @@ virt_viewer_app_show_status(VirtViewerApp *self, const gchar *fmt, ...)
 {
     va_list args;
     gchar *text;
+    GList *l;
 
     g_return_if_fail(VIRT_VIEWER_IS_APP(self));
     g_return_if_fail(fmt != NULL);
@@ -2415,7 +3273,18 @@ virt_viewer_app_show_status(VirtViewerApp *self, const gchar *fmt, ...)
     text = g_strdup_vprintf(fmt, args);
     va_end(args);
 
-    g_list_foreach(self->priv->windows, show_status_cb, text);
+    /* suspended windows keep their last frame for a little while */
+    if (self->priv->suspend_timeout_id != 0) {
+        g_free(self->priv->suspend_status);
+        self->priv->suspend_status = g_strdup(text);
+    }
+
+    for (l = self->priv->windows; l != NULL; l = l->next) {
+        if (self->priv->suspend_timeout_id != 0 &&
+            g_list_find(self->priv->suspended, l->data) != NULL)
+            continue;
+        show_status_cb(l->data, text);
+    }
     g_free(text);
 }
 
@@ -2569,6 +3438,10 @@ virt_viewer_app_add_option_entries(G_GNUC_UNUSED VirtViewerApp *self,
           N_("Display version information"), NULL },
         { "zoom", 'z', 0, G_OPTION_ARG_INT, &opt_zoom,
           N_("Zoom level of window, in percentage"), "ZOOM" },
+        { "render-scale", '\0', 0, G_OPTION_ARG_INT, &opt_render_scale,
+          N_("Divide the guest resolution by this factor and scale it up locally"), "SCALE" },
+        { "profile", '\0', 0, G_OPTION_ARG_STRING, &opt_profile,
+          N_("Adjust the display settings to the network"), N_("<lan|wan|cellular>") },
         { "full-screen", 'f', 0, G_OPTION_ARG_NONE, &opt_fullscreen,
           N_("Open in full screen mode (adjusts guest resolution to fit the client)"), NULL },
         { "hotkeys", 'H', 0, G_OPTION_ARG_STRING, &opt_hotkeys,
@@ -2581,10 +3454,34 @@ virt_viewer_app_add_option_entries(G_GNUC_UNUSED VirtViewerApp *self,
           N_("Display verbose information"), NULL },
         { "debug", '\0', 0, G_OPTION_ARG_NONE, &opt_debug,
           N_("Display debugging information"), NULL },
+        { "probe", '\0', 0, G_OPTION_ARG_NONE, &opt_probe,
+          N_("Connect without any window, report the time to the first frame as JSON and exit"), NULL },
+        { "probe-timeout", '\0', 0, G_OPTION_ARG_INT, &opt_probe_timeout,
+          N_("Give up probing after this number of seconds"), "SECONDS" },
+#if defined(HAVE_SOCKETPAIR) && defined(HAVE_FORK)
+        { "broker-fd", '\0', 0, G_OPTION_ARG_INT, &opt_broker_fd,
+          N_("Get the connections to the display from the broker on this socket"), "FD" },
+#endif
+        { "dashboard", '\0', 0, G_OPTION_ARG_NONE, &opt_dashboard,
+          N_("Show every virtual machine as a thumbnail in a single window"), NULL },
+        { "load-test", '\0', 0, G_OPTION_ARG_INT, &opt_load_sessions,
+          N_("Open this number of sessions without any window and report their performance"), "SESSIONS" },
+        { "load-rate", '\0', 0, G_OPTION_ARG_INT, &opt_load_rate,
+          N_("Number of load test sessions opened per second"), "RATE" },
+        { "load-duration", '\0', 0, G_OPTION_ARG_INT, &opt_load_duration,
+          N_("Keep the load test sessions open for this number of seconds"), "SECONDS" },
+        { "load-script", '\0', 0, G_OPTION_ARG_FILENAME, &opt_load_script,
+          N_("Keys to press in every load test session"), "FILE" },
         { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
     };
 
     g_option_group_add_entries(group, options);
+#ifdef HAVE_GTK_VNC
+    virt_viewer_session_vnc_add_option_entries(group);
+#endif
+#ifdef HAVE_SPICE_GTK
+    virt_viewer_session_spice_add_option_entries(group);
+#endif
 }
 
 gboolean virt_viewer_app_get_session_cancelled(VirtViewerApp *self)
@@ -2592,6 +3489,341 @@ gboolean virt_viewer_app_get_session_cancelled(VirtViewerApp *self)
     return self->priv->cancelled;
 }
 
+/**
+ * virt_viewer_app_get_probe:
+ * @self: the application
+ *
+ * Returns: %TRUE when running with --probe, in which case no window
+ * should be shown
+ */
+gboolean virt_viewer_app_get_probe(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    return self->priv->probe;
+}
+
+/**
+ * virt_viewer_app_get_multi_session:
+ * @self: the application
+ *
+ * Returns: %TRUE when running with --dashboard or --load-test. The
+ * subclasses then add the connection files of every virtual machine with
+ * virt_viewer_app_add_session_file() and call
+ * virt_viewer_app_start_sessions() instead of opening their own session.
+ */
+gboolean virt_viewer_app_get_multi_session(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    return self->priv->load != NULL || self->priv->dashboard != NULL;
+}
+
+void virt_viewer_app_add_session_file(VirtViewerApp *self, const gchar *name, VirtViewerFile *file)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    if (self->priv->load != NULL)
+        virt_viewer_load_add_file(self->priv->load, name, file);
+    else if (self->priv->dashboard != NULL)
+        virt_viewer_dashboard_add_file(self->priv->dashboard, name, file);
+}
+
+gboolean virt_viewer_app_start_sessions(VirtViewerApp *self, GError **error)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    if (self->priv->load != NULL)
+        return virt_viewer_load_start(self->priv->load, error);
+    if (self->priv->dashboard != NULL)
+        return virt_viewer_dashboard_start(self->priv->dashboard, error);
+
+    g_return_val_if_reached(FALSE);
+}
+
+void virt_viewer_app_set_exit_status(VirtViewerApp *self, gint status)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+
+    self->priv->exit_status = status;
+}
+
+/**
+ * virt_viewer_app_get_exit_status:
+ * @self: the application
+ *
+ * Returns: the status the process should exit with once the application
+ * has run, non-zero when a --probe failed or timed out
+ */
+gint virt_viewer_app_get_exit_status(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 1);
+
+    return self->priv->exit_status;
+}
+
+/**
+ * virt_viewer_app_get_launch_time:
+ * @self: the application
+ *
+ * Returns: the monotonic time at which the application was created
+ */
+gint64 virt_viewer_app_get_launch_time(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 0);
+
+    return self->priv->launch_time;
+}
+
+/**
+ * virt_viewer_app_become_resident:
+ * @self: the application
+ * @error: return location for a #GError
+ *
+ * Registers the application as the unique instance that opens the
+ * connection files handed over with virt_viewer_app_open_in_launcher().
+ * Once started, it keeps running without any window. Must be called
+ * before the application is registered.
+ *
+ * Returns: %TRUE on success, %FALSE if another launcher is running
+ */
+gboolean virt_viewer_app_become_resident(VirtViewerApp *self, GError **error)
+{
+    GApplication *gapp = G_APPLICATION(self);
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+    g_return_val_if_fail(self->priv->launcher == NULL, FALSE);
+
+    /* set before registering, which starts the application */
+    self->priv->launcher = virt_viewer_launcher_new(self);
+    g_application_set_flags(gapp, G_APPLICATION_HANDLES_OPEN);
+    if (!g_application_register(gapp, NULL, error))
+        return FALSE;
+
+    if (g_application_get_is_remote(gapp)) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("A launcher is already running for %s"),
+                    g_application_get_application_id(gapp));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * virt_viewer_app_open_in_launcher:
+ * @self: the application
+ * @arg: the connection file or URI given on the command line
+ *
+ * Hands @arg over to the resident launcher, if one is running. The
+ * application must not be registered yet, and has nothing left to do once
+ * this succeeded. With --probe, this waits for the report of the launcher,
+ * prints it and sets the exit status accordingly.
+ *
+ * Returns: %TRUE if the launcher took the request
+ */
+gboolean virt_viewer_app_open_in_launcher(VirtViewerApp *self, const gchar *arg)
+{
+    GApplication *gapp = G_APPLICATION(self);
+    GDBusConnection *bus;
+    GVariant *reply = NULL;
+    GError *error = NULL;
+    gboolean running = FALSE;
+    GFile *file;
+    gchar *hint;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    bus = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+    if (bus != NULL)
+        reply = g_dbus_connection_call_sync(bus, "org.freedesktop.DBus",
+                                            "/org/freedesktop/DBus",
+                                            "org.freedesktop.DBus", "NameHasOwner",
+                                            g_variant_new("(s)", g_application_get_application_id(gapp)),
+                                            G_VARIANT_TYPE("(b)"), G_DBUS_CALL_FLAGS_NONE,
+                                            -1, NULL, &error);
+    if (reply != NULL) {
+        g_variant_get(reply, "(b)", &running);
+        g_variant_unref(reply);
+    }
+    if (!running) {
+        g_debug("No launcher running%s%s, starting normally",
+                error ? ": " : "", error ? error->message : "");
+        g_clear_error(&error);
+        g_clear_object(&bus);
+        return FALSE;
+    }
+
+    file = g_file_new_for_commandline_arg(arg);
+    hint = virt_viewer_launcher_hint_new(self->priv->launch_time, MAX(opt_probe_timeout, 1));
+
+    if (opt_probe) {
+        gint status = virt_viewer_launcher_probe(bus, g_application_get_application_id(gapp),
+                                                 file, hint, MAX(opt_probe_timeout, 1), &error);
+
+        if (status < 0) {
+            /* the launcher just quit, nothing was probed yet */
+            if (g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN)) {
+                g_debug("The launcher is gone, starting normally");
+                running = FALSE;
+            } else {
+                g_dbus_error_strip_remote_error(error);
+                g_printerr(_("The launcher didn't answer: %s\n"), error->message);
+                status = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT) ?
+                    PROBE_STATUS_TIMEOUT : PROBE_STATUS_FAILED;
+            }
+            g_clear_error(&error);
+        }
+        if (running)
+            self->priv->exit_status = status;
+        goto end;
+    }
+
+    /* never become the primary instance, even if the launcher just quit */
+    g_application_set_flags(gapp, G_APPLICATION_IS_LAUNCHER | G_APPLICATION_HANDLES_OPEN);
+    if (!g_application_register(gapp, NULL, &error)) {
+        g_debug("Couldn't reach the launcher: %s", error->message);
+        g_clear_error(&error);
+        running = FALSE;
+        goto end;
+    }
+
+    g_application_open(gapp, &file, 1, hint);
+    g_dbus_connection_flush_sync(bus, NULL, NULL);
+    g_debug("Handed %s over to the launcher", arg);
+
+end:
+    g_free(hint);
+    g_object_unref(file);
+    g_object_unref(bus);
+
+    return running;
+}
+
+/**
+ * virt_viewer_app_get_render_scale:
+ * @self: the application
+ *
+ * Returns the factor by which the client monitor geometry is divided before
+ * being requested from the guest. The guest display is scaled back up
+ * locally, trading sharpness for bandwidth and guest rendering cost.
+ *
+ * An explicit value set with virt_viewer_app_set_render_scale() (from the
+ * command line or the connection file) takes precedence over the
+ * "render-scale" key of the guest or fallback group of the settings file.
+ * With --adaptive-quality=2, the Spice session raises it above both while
+ * the quality is lowest, and sets back the previous value afterwards.
+ *
+ * Returns: the render scale, 1 meaning no scaling
+ */
+guint virt_viewer_app_get_render_scale(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), 1);
+
+    if (self->priv->render_scale > 0)
+        return self->priv->render_scale;
+    if (self->priv->config_render_scale > 0)
+        return self->priv->config_render_scale;
+    return 1;
+}
+
+void virt_viewer_app_set_render_scale(VirtViewerApp *self, guint scale)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(scale <= MAX_RENDER_SCALE);
+
+    self->priv->render_scale = scale;
+}
+
+/**
+ * virt_viewer_app_get_guest_setting:
+ * @self: the application
+ * @key: the settings key
+ *
+ * Looks up @key in the settings group of the current guest. Settings
+ * stored this way are remembered by the viewer itself, from one connection
+ * to the same guest to the next.
+ *
+ * Returns: (transfer full): the value of @key, or %NULL if it is not set
+ * or the guest UUID is not known yet
+ */
+gchar *virt_viewer_app_get_guest_setting(VirtViewerApp *self, const gchar *key)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+    g_return_val_if_fail(key != NULL, NULL);
+
+    if (self->priv->uuid == NULL)
+        return NULL;
+
+    return g_key_file_get_string(virt_viewer_settings_get_guest(self->priv->settings, self->priv->uuid),
+                                 self->priv->uuid, key, NULL);
+}
+
+void virt_viewer_app_set_guest_setting(VirtViewerApp *self, const gchar *key, const gchar *value)
+{
+    GKeyFile *config;
+
+    g_return_if_fail(VIRT_VIEWER_IS_APP(self));
+    g_return_if_fail(key != NULL);
+
+    if (self->priv->uuid == NULL)
+        return;
+
+    config = virt_viewer_settings_get_guest(self->priv->settings, self->priv->uuid);
+    if (value != NULL)
+        g_key_file_set_string(config, self->priv->uuid, key, value);
+    else if (!g_key_file_remove_key(config, self->priv->uuid, key, NULL))
+        return;
+
+    // name the settings group after the vm so user can make sense of it later
+    virt_viewer_settings_set_guest_name(self->priv->settings, self->priv->uuid,
+                                        self->priv->guest_name);
+    virt_viewer_settings_changed(self->priv->settings, self->priv->uuid);
+}
+
+/**
+ * virt_viewer_app_get_profile:
+ * @self: the application
+ *
+ * Returns the connection profile, a bundle of display settings suited to a
+ * type of network. The sessions apply it when opening a connection, and the
+ * individual settings of the connection file and of the command line take
+ * precedence over it.
+ *
+ * An explicit profile set with virt_viewer_app_set_profile() takes
+ * precedence over the "profile" key of the guest or fallback group of the
+ * settings file.
+ *
+ * Returns: the profile, or %NULL if none is used
+ */
+const VirtViewerProfile *virt_viewer_app_get_profile(VirtViewerApp *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), NULL);
+
+    if (self->priv->profile != NULL)
+        return self->priv->profile;
+    return self->priv->config_profile;
+}
+
+gboolean virt_viewer_app_set_profile(VirtViewerApp *self, const gchar *name, GError **error)
+{
+    const VirtViewerProfile *profile = NULL;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_APP(self), FALSE);
+
+    if (name != NULL) {
+        profile = virt_viewer_profile_lookup(name);
+        if (profile == NULL) {
+            g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        _("Unknown profile: %s"), name);
+            return FALSE;
+        }
+    }
+
+    self->priv->profile = profile;
+    return TRUE;
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -25,10 +25,13 @@
 
 #include <glib-object.h>
 #include <gtk/gtk.h>
+#include "virt-viewer-util.h"
 #include "virt-viewer-window.h"
 
 G_BEGIN_DECLS
 
+#define MAX_RENDER_SCALE 4
+
 #define VIRT_VIEWER_TYPE_APP virt_viewer_app_get_type()
 #define VIRT_VIEWER_APP(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), VIRT_VIEWER_TYPE_APP, VirtViewerApp))
 #define VIRT_VIEWER_APP_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass), VIRT_VIEWER_TYPE_APP, VirtViewerAppClass))
@@ -59,6 +62,7 @@ GType virt_viewer_app_get_type (void);
 
 void virt_viewer_app_set_debug(gboolean debug);
 gboolean virt_viewer_app_start(VirtViewerApp *app, GError **error);
+void virt_viewer_app_start_failed(VirtViewerApp *self, const GError *error);
 void virt_viewer_app_maybe_quit(VirtViewerApp *self, VirtViewerWindow *window);
 VirtViewerWindow* virt_viewer_app_get_main_window(VirtViewerApp *self);
 void virt_viewer_app_trace(VirtViewerApp *self, const char *fmt, ...);
@@ -73,6 +77,8 @@ void virt_viewer_app_set_direct(VirtViewerApp *self, gboolean direct);
 void virt_viewer_app_set_hotkeys(VirtViewerApp *self, const gchar *hotkeys);
 void virt_viewer_app_set_attach(VirtViewerApp *self, gboolean attach);
 gboolean virt_viewer_app_get_attach(VirtViewerApp *self);
+void virt_viewer_app_set_reconnect(VirtViewerApp *self, gboolean reconnect);
+void virt_viewer_app_set_disconnect_reason(VirtViewerApp *self, const gchar *reason);
 gboolean virt_viewer_app_has_session(VirtViewerApp *self);
 void virt_viewer_app_set_connect_info(VirtViewerApp *self,
                                       const gchar *host,
@@ -98,6 +104,22 @@ void virt_viewer_app_set_enable_accel(VirtViewerApp *app, gboolean enable);
 void virt_viewer_app_show_preferences(VirtViewerApp *app, GtkWidget *parent);
 void virt_viewer_app_set_menus_sensitive(VirtViewerApp *self, gboolean sensitive);
 gboolean virt_viewer_app_get_session_cancelled(VirtViewerApp *self);
+guint virt_viewer_app_get_render_scale(VirtViewerApp *self);
+void virt_viewer_app_set_render_scale(VirtViewerApp *self, guint scale);
+gchar *virt_viewer_app_get_guest_setting(VirtViewerApp *self, const gchar *key);
+void virt_viewer_app_set_guest_setting(VirtViewerApp *self, const gchar *key, const gchar *value);
+const VirtViewerProfile *virt_viewer_app_get_profile(VirtViewerApp *self);
+gboolean virt_viewer_app_set_profile(VirtViewerApp *self, const gchar *name, GError **error);
+gboolean virt_viewer_app_get_probe(VirtViewerApp *self);
+gint virt_viewer_app_get_exit_status(VirtViewerApp *self);
+void virt_viewer_app_set_exit_status(VirtViewerApp *self, gint status);
+VirtViewerSession *virt_viewer_app_new_session(VirtViewerApp *self, const gchar *type, GError **error);
+gboolean virt_viewer_app_get_multi_session(VirtViewerApp *self);
+void virt_viewer_app_add_session_file(VirtViewerApp *self, const gchar *name, VirtViewerFile *file);
+gboolean virt_viewer_app_start_sessions(VirtViewerApp *self, GError **error);
+gint64 virt_viewer_app_get_launch_time(VirtViewerApp *self);
+gboolean virt_viewer_app_become_resident(VirtViewerApp *self, GError **error);
+gboolean virt_viewer_app_open_in_launcher(VirtViewerApp *self, const gchar *arg);
 
 G_END_DECLS
 
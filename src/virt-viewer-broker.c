@@ -0,0 +1,373 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gi18n.h>
+#include <gio/gunixfdmessage.h>
+
+#include "virt-viewer-broker.h"
+#include "virt-viewer-util.h"
+
+/*
+ * Client of the connection broker given with --broker-fd. For each
+ * channel, a line "open-fd CHANNEL ID plain|tls" is written to the broker,
+ * which answers with a line "ok" carrying the socket already connected to
+ * the server as SCM_RIGHTS ancillary data, or with a line "error MESSAGE".
+ *
+ * The exchange runs from the main loop, so that a slow broker does not
+ * freeze the windows. The requests are answered in order, one at a time,
+ * each of them within BROKER_TIMEOUT seconds. A broker which timed out,
+ * closed the socket or answered garbage is out of sync for good: the
+ * requests pending and any later one fail with the same error.
+ */
+#define BROKER_TIMEOUT 10
+#define BROKER_REPLY_MAX 256
+
+struct _VirtViewerBroker {
+    GSocket *socket;
+    GQueue *requests; /* of GTask, the head one is on the wire */
+    GSource *source; /* waiting for the socket, for the head request */
+    guint timeout_id;
+    GError *error; /* once the exchange broke */
+};
+
+typedef struct {
+    gchar *channel;
+    gchar *line;
+    gsize sent;
+    GString *reply;
+    int fd;
+} BrokerRequest;
+
+static void broker_next(VirtViewerBroker *self);
+static gboolean broker_ready(GSocket *socket, GIOCondition condition, gpointer opaque);
+
+static void
+broker_request_free(BrokerRequest *req)
+{
+    if (req->fd >= 0)
+        close(req->fd);
+    g_string_free(req->reply, TRUE);
+    g_free(req->line);
+    g_free(req->channel);
+    g_free(req);
+}
+
+static void
+broker_stop_waiting(VirtViewerBroker *self)
+{
+    if (self->source != NULL) {
+        g_source_destroy(self->source);
+        g_source_unref(self->source);
+        self->source = NULL;
+    }
+    if (self->timeout_id != 0) {
+        g_source_remove(self->timeout_id);
+        self->timeout_id = 0;
+    }
+}
+
+/* Answers the head request and goes on with the next one */
+static void
+broker_answer(VirtViewerBroker *self, int fd, GError *error)
+{
+    GTask *task = g_queue_pop_head(self->requests);
+
+    broker_stop_waiting(self);
+    if (error != NULL)
+        g_task_return_error(task, error);
+    else
+        g_task_return_int(task, fd);
+    g_object_unref(task);
+
+    broker_next(self);
+}
+
+/* The exchange is out of sync, fails every request */
+static void
+broker_break(VirtViewerBroker *self, GError *error)
+{
+    g_debug("The connection broker is unusable: %s", error->message);
+    self->error = error;
+    while (!g_queue_is_empty(self->requests))
+        broker_answer(self, -1, g_error_copy(self->error));
+}
+
+static gboolean
+broker_timeout(gpointer opaque)
+{
+    VirtViewerBroker *self = opaque;
+
+    self->timeout_id = 0;
+    broker_break(self, g_error_new(G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                                   _("The connection broker didn't answer")));
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Returns FALSE once the whole reply line was received */
+static gboolean
+broker_receive(VirtViewerBroker *self, BrokerRequest *req, GError **error)
+{
+    gchar buf[BROKER_REPLY_MAX];
+    GInputVector vector = { buf, sizeof(buf) };
+    GSocketControlMessage **messages = NULL;
+    gint n_messages = 0, i;
+    gint flags = 0;
+    gssize n;
+
+    n = g_socket_receive_message(self->socket, NULL, &vector, 1,
+                                 &messages, &n_messages, &flags, NULL, error);
+    if (n < 0)
+        return TRUE;
+
+    for (i = 0; i < n_messages; i++) {
+        if (G_IS_UNIX_FD_MESSAGE(messages[i])) {
+            gint n_fds, j;
+            gint *fds = g_unix_fd_message_steal_fds(G_UNIX_FD_MESSAGE(messages[i]), &n_fds);
+
+            for (j = 0; j < n_fds; j++) {
+                if (req->fd < 0)
+                    req->fd = fds[j];
+                else
+                    close(fds[j]);
+            }
+            g_free(fds);
+        }
+        g_object_unref(messages[i]);
+    }
+    g_free(messages);
+
+    if (n == 0) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_CLOSED,
+                            _("Reading from the connection broker failed: connection closed"));
+        return TRUE;
+    }
+    g_string_append_len(req->reply, buf, n);
+    if (memchr(buf, '\n', n) != NULL)
+        return FALSE;
+    if (req->reply->len >= BROKER_REPLY_MAX) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Invalid answer from the connection broker"));
+        return TRUE;
+    }
+
+    return TRUE;
+}
+
+static void
+broker_wait(VirtViewerBroker *self, GIOCondition condition)
+{
+    self->source = g_socket_create_source(self->socket, condition, NULL);
+    g_source_set_callback(self->source, (GSourceFunc)broker_ready, self, NULL);
+    g_source_attach(self->source, NULL);
+}
+
+/* Handles the reply line to the head request */
+static void
+broker_reply(VirtViewerBroker *self, BrokerRequest *req)
+{
+    gchar *line = g_strndup(req->reply->str, strcspn(req->reply->str, "\n"));
+
+    g_strchomp(line);
+    if (g_str_equal(line, "ok") && req->fd >= 0) {
+        int fd = req->fd;
+
+        req->fd = -1;
+        broker_answer(self, fd, NULL);
+    } else if (g_str_has_prefix(line, "error ")) {
+        broker_answer(self, -1,
+                      g_error_new(VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                  _("The connection broker refused the %s channel: %s"),
+                                  req->channel, line + 6));
+    } else {
+        broker_break(self, g_error_new_literal(VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                               _("Invalid answer from the connection broker")));
+    }
+    g_free(line);
+}
+
+static gboolean
+broker_ready(GSocket *socket G_GNUC_UNUSED,
+             GIOCondition condition G_GNUC_UNUSED,
+             gpointer opaque)
+{
+    VirtViewerBroker *self = opaque;
+    BrokerRequest *req = g_task_get_task_data(g_queue_peek_head(self->requests));
+    gsize len = strlen(req->line);
+    GError *error = NULL;
+
+    /* this source is done, the next step waits with a new one */
+    g_source_unref(self->source);
+    self->source = NULL;
+
+    if (req->sent < len) {
+        gssize n = g_socket_send(self->socket, req->line + req->sent, len - req->sent,
+                                 NULL, &error);
+
+        if (n >= 0)
+            req->sent += n;
+    } else if (!broker_receive(self, req, &error)) {
+        broker_reply(self, req);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (error != NULL && !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+        broker_break(self, error);
+        return G_SOURCE_REMOVE;
+    }
+    g_clear_error(&error);
+
+    broker_wait(self, req->sent < len ? G_IO_OUT : G_IO_IN);
+    return G_SOURCE_REMOVE;
+}
+
+/* Puts the head request on the wire, unless one is already */
+static void
+broker_next(VirtViewerBroker *self)
+{
+    BrokerRequest *req;
+
+    if (self->error != NULL || self->timeout_id != 0 || g_queue_is_empty(self->requests))
+        return;
+
+    req = g_task_get_task_data(g_queue_peek_head(self->requests));
+    g_debug("Asking the connection broker: %.*s", (int)strlen(req->line) - 1, req->line);
+    self->timeout_id = g_timeout_add_seconds(BROKER_TIMEOUT, broker_timeout, self);
+    broker_wait(self, G_IO_OUT);
+}
+
+/**
+ * virt_viewer_broker_new:
+ * @fd: the UNIX socket connected to the broker, which the broker owns from
+ * now on
+ * @error: return location for a #GError
+ *
+ * Returns: (transfer full): a new broker client, or %NULL on error
+ */
+VirtViewerBroker *
+virt_viewer_broker_new(int fd, GError **error)
+{
+    VirtViewerBroker *self;
+    GSocket *socket = g_socket_new_from_fd(fd, error);
+
+    if (socket == NULL)
+        return NULL;
+
+    g_socket_set_blocking(socket, FALSE);
+    self = g_new0(VirtViewerBroker, 1);
+    self->socket = socket;
+    self->requests = g_queue_new();
+
+    return self;
+}
+
+void
+virt_viewer_broker_free(VirtViewerBroker *self)
+{
+    GTask *task;
+
+    if (self == NULL)
+        return;
+
+    broker_stop_waiting(self);
+    while ((task = g_queue_pop_head(self->requests)) != NULL) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                _("The connection broker was closed"));
+        g_object_unref(task);
+    }
+    g_queue_free(self->requests);
+    g_clear_error(&self->error);
+    g_object_unref(self->socket);
+    g_free(self);
+}
+
+/**
+ * virt_viewer_broker_open_fd_async:
+ * @self: the broker
+ * @channel: the Spice channel type, such as "main" or "display"
+ * @id: the channel id
+ * @tls: whether the channel expects the TLS port
+ * @callback: called with the socket, see virt_viewer_broker_open_fd_finish()
+ * @user_data: data for @callback
+ *
+ * Asks the broker for a socket connected to the server for a channel,
+ * after the requests made before this one were answered.
+ */
+void
+virt_viewer_broker_open_fd_async(VirtViewerBroker *self,
+                                 const gchar *channel,
+                                 gint id,
+                                 gboolean tls,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+    GTask *task = g_task_new(NULL, NULL, callback, user_data);
+    BrokerRequest *req = g_new0(BrokerRequest, 1);
+
+    g_task_set_source_tag(task, virt_viewer_broker_open_fd_async);
+    req->channel = g_strdup(channel);
+    req->line = g_strdup_printf("open-fd %s %d %s\n", channel, id, tls ? "tls" : "plain");
+    req->reply = g_string_new(NULL);
+    req->fd = -1;
+    g_task_set_task_data(task, req, (GDestroyNotify)broker_request_free);
+
+    if (self->error != NULL) {
+        g_task_return_error(task, g_error_copy(self->error));
+        g_object_unref(task);
+        return;
+    }
+
+    g_queue_push_tail(self->requests, task);
+    broker_next(self);
+}
+
+/**
+ * virt_viewer_broker_open_fd_finish:
+ * @self: the broker
+ * @result: the result passed to the callback
+ * @error: return location for a #GError
+ *
+ * Returns: the socket connected to the server, owned by the caller, or -1
+ * on error
+ */
+int
+virt_viewer_broker_open_fd_finish(VirtViewerBroker *self G_GNUC_UNUSED,
+                                  GAsyncResult *result,
+                                  GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), -1);
+
+    return g_task_propagate_int(G_TASK(result), error);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
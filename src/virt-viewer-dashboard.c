@@ -0,0 +1,509 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <config.h>
+
+#include <math.h>
+#include <glib/gi18n.h>
+
+#include "virt-viewer-dashboard.h"
+#include "virt-viewer-session.h"
+#include "virt-viewer-util.h"
+#ifdef HAVE_SPICE_GTK
+#include "virt-viewer-session-spice.h"
+#endif
+
+/*
+ * Dashboard: a single window showing every virtual machine as a small
+ * thumbnail, all sessions living in this process. The display widgets are
+ * kept out of any toplevel until a tile is double-clicked, so they are not
+ * drawn at all; the tiles only copy a scaled down frame every
+ * DASHBOARD_REFRESH_INTERVAL seconds. A promoted tile gets its own
+ * VirtViewerWindow, and goes back to the grid when that window is closed.
+ */
+#define DASHBOARD_REFRESH_INTERVAL 2
+#define DASHBOARD_TILE_WIDTH 240
+#define DASHBOARD_TILE_HEIGHT 180
+
+typedef struct {
+    VirtViewerDashboard *dashboard;
+    gchar *name;
+    VirtViewerFile *file;
+    VirtViewerSession *session;
+    VirtViewerDisplay *display;
+    VirtViewerWindow *window;
+
+    GtkWidget *box;
+    GtkWidget *image;
+    GtkWidget *label;
+} DashboardTile;
+
+struct _VirtViewerDashboard {
+    VirtViewerApp *app;
+    GPtrArray *tiles;
+    GtkWidget *window;
+    guint refresh_id;
+};
+
+static void
+dashboard_tile_set_status(DashboardTile *tile, const gchar *status)
+{
+    gchar *text;
+
+    if (status == NULL) {
+        gtk_label_set_text(GTK_LABEL(tile->label), tile->name);
+        return;
+    }
+
+    text = g_strdup_printf("%s: %s", tile->name, status);
+    gtk_label_set_text(GTK_LABEL(tile->label), text);
+    g_free(text);
+}
+
+static void
+dashboard_tile_refresh(DashboardTile *tile)
+{
+    GdkPixbuf *pixbuf, *thumbnail;
+    gint width, height;
+    gdouble scale;
+
+    /* a promoted tile is already visible in full size */
+    if (tile->display == NULL || tile->window != NULL ||
+        !(virt_viewer_display_get_show_hint(tile->display) & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY))
+        return;
+
+    pixbuf = virt_viewer_display_get_pixbuf(tile->display);
+    if (pixbuf == NULL)
+        return;
+
+    width = gdk_pixbuf_get_width(pixbuf);
+    height = gdk_pixbuf_get_height(pixbuf);
+    scale = MIN((gdouble)DASHBOARD_TILE_WIDTH / width,
+                (gdouble)DASHBOARD_TILE_HEIGHT / height);
+    thumbnail = gdk_pixbuf_scale_simple(pixbuf,
+                                        MAX(width * scale, 1),
+                                        MAX(height * scale, 1),
+                                        GDK_INTERP_BILINEAR);
+    gtk_image_set_from_pixbuf(GTK_IMAGE(tile->image), thumbnail);
+    g_object_unref(thumbnail);
+    g_object_unref(pixbuf);
+}
+
+static gboolean
+dashboard_refresh(gpointer opaque)
+{
+    VirtViewerDashboard *self = opaque;
+    guint i;
+
+    for (i = 0; i < self->tiles->len; i++)
+        dashboard_tile_refresh(g_ptr_array_index(self->tiles, i));
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+dashboard_window_unref(gpointer opaque)
+{
+    g_object_unref(opaque);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+dashboard_tile_demote(DashboardTile *tile)
+{
+    VirtViewerWindow *window = tile->window;
+
+    if (window == NULL)
+        return;
+
+    g_debug("dashboard: %s back to its tile", tile->name);
+    tile->window = NULL;
+
+    /* keep the display enabled, the guest must not see its monitor go away */
+    virt_viewer_window_hide(window);
+    virt_viewer_window_set_display(window, NULL);
+    gtk_application_remove_window(GTK_APPLICATION(tile->dashboard->app),
+                                  virt_viewer_window_get_window(window));
+    /* this may run from a signal handler of the window */
+    g_idle_add(dashboard_window_unref, window);
+
+    dashboard_tile_refresh(tile);
+}
+
+static void
+dashboard_tile_promote(DashboardTile *tile)
+{
+    gchar *uuid = NULL;
+
+    if (tile->window != NULL) {
+        gtk_window_present(virt_viewer_window_get_window(tile->window));
+        return;
+    }
+    if (tile->display == NULL)
+        return;
+
+    g_debug("dashboard: %s promoted to a window", tile->name);
+    tile->window = g_object_new(VIRT_VIEWER_TYPE_WINDOW, "app", tile->dashboard->app, NULL);
+    g_object_set(tile->window, "subtitle", tile->name, NULL);
+    gtk_application_add_window(GTK_APPLICATION(tile->dashboard->app),
+                               virt_viewer_window_get_window(tile->window));
+    virt_viewer_window_set_display(tile->window, tile->display);
+    /* the menus act on the session of the tile, not on the application's */
+    if (tile->file != NULL)
+        uuid = virt_viewer_file_get_ovirt_vm_guid(tile->file);
+    virt_viewer_window_set_guest(tile->window, tile->name, uuid);
+    virt_viewer_window_set_usb_options_sensitive(tile->window,
+                                                 virt_viewer_session_get_has_usbredir(tile->session));
+    virt_viewer_window_show(tile->window);
+    g_free(uuid);
+}
+
+static gboolean
+dashboard_tile_button_press(GtkWidget *widget G_GNUC_UNUSED,
+                            GdkEventButton *event,
+                            DashboardTile *tile)
+{
+    if (event->type != GDK_2BUTTON_PRESS || event->button != 1)
+        return FALSE;
+
+    dashboard_tile_promote(tile);
+    return TRUE;
+}
+
+/* the session keeps the display, which must stop notifying the tile */
+static void
+dashboard_tile_drop_display(DashboardTile *tile)
+{
+    dashboard_tile_demote(tile);
+    if (tile->display != NULL)
+        g_signal_handlers_disconnect_by_data(tile->display, tile);
+    g_clear_object(&tile->display);
+}
+
+static void
+dashboard_tile_fail(DashboardTile *tile, const gchar *msg)
+{
+    g_debug("dashboard: %s failed: %s", tile->name, msg);
+    dashboard_tile_drop_display(tile);
+    gtk_image_clear(GTK_IMAGE(tile->image));
+    dashboard_tile_set_status(tile, msg);
+}
+
+static void
+dashboard_tile_show_hint(VirtViewerDisplay *display G_GNUC_UNUSED,
+                         GParamSpec *pspec G_GNUC_UNUSED,
+                         DashboardTile *tile)
+{
+    dashboard_tile_refresh(tile);
+}
+
+static void
+dashboard_tile_display_added(VirtViewerSession *session G_GNUC_UNUSED,
+                             VirtViewerDisplay *display,
+                             DashboardTile *tile)
+{
+    /* only the first monitor of each guest is shown */
+    if (tile->display != NULL)
+        return;
+
+    tile->display = g_object_ref(display);
+    g_signal_connect(display, "notify::show-hint",
+                     G_CALLBACK(dashboard_tile_show_hint), tile);
+    dashboard_tile_set_status(tile, NULL);
+    dashboard_tile_refresh(tile);
+}
+
+static void
+dashboard_tile_display_removed(VirtViewerSession *session G_GNUC_UNUSED,
+                               VirtViewerDisplay *display,
+                               DashboardTile *tile)
+{
+    if (tile->display != display)
+        return;
+
+    dashboard_tile_drop_display(tile);
+    gtk_image_clear(GTK_IMAGE(tile->image));
+}
+
+static void
+dashboard_tile_disconnected(VirtViewerSession *session G_GNUC_UNUSED,
+                            const gchar *msg,
+                            DashboardTile *tile)
+{
+    dashboard_tile_fail(tile, msg ? msg : _("Disconnected from the graphic server"));
+}
+
+static void
+dashboard_tile_auth_failed(VirtViewerSession *session G_GNUC_UNUSED,
+                           const gchar *msg,
+                           DashboardTile *tile)
+{
+    dashboard_tile_fail(tile, msg ? msg : _("Authentication failed"));
+}
+
+static void
+dashboard_tile_cancelled(VirtViewerSession *session G_GNUC_UNUSED,
+                         DashboardTile *tile)
+{
+    dashboard_tile_fail(tile, _("Cancelled"));
+}
+
+static void
+dashboard_tile_open(DashboardTile *tile)
+{
+    GError *error = NULL;
+    gchar *type = virt_viewer_file_get_file_type(tile->file);
+
+    if (type == NULL) {
+        dashboard_tile_fail(tile, _("Cannot determine the connection type"));
+        return;
+    }
+
+    tile->session = virt_viewer_app_new_session(tile->dashboard->app, type, &error);
+    g_free(type);
+    if (tile->session == NULL) {
+        dashboard_tile_fail(tile, error->message);
+        g_clear_error(&error);
+        return;
+    }
+
+    g_signal_connect(tile->session, "session-disconnected",
+                     G_CALLBACK(dashboard_tile_disconnected), tile);
+    g_signal_connect(tile->session, "session-auth-refused",
+                     G_CALLBACK(dashboard_tile_auth_failed), tile);
+    g_signal_connect(tile->session, "session-auth-unsupported",
+                     G_CALLBACK(dashboard_tile_auth_failed), tile);
+    g_signal_connect(tile->session, "session-cancelled",
+                     G_CALLBACK(dashboard_tile_cancelled), tile);
+    g_signal_connect(tile->session, "session-display-added",
+                     G_CALLBACK(dashboard_tile_display_added), tile);
+    g_signal_connect(tile->session, "session-display-removed",
+                     G_CALLBACK(dashboard_tile_display_removed), tile);
+
+    dashboard_tile_set_status(tile, _("Connecting"));
+    virt_viewer_session_set_file(tile->session, tile->file);
+    if (!virt_viewer_session_open_uri(tile->session, tile->name, &error)) {
+        dashboard_tile_fail(tile, error ? error->message : _("Failed to initiate connection"));
+        g_clear_error(&error);
+        return;
+    }
+
+#ifdef HAVE_SPICE_GTK
+    /* the channels are created once connected, a tile has no use for these */
+    if (VIRT_VIEWER_IS_SESSION_SPICE(tile->session)) {
+        SpiceSession *spice = NULL;
+
+        g_object_get(tile->session, "spice-session", &spice, NULL);
+        if (spice != NULL) {
+            g_object_set(spice, "enable-audio", FALSE, "enable-usbredir", FALSE, NULL);
+            g_object_unref(spice);
+        }
+    }
+#endif
+}
+
+static void
+dashboard_tile_free(DashboardTile *tile)
+{
+    dashboard_tile_drop_display(tile);
+    if (tile->session != NULL)
+        g_signal_handlers_disconnect_by_data(tile->session, tile);
+    g_clear_object(&tile->session);
+    g_object_unref(tile->file);
+    g_free(tile->name);
+    g_free(tile);
+}
+
+static gboolean
+dashboard_delete(GtkWidget *widget G_GNUC_UNUSED,
+                 GdkEvent *event G_GNUC_UNUSED,
+                 VirtViewerDashboard *self)
+{
+    guint i;
+
+    g_debug("dashboard: closed");
+    for (i = 0; i < self->tiles->len; i++) {
+        DashboardTile *tile = g_ptr_array_index(self->tiles, i);
+
+        dashboard_tile_demote(tile);
+        if (tile->session != NULL) {
+            g_signal_handlers_disconnect_by_data(tile->session, tile);
+            virt_viewer_session_close(tile->session);
+        }
+    }
+    g_application_quit(G_APPLICATION(self->app));
+
+    return TRUE;
+}
+
+/**
+ * virt_viewer_dashboard_new:
+ * @app: the application the sessions belong to
+ *
+ * Returns: a new dashboard, showing the virtual machines added with
+ * virt_viewer_dashboard_add_file()
+ */
+VirtViewerDashboard *
+virt_viewer_dashboard_new(VirtViewerApp *app)
+{
+    VirtViewerDashboard *self = g_new0(VirtViewerDashboard, 1);
+
+    self->app = app;
+    self->tiles = g_ptr_array_new_with_free_func((GDestroyNotify)dashboard_tile_free);
+
+    return self;
+}
+
+void
+virt_viewer_dashboard_free(VirtViewerDashboard *self)
+{
+    if (self == NULL)
+        return;
+
+    if (self->refresh_id != 0)
+        g_source_remove(self->refresh_id);
+    g_ptr_array_unref(self->tiles);
+    if (self->window != NULL)
+        gtk_widget_destroy(self->window);
+    g_free(self);
+}
+
+void
+virt_viewer_dashboard_add_file(VirtViewerDashboard *self, const gchar *name, VirtViewerFile *file)
+{
+    DashboardTile *tile = g_new0(DashboardTile, 1);
+
+    tile->dashboard = self;
+    tile->name = g_strdup(name);
+    tile->file = g_object_ref(file);
+    g_ptr_array_add(self->tiles, tile);
+}
+
+/**
+ * virt_viewer_dashboard_start:
+ * @self: the dashboard
+ * @error: return location for a #GError
+ *
+ * Shows the dashboard window and opens a session to every virtual machine.
+ *
+ * Returns: %TRUE if the dashboard is shown
+ */
+gboolean
+virt_viewer_dashboard_start(VirtViewerDashboard *self, GError **error)
+{
+    GtkWidget *scroll, *grid;
+    guint i, columns;
+
+    g_return_val_if_fail(self->window == NULL, FALSE);
+
+    if (self->tiles->len == 0) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("No virtual machine to connect to"));
+        return FALSE;
+    }
+
+    self->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(self->window), g_get_application_name());
+    g_signal_connect(self->window, "delete-event",
+                     G_CALLBACK(dashboard_delete), self);
+
+    scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scroll),
+                                   GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_container_add(GTK_CONTAINER(self->window), scroll);
+
+    grid = gtk_grid_new();
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 6);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
+    gtk_container_set_border_width(GTK_CONTAINER(grid), 6);
+    gtk_container_add(GTK_CONTAINER(scroll), grid);
+
+    columns = MAX((guint)ceil(sqrt(self->tiles->len)), 1);
+    for (i = 0; i < self->tiles->len; i++) {
+        DashboardTile *tile = g_ptr_array_index(self->tiles, i);
+        GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 3);
+
+        tile->box = gtk_event_box_new();
+        tile->image = gtk_image_new();
+        gtk_widget_set_size_request(tile->image, DASHBOARD_TILE_WIDTH, DASHBOARD_TILE_HEIGHT);
+        tile->label = gtk_label_new(tile->name);
+        gtk_label_set_ellipsize(GTK_LABEL(tile->label), PANGO_ELLIPSIZE_END);
+        gtk_widget_set_tooltip_text(tile->box, _("Double-click to open"));
+
+        gtk_box_pack_start(GTK_BOX(vbox), tile->image, FALSE, FALSE, 0);
+        gtk_box_pack_start(GTK_BOX(vbox), tile->label, FALSE, FALSE, 0);
+        gtk_container_add(GTK_CONTAINER(tile->box), vbox);
+        g_signal_connect(tile->box, "button-press-event",
+                         G_CALLBACK(dashboard_tile_button_press), tile);
+        gtk_grid_attach(GTK_GRID(grid), tile->box, i % columns, i / columns, 1, 1);
+    }
+
+    gtk_window_set_default_size(GTK_WINDOW(self->window),
+                                MIN(columns, 4) * (DASHBOARD_TILE_WIDTH + 6) + 24,
+                                MIN(columns, 3) * (DASHBOARD_TILE_HEIGHT + 30) + 12);
+    gtk_application_add_window(GTK_APPLICATION(self->app), GTK_WINDOW(self->window));
+    gtk_widget_show_all(self->window);
+
+    g_debug("dashboard: opening %u sessions", self->tiles->len);
+    for (i = 0; i < self->tiles->len; i++)
+        dashboard_tile_open(g_ptr_array_index(self->tiles, i));
+
+    self->refresh_id = g_timeout_add_seconds(DASHBOARD_REFRESH_INTERVAL,
+                                             dashboard_refresh, self);
+
+    return TRUE;
+}
+
+/**
+ * virt_viewer_dashboard_demote:
+ * @self: the dashboard
+ * @window: a window being closed
+ *
+ * Brings a window promoted from a tile back to the dashboard.
+ *
+ * Returns: %TRUE if @window was promoted from the dashboard
+ */
+gboolean
+virt_viewer_dashboard_demote(VirtViewerDashboard *self, VirtViewerWindow *window)
+{
+    guint i;
+
+    for (i = 0; i < self->tiles->len; i++) {
+        DashboardTile *tile = g_ptr_array_index(self->tiles, i);
+
+        if (tile->window == window) {
+            dashboard_tile_demote(tile);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
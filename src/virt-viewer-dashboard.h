@@ -0,0 +1,51 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#ifndef VIRT_VIEWER_DASHBOARD_H
+#define VIRT_VIEWER_DASHBOARD_H
+
+#include <glib.h>
+
+#include "virt-viewer-app.h"
+#include "virt-viewer-file.h"
+
+G_BEGIN_DECLS
+
+typedef struct _VirtViewerDashboard VirtViewerDashboard;
+
+VirtViewerDashboard *virt_viewer_dashboard_new(VirtViewerApp *app);
+void virt_viewer_dashboard_free(VirtViewerDashboard *self);
+void virt_viewer_dashboard_add_file(VirtViewerDashboard *self, const gchar *name, VirtViewerFile *file);
+gboolean virt_viewer_dashboard_start(VirtViewerDashboard *self, GError **error);
+gboolean virt_viewer_dashboard_demote(VirtViewerDashboard *self, VirtViewerWindow *window);
+
+G_END_DECLS
+
+#endif /* VIRT_VIEWER_DASHBOARD_H */
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
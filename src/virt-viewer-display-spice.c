@@ -83,6 +83,9 @@ get_main(VirtViewerDisplay *self)
     VirtViewerSessionSpice *session;
 
     session = VIRT_VIEWER_SESSION_SPICE(virt_viewer_display_get_session(self));
+    /* suspended displays outlive their session */
+    if (session == NULL)
+        return NULL;
 
     return virt_viewer_session_spice_get_main_channel(session);
 }
@@ -361,6 +364,9 @@ virt_viewer_display_spice_selectable(VirtViewerDisplay *self)
     SpiceMainChannel *mainc;
 
     mainc = get_main(self);
+    if (mainc == NULL)
+        return FALSE;
+
     g_object_get(mainc,
                  "agent-connected", &agent_connected,
                  NULL);
@@ -234,6 +234,13 @@ virt_viewer_display_vnc_new(VirtViewerSessionVnc *session,
     vnc_display_set_force_size(display->priv->vnc, FALSE);
     vnc_display_set_scaling(display->priv->vnc, TRUE);
 
+    /* These are only used once the connection is initialized */
+    vnc_display_set_lossy_encoding(display->priv->vnc,
+                                   virt_viewer_session_vnc_get_lossy_encoding(session));
+    if (!vnc_display_set_depth(display->priv->vnc,
+                               virt_viewer_session_vnc_get_depth(session)))
+        g_debug("Could not change the color depth of an initialized connection");
+
     /* When VNC desktop resizes, we have to resize the containing widget */
     g_signal_connect(display->priv->vnc, "vnc-desktop-resize",
                      G_CALLBACK(virt_viewer_display_vnc_resize_desktop), display);
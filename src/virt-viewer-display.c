@@ -41,7 +41,7 @@ struct _VirtViewerDisplayPrivate
     gint nth_display; /* Monitor number inside the guest */
     gint monitor;     /* Monitor number on the client */
     guint show_hint;
-    VirtViewerSession *session;
+    VirtViewerSession *session; /* weak reference */
     gboolean fullscreen;
 };
 
@@ -62,6 +62,7 @@ static void virt_viewer_display_get_property(GObject *object,
                                              GValue *value,
                                              GParamSpec *pspec);
 static void virt_viewer_display_grab_focus(GtkWidget *widget);
+static void virt_viewer_display_dispose(GObject *object);
 
 G_DEFINE_ABSTRACT_TYPE(VirtViewerDisplay, virt_viewer_display, GTK_TYPE_BIN)
 
@@ -88,6 +89,7 @@ virt_viewer_display_class_init(VirtViewerDisplayClass *class)
 
     object_class->set_property = virt_viewer_display_set_property;
     object_class->get_property = virt_viewer_display_get_property;
+    object_class->dispose = virt_viewer_display_dispose;
 
     widget_class->get_preferred_width = virt_viewer_display_get_preferred_width;
     widget_class->get_preferred_height = virt_viewer_display_get_preferred_height;
@@ -256,6 +258,19 @@ virt_viewer_display_init(VirtViewerDisplay *display)
     display->priv->zoom_level = NORMAL_ZOOM_LEVEL;
 }
 
+static void
+virt_viewer_display_dispose(GObject *object)
+{
+    VirtViewerDisplayPrivate *priv = VIRT_VIEWER_DISPLAY(object)->priv;
+
+    if (priv->session != NULL) {
+        g_object_remove_weak_pointer(G_OBJECT(priv->session), (gpointer*)&priv->session);
+        priv->session = NULL;
+    }
+
+    G_OBJECT_CLASS(virt_viewer_display_parent_class)->dispose(object);
+}
+
 GtkWidget*
 virt_viewer_display_new(void)
 {
@@ -284,6 +299,9 @@ virt_viewer_display_set_property(GObject *object,
     case PROP_SESSION:
         g_warn_if_fail(priv->session == NULL);
         priv->session = g_value_get_object(value);
+        /* windows may keep the display after the session is gone */
+        if (priv->session != NULL)
+            g_object_add_weak_pointer(G_OBJECT(priv->session), (gpointer*)&priv->session);
         break;
     case PROP_MONITOR:
         priv->monitor = g_value_get_int(value);
@@ -345,6 +363,25 @@ virt_viewer_display_grab_focus(GtkWidget *widget)
     gtk_widget_grab_focus(gtk_bin_get_child(bin));
 }
 
+/**
+ * virt_viewer_display_get_render_scale:
+ * @display: the display
+ *
+ * The guest renders at 1/render_scale of the client size, the widget
+ * scales it back up.
+ *
+ * Returns: the render scale of the session of @display, 1 without one
+ */
+guint virt_viewer_display_get_render_scale(VirtViewerDisplay *display)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_DISPLAY(display), 1);
+
+    if (display->priv->session == NULL)
+        return 1;
+
+    return virt_viewer_session_get_render_scale(display->priv->session);
+}
+
 static void virt_viewer_display_get_preferred_dimension_from_desktop(VirtViewerDisplay *display,
                                                                      const int minimal_size,
                                                                      const int desktop_dim,
@@ -352,13 +389,14 @@ static void virt_viewer_display_get_preferred_dimension_from_desktop(VirtViewerD
                                                                      int *preferred_dim)
 {
     int border_width = gtk_container_get_border_width(GTK_CONTAINER(display));
+    guint render_scale = virt_viewer_display_get_render_scale(display);
 
     if (virt_viewer_display_get_zoom(display)) {
         guint zoom_level = virt_viewer_display_get_zoom_level(display);
-        *preferred_dim = round(desktop_dim * zoom_level / (double) NORMAL_ZOOM_LEVEL);
+        *preferred_dim = round(desktop_dim * render_scale * zoom_level / (double) NORMAL_ZOOM_LEVEL);
         *minimal_dim = round(minimal_size * zoom_level / (double) NORMAL_ZOOM_LEVEL);
     } else {
-        *preferred_dim = desktop_dim;
+        *preferred_dim = desktop_dim * render_scale;
         *minimal_dim = minimal_size;
     }
     *preferred_dim += 2 * border_width;
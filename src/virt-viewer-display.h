@@ -109,6 +109,7 @@ void virt_viewer_display_get_desktop_size(VirtViewerDisplay *display,
 void virt_viewer_display_set_zoom_level(VirtViewerDisplay *display,
                                         guint zoom);
 guint virt_viewer_display_get_zoom_level(VirtViewerDisplay *display);
+guint virt_viewer_display_get_render_scale(VirtViewerDisplay *display);
 void virt_viewer_display_set_zoom(VirtViewerDisplay *display,
                                   gboolean zoom);
 gboolean virt_viewer_display_get_zoom(VirtViewerDisplay *display);
@@ -47,10 +47,77 @@ struct _VirtViewerFileClass
     GObjectClass parent_class;
 };
 
+/*
+ * Typed view of a connection file, decoded once from the key file. Strings
+ * and lists are NULL and integers 0 when the key is not set, use
+ * virt_viewer_file_is_set() to tell unset keys from zero values. The
+ * structure stays valid until the file is next modified.
+ */
+typedef struct _VirtViewerFileSettings VirtViewerFileSettings;
+
+struct _VirtViewerFileSettings
+{
+    const gchar *type;
+    const gchar *host;
+    gint port;
+    gint tls_port;
+    const gchar *username;
+    const gchar *password;
+    const gchar * const *disable_channels;
+    const gchar *tls_ciphers;
+    const gchar *ca;
+    const gchar *host_subject;
+    gint fullscreen;
+    const gchar *title;
+    const gchar *toggle_fullscreen;
+    const gchar *release_cursor;
+    const gchar *smartcard_insert;
+    const gchar *smartcard_remove;
+    const gchar *secure_attention;
+    gint enable_smartcard;
+    gint enable_usbredir;
+    gint color_depth;
+    const gchar * const *disable_effects;
+    gint enable_usb_autoshare;
+    const gchar *usb_filter;
+    const gchar * const *secure_channels;
+    gint delete_this_file;
+    const gchar *proxy;
+    gint render_scale;
+    const gchar *preferred_compression;
+    const gchar * const *preferred_video_codecs;
+    gint adaptive_quality;
+    gint stall_timeout;
+    gint vnc_lossy_encoding;
+    const gchar *vnc_depth;
+    gint vnc_shared;
+    const gchar *profile;
+    const gchar *version;
+    const gchar * const *versions;
+    const gchar *version_url;
+
+    gint ovirt_admin;
+    const gchar *ovirt_host;
+    const gchar *ovirt_vm_guid;
+    const gchar *ovirt_jsessionid;
+    const gchar *ovirt_sso_token;
+    const gchar *ovirt_ca;
+};
+
 GType virt_viewer_file_get_type(void);
 
 VirtViewerFile* virt_viewer_file_new(const gchar* path, GError** error);
+VirtViewerFile* virt_viewer_file_new_from_stream(GInputStream* stream,
+                                                 GCancellable* cancellable,
+                                                 GError** error);
+void virt_viewer_file_new_from_stream_async(GInputStream* stream,
+                                            GCancellable* cancellable,
+                                            GAsyncReadyCallback callback,
+                                            gpointer user_data);
+VirtViewerFile* virt_viewer_file_new_from_stream_finish(GAsyncResult* result,
+                                                        GError** error);
 gboolean virt_viewer_file_is_set(VirtViewerFile* self, const gchar* key);
+const VirtViewerFileSettings* virt_viewer_file_get_settings(VirtViewerFile* self);
 
 gchar* virt_viewer_file_get_ca(VirtViewerFile* self);
 void virt_viewer_file_set_ca(VirtViewerFile* self, const gchar* value);
@@ -93,6 +160,7 @@ void virt_viewer_file_set_enable_usb_autoshare(VirtViewerFile* self, gint value)
 gchar* virt_viewer_file_get_usb_filter(VirtViewerFile* self);
 void virt_viewer_file_set_usb_filter(VirtViewerFile* self, const gchar* value);
 gboolean virt_viewer_file_fill_app(VirtViewerFile* self, VirtViewerApp *app, GError **error);
+gboolean virt_viewer_file_check_min_version(VirtViewerFile *self, GError **error);
 gchar* virt_viewer_file_get_smartcard_insert(VirtViewerFile* self);
 void virt_viewer_file_set_smartcard_insert(VirtViewerFile* self, const gchar* value);
 gchar* virt_viewer_file_get_smartcard_remove(VirtViewerFile* self);
@@ -111,6 +179,24 @@ gint virt_viewer_file_get_delete_this_file(VirtViewerFile* self);
 void virt_viewer_file_set_delete_this_file(VirtViewerFile* self, gint value);
 gchar* virt_viewer_file_get_secure_attention(VirtViewerFile* self);
 void virt_viewer_file_set_secure_attention(VirtViewerFile* self, const gchar* value);
+gint virt_viewer_file_get_render_scale(VirtViewerFile* self);
+void virt_viewer_file_set_render_scale(VirtViewerFile* self, gint value);
+gchar* virt_viewer_file_get_preferred_compression(VirtViewerFile* self);
+void virt_viewer_file_set_preferred_compression(VirtViewerFile* self, const gchar* value);
+gchar** virt_viewer_file_get_preferred_video_codecs(VirtViewerFile* self, gsize* length);
+void virt_viewer_file_set_preferred_video_codecs(VirtViewerFile* self, const gchar* const* value, gsize length);
+gint virt_viewer_file_get_adaptive_quality(VirtViewerFile* self);
+void virt_viewer_file_set_adaptive_quality(VirtViewerFile* self, gint value);
+gint virt_viewer_file_get_stall_timeout(VirtViewerFile* self);
+void virt_viewer_file_set_stall_timeout(VirtViewerFile* self, gint value);
+gint virt_viewer_file_get_vnc_lossy_encoding(VirtViewerFile* self);
+void virt_viewer_file_set_vnc_lossy_encoding(VirtViewerFile* self, gint value);
+gchar* virt_viewer_file_get_vnc_depth(VirtViewerFile* self);
+void virt_viewer_file_set_vnc_depth(VirtViewerFile* self, const gchar* value);
+gint virt_viewer_file_get_vnc_shared(VirtViewerFile* self);
+void virt_viewer_file_set_vnc_shared(VirtViewerFile* self, gint value);
+gchar* virt_viewer_file_get_profile(VirtViewerFile* self);
+void virt_viewer_file_set_profile(VirtViewerFile* self, const gchar* value);
 gint virt_viewer_file_get_ovirt_admin(VirtViewerFile* self);
 void virt_viewer_file_set_ovirt_admin(VirtViewerFile* self, gint value);
 gchar* virt_viewer_file_get_ovirt_host(VirtViewerFile* self);
@@ -0,0 +1,699 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "virt-viewer-launcher.h"
+#include "virt-viewer-file.h"
+#include "virt-viewer-session.h"
+#include "virt-viewer-util.h"
+
+/*
+ * Resident launcher: a remote-viewer started with --resident stays
+ * initialized in the background, without any window, and opens the
+ * connection files and URIs handed over by "remote-viewer --use-launcher"
+ * through GApplication D-Bus activation. Each request gets its own session
+ * and window in this process, skipping the GTK, resources and spice-gtk
+ * initialization a cold start pays for.
+ *
+ * The hint of the open request carries the time at which the requesting
+ * process was created, so that a --probe run through the launcher reports
+ * the same startup figure a cold --probe does, and its --probe-timeout.
+ * A --probe is not handed over as an open request, which has no reply,
+ * but through the Probe method of the launcher, which returns the JSON
+ * report and exit status for the requesting process to print and exit
+ * with.
+ *
+ * The settings of a connection file which belong to the application, such
+ * as its title or hotkeys, are not applied to the launcher: its requests
+ * would overwrite each other's. The title and fullscreen settings are
+ * applied to the window of the request instead.
+ */
+#define LAUNCHER_PROBE_TIMEOUT 30 /* when the hint has none */
+
+#define LAUNCHER_OBJECT_PATH "/org/virt_manager/virt_viewer/Launcher"
+#define LAUNCHER_INTERFACE "org.virt_manager.virt_viewer.Launcher"
+
+/* Same as the exit status of a cold --probe */
+#define LAUNCHER_STATUS_OK 0
+#define LAUNCHER_STATUS_FAILED 1
+#define LAUNCHER_STATUS_TIMEOUT 2
+
+static const gchar launcher_introspection[] =
+    "<node>"
+    "  <interface name='" LAUNCHER_INTERFACE "'>"
+    "    <method name='Probe'>"
+    "      <arg type='s' name='uri' direction='in'/>"
+    "      <arg type='s' name='hint' direction='in'/>"
+    "      <arg type='s' name='report' direction='out'/>"
+    "      <arg type='i' name='status' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+typedef struct {
+    VirtViewerLauncher *launcher;
+    gchar *uri;
+    VirtViewerSession *session;
+    VirtViewerDisplay *display;
+    VirtViewerWindow *window;
+    gboolean probe;
+    GDBusMethodInvocation *invocation; /* of a probe, until it is answered */
+    guint probe_timeout;
+    gboolean closed;
+    guint timeout_id;
+
+    gint64 launch_time;
+    gint64 request_time;
+    gint64 connect_time;
+    gint64 display_time;
+    gint64 first_frame_time;
+} LaunchRequest;
+
+struct _VirtViewerLauncher {
+    VirtViewerApp *app;
+    GList *requests;
+    gboolean started;
+    guint registration_id;
+};
+
+static gboolean
+launcher_window_unref(gpointer opaque)
+{
+    g_object_unref(opaque);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+launch_request_free(LaunchRequest *req)
+{
+    if (req->timeout_id != 0)
+        g_source_remove(req->timeout_id);
+    if (req->invocation != NULL)
+        g_dbus_method_invocation_return_error(req->invocation, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                              _("The launcher closed the request"));
+    if (req->window != NULL) {
+        virt_viewer_window_hide(req->window);
+        virt_viewer_window_set_display(req->window, NULL);
+        gtk_application_remove_window(GTK_APPLICATION(req->launcher->app),
+                                      virt_viewer_window_get_window(req->window));
+        /* this may run from a signal handler of the window */
+        g_idle_add(launcher_window_unref, req->window);
+    }
+    if (req->display != NULL)
+        g_signal_handlers_disconnect_by_data(req->display, req);
+    if (req->session != NULL) {
+        g_signal_handlers_disconnect_by_data(req->session, req);
+        virt_viewer_session_close(req->session);
+    }
+    g_clear_object(&req->display);
+    g_clear_object(&req->session);
+    g_free(req->uri);
+    g_free(req);
+}
+
+static gboolean
+launch_request_free_idle(gpointer opaque)
+{
+    launch_request_free(opaque);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+launch_request_close(LaunchRequest *req)
+{
+    VirtViewerLauncher *self = req->launcher;
+
+    if (req->closed)
+        return;
+    req->closed = TRUE;
+    if (req->timeout_id != 0) {
+        g_source_remove(req->timeout_id);
+        req->timeout_id = 0;
+    }
+
+    self->requests = g_list_remove(self->requests, req);
+    /* this may run from a session signal handler, don't close it under its feet */
+    g_idle_add(launch_request_free_idle, req);
+}
+
+static void
+launch_request_append_phase(GString *json, const gchar *name,
+                            gint64 mark, gint64 origin)
+{
+    g_string_append_printf(json, "\"%s\": ", name);
+    if (mark != 0)
+        virt_viewer_util_json_append_ms(json, mark - origin);
+    else
+        g_string_append(json, "null");
+}
+
+/* Same layout as the output of a cold --probe, for the phases that apply,
+ * returned to the requesting process */
+static void
+launch_request_report(LaunchRequest *req, gint status, const gchar *error)
+{
+    GString *json;
+
+    if (req->invocation == NULL)
+        return;
+
+    json = g_string_new("{\"result\": ");
+    virt_viewer_util_json_append_string(json, status == LAUNCHER_STATUS_OK ? "ok" :
+                                        status == LAUNCHER_STATUS_TIMEOUT ? "timeout" : "failed");
+    if (error != NULL) {
+        g_string_append(json, ", \"error\": ");
+        virt_viewer_util_json_append_string(json, error);
+    }
+    g_string_append(json, ", \"uri\": ");
+    virt_viewer_util_json_append_string(json, req->uri);
+    g_string_append(json, ", \"startup\": ");
+    if (req->launch_time != 0)
+        virt_viewer_util_json_append_ms(json, req->request_time - req->launch_time);
+    else
+        g_string_append(json, "null");
+    g_string_append(json, ", \"phases\": {");
+    launch_request_append_phase(json, "main-channel", req->connect_time, req->request_time);
+    g_string_append(json, ", ");
+    launch_request_append_phase(json, "display-channel", req->display_time, req->request_time);
+    g_string_append(json, ", ");
+    launch_request_append_phase(json, "first-frame", req->first_frame_time, req->request_time);
+    g_string_append(json, "}, \"total\": ");
+    virt_viewer_util_json_append_ms(json, g_get_monotonic_time() - req->request_time);
+    g_string_append(json, "}\n");
+
+    g_dbus_method_invocation_return_value(req->invocation,
+                                          g_variant_new("(si)", json->str, status));
+    req->invocation = NULL;
+    g_string_free(json, TRUE);
+}
+
+static void
+launch_request_fail(LaunchRequest *req, const gchar *msg)
+{
+    GtkWidget *dialog;
+
+    if (req->closed)
+        return;
+
+    g_debug("launcher: %s failed: %s", req->uri, msg);
+    if (req->probe) {
+        launch_request_report(req, LAUNCHER_STATUS_FAILED, msg);
+        launch_request_close(req);
+        return;
+    }
+
+    dialog = gtk_message_dialog_new(NULL, 0, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                    _("Unable to connect to %s"), req->uri);
+    gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog), "%s", msg);
+    g_signal_connect(dialog, "response", G_CALLBACK(gtk_widget_destroy), NULL);
+    gtk_widget_show(dialog);
+
+    launch_request_close(req);
+}
+
+static gboolean
+launch_request_timeout(gpointer opaque)
+{
+    LaunchRequest *req = opaque;
+
+    req->timeout_id = 0;
+    launch_request_report(req, LAUNCHER_STATUS_TIMEOUT, _("Timed out"));
+    launch_request_close(req);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+launch_request_show_hint(VirtViewerDisplay *display,
+                         GParamSpec *pspec G_GNUC_UNUSED,
+                         LaunchRequest *req)
+{
+    if (req->closed || req->first_frame_time != 0 ||
+        !(virt_viewer_display_get_show_hint(display) & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY))
+        return;
+
+    req->first_frame_time = g_get_monotonic_time();
+    g_debug("launcher: %s first frame after %" G_GINT64_FORMAT " ms",
+            req->uri, (req->first_frame_time - req->request_time) / 1000);
+
+    if (req->probe) {
+        launch_request_report(req, LAUNCHER_STATUS_OK, NULL);
+        launch_request_close(req);
+    }
+}
+
+static void
+launch_request_show_window(LaunchRequest *req, VirtViewerDisplay *display)
+{
+    VirtViewerFile *file = virt_viewer_session_get_file(req->session);
+    gchar *title = NULL;
+    gchar *uuid = NULL;
+
+    if (file != NULL) {
+        title = virt_viewer_file_get_title(file);
+        uuid = virt_viewer_file_get_ovirt_vm_guid(file);
+    }
+
+    req->window = g_object_new(VIRT_VIEWER_TYPE_WINDOW, "app", req->launcher->app, NULL);
+    g_object_set(req->window, "subtitle", title ? title : req->uri, NULL);
+    gtk_application_add_window(GTK_APPLICATION(req->launcher->app),
+                               virt_viewer_window_get_window(req->window));
+    virt_viewer_window_set_display(req->window, display);
+    /* the menus act on the session of the request, not on the application's */
+    virt_viewer_window_set_guest(req->window, title ? title : req->uri, uuid);
+    virt_viewer_window_set_usb_options_sensitive(req->window,
+                                                 virt_viewer_session_get_has_usbredir(req->session));
+    virt_viewer_window_show(req->window);
+    if (file != NULL && virt_viewer_file_is_set(file, "fullscreen") &&
+        virt_viewer_file_get_fullscreen(file))
+        virt_viewer_window_enter_fullscreen(req->window, -1);
+
+    g_free(title);
+    g_free(uuid);
+}
+
+static void
+launch_request_display_added(VirtViewerSession *session G_GNUC_UNUSED,
+                             VirtViewerDisplay *display,
+                             LaunchRequest *req)
+{
+    /* a request gets a single window, for the first monitor */
+    if (req->closed || req->display != NULL)
+        return;
+
+    req->display = g_object_ref(display);
+    req->display_time = g_get_monotonic_time();
+    g_signal_connect(display, "notify::show-hint",
+                     G_CALLBACK(launch_request_show_hint), req);
+
+    if (!req->probe)
+        launch_request_show_window(req, display);
+
+    launch_request_show_hint(display, NULL, req);
+}
+
+static void
+launch_request_display_removed(VirtViewerSession *session G_GNUC_UNUSED,
+                               VirtViewerDisplay *display,
+                               LaunchRequest *req)
+{
+    if (req->display == display && !req->probe)
+        launch_request_close(req);
+}
+
+static void
+launch_request_connected(VirtViewerSession *session G_GNUC_UNUSED,
+                         LaunchRequest *req)
+{
+    req->connect_time = g_get_monotonic_time();
+}
+
+static void
+launch_request_disconnected(VirtViewerSession *session G_GNUC_UNUSED,
+                            const gchar *msg,
+                            LaunchRequest *req)
+{
+    /* a guest that goes away after its window was shown isn't an error */
+    if (req->window != NULL && req->first_frame_time != 0) {
+        launch_request_close(req);
+        return;
+    }
+
+    launch_request_fail(req, msg ? msg : _("Disconnected from the graphic server"));
+}
+
+static void
+launch_request_auth_failed(VirtViewerSession *session G_GNUC_UNUSED,
+                           const gchar *msg,
+                           LaunchRequest *req)
+{
+    launch_request_fail(req, msg ? msg : _("Authentication failed"));
+}
+
+static void
+launch_request_cancelled(VirtViewerSession *session G_GNUC_UNUSED,
+                         LaunchRequest *req)
+{
+    launch_request_close(req);
+}
+
+static void
+launch_request_parse_hint(LaunchRequest *req, const gchar *hint)
+{
+    gchar **fields;
+    int i;
+
+    if (hint == NULL)
+        return;
+
+    fields = g_strsplit(hint, ",", -1);
+    for (i = 0; fields[i] != NULL; i++) {
+        if (g_str_has_prefix(fields[i], "launch-time="))
+            req->launch_time = g_ascii_strtoll(fields[i] + strlen("launch-time="), NULL, 10);
+        else if (g_str_has_prefix(fields[i], "probe-timeout="))
+            req->probe_timeout = g_ascii_strtoull(fields[i] + strlen("probe-timeout="), NULL, 10);
+    }
+    g_strfreev(fields);
+}
+
+/* With @invocation, the request is probed and answers it */
+static void
+launch_request_open(VirtViewerLauncher *self, GFile *gfile, const gchar *hint,
+                    GDBusMethodInvocation *invocation)
+{
+    LaunchRequest *req = g_new0(LaunchRequest, 1);
+    VirtViewerFile *vvfile = NULL;
+    GError *error = NULL;
+    gchar *type = NULL;
+
+    req->launcher = self;
+    req->request_time = g_get_monotonic_time();
+    req->uri = g_file_get_uri(gfile);
+    req->probe_timeout = LAUNCHER_PROBE_TIMEOUT;
+    req->probe = invocation != NULL;
+    req->invocation = invocation;
+    launch_request_parse_hint(req, hint);
+    self->requests = g_list_append(self->requests, req);
+    g_debug("launcher: opening %s", req->uri);
+
+    if (req->probe)
+        req->timeout_id = g_timeout_add_seconds(MAX(req->probe_timeout, 1),
+                                                launch_request_timeout, req);
+
+    if (g_file_is_native(gfile)) {
+        gchar *path = g_file_get_path(gfile);
+
+        vvfile = virt_viewer_file_new(path, &error);
+        g_free(path);
+        if (vvfile == NULL) {
+            launch_request_fail(req, error->message);
+            goto cleanup;
+        }
+        type = virt_viewer_file_get_file_type(vvfile);
+    } else if (virt_viewer_util_extract_host(req->uri, &type, NULL, NULL, NULL, NULL) < 0) {
+        g_clear_pointer(&type, g_free);
+    }
+
+    if (type == NULL) {
+        launch_request_fail(req, _("Cannot determine the connection type"));
+        goto cleanup;
+    }
+
+    req->session = virt_viewer_app_new_session(self->app, type, &error);
+    if (req->session == NULL) {
+        launch_request_fail(req, error->message);
+        goto cleanup;
+    }
+
+    g_signal_connect(req->session, "session-connected",
+                     G_CALLBACK(launch_request_connected), req);
+    g_signal_connect(req->session, "session-disconnected",
+                     G_CALLBACK(launch_request_disconnected), req);
+    g_signal_connect(req->session, "session-auth-refused",
+                     G_CALLBACK(launch_request_auth_failed), req);
+    g_signal_connect(req->session, "session-auth-unsupported",
+                     G_CALLBACK(launch_request_auth_failed), req);
+    g_signal_connect(req->session, "session-cancelled",
+                     G_CALLBACK(launch_request_cancelled), req);
+    g_signal_connect(req->session, "session-display-added",
+                     G_CALLBACK(launch_request_display_added), req);
+    g_signal_connect(req->session, "session-display-removed",
+                     G_CALLBACK(launch_request_display_removed), req);
+
+    virt_viewer_session_set_file(req->session, vvfile);
+    if (!virt_viewer_session_open_uri(req->session, req->uri, &error))
+        launch_request_fail(req, error ? error->message : _("Failed to initiate connection"));
+
+cleanup:
+    g_clear_error(&error);
+    g_clear_object(&vvfile);
+    g_free(type);
+}
+
+/**
+ * virt_viewer_launcher_new:
+ * @app: the application the sessions belong to
+ *
+ * Returns: a new launcher, see virt_viewer_launcher_start()
+ */
+VirtViewerLauncher *
+virt_viewer_launcher_new(VirtViewerApp *app)
+{
+    VirtViewerLauncher *self = g_new0(VirtViewerLauncher, 1);
+
+    self->app = app;
+
+    return self;
+}
+
+void
+virt_viewer_launcher_free(VirtViewerLauncher *self)
+{
+    if (self == NULL)
+        return;
+
+    g_list_free_full(self->requests, (GDestroyNotify)launch_request_free);
+    g_free(self);
+}
+
+/**
+ * virt_viewer_launcher_start:
+ * @self: the launcher
+ * @error: return location for a #GError
+ *
+ * Keeps the application running without any window, waiting for requests,
+ * and does ahead of time what the first request would otherwise pay for.
+ *
+ * Returns: %TRUE if the launcher is ready
+ */
+gboolean
+virt_viewer_launcher_start(VirtViewerLauncher *self, GError **error G_GNUC_UNUSED)
+{
+    const gchar *types[] = { "spice", "vnc" };
+    GSList *formats;
+    gsize i;
+
+    g_return_val_if_fail(!self->started, FALSE);
+
+    g_application_hold(G_APPLICATION(self->app));
+    self->started = TRUE;
+
+    for (i = 0; i < G_N_ELEMENTS(types); i++) {
+        VirtViewerSession *session = virt_viewer_app_new_session(self->app, types[i], NULL);
+
+        g_clear_object(&session);
+    }
+    formats = gdk_pixbuf_get_formats();
+    g_slist_free(formats);
+
+    g_debug("launcher: ready after %" G_GINT64_FORMAT " ms",
+            (g_get_monotonic_time() - virt_viewer_app_get_launch_time(self->app)) / 1000);
+
+    return TRUE;
+}
+
+/**
+ * virt_viewer_launcher_open:
+ * @self: the launcher
+ * @files: the connection files or URIs to open
+ * @n_files: the number of @files
+ * @hint: the hint of the open request, see virt_viewer_launcher_hint_new()
+ *
+ * Opens a session and a window for each of @files.
+ */
+void
+virt_viewer_launcher_open(VirtViewerLauncher *self, GFile **files, gint n_files, const gchar *hint)
+{
+    gint i;
+
+    for (i = 0; i < n_files; i++)
+        launch_request_open(self, files[i], hint, NULL);
+}
+
+static void
+launcher_method_call(GDBusConnection *connection G_GNUC_UNUSED,
+                     const gchar *sender G_GNUC_UNUSED,
+                     const gchar *object_path G_GNUC_UNUSED,
+                     const gchar *interface_name G_GNUC_UNUSED,
+                     const gchar *method_name,
+                     GVariant *parameters,
+                     GDBusMethodInvocation *invocation,
+                     gpointer user_data)
+{
+    VirtViewerLauncher *self = user_data;
+    const gchar *uri, *hint;
+    GFile *file;
+
+    g_return_if_fail(g_str_equal(method_name, "Probe"));
+
+    g_variant_get(parameters, "(&s&s)", &uri, &hint);
+    file = g_file_new_for_uri(uri);
+    launch_request_open(self, file, hint, invocation);
+    g_object_unref(file);
+}
+
+static const GDBusInterfaceVTable launcher_vtable = {
+    launcher_method_call,
+    NULL,
+    NULL,
+};
+
+/**
+ * virt_viewer_launcher_dbus_register:
+ * @self: the launcher
+ * @connection: the D-Bus connection of the application
+ * @error: return location for a #GError
+ *
+ * Exports the Probe method of the launcher on @connection.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+virt_viewer_launcher_dbus_register(VirtViewerLauncher *self,
+                                   GDBusConnection *connection,
+                                   GError **error)
+{
+    GDBusNodeInfo *info;
+
+    g_return_val_if_fail(self->registration_id == 0, FALSE);
+
+    info = g_dbus_node_info_new_for_xml(launcher_introspection, error);
+    if (info == NULL)
+        return FALSE;
+
+    self->registration_id = g_dbus_connection_register_object(connection, LAUNCHER_OBJECT_PATH,
+                                                              info->interfaces[0],
+                                                              &launcher_vtable,
+                                                              self, NULL, error);
+    g_dbus_node_info_unref(info);
+
+    return self->registration_id != 0;
+}
+
+void
+virt_viewer_launcher_dbus_unregister(VirtViewerLauncher *self,
+                                     GDBusConnection *connection)
+{
+    if (self->registration_id == 0)
+        return;
+
+    g_dbus_connection_unregister_object(connection, self->registration_id);
+    self->registration_id = 0;
+}
+
+/**
+ * virt_viewer_launcher_probe:
+ * @connection: a connection to the session bus
+ * @name: the bus name of the resident launcher
+ * @file: the connection file or URI to probe
+ * @hint: the hint of the request, see virt_viewer_launcher_hint_new()
+ * @probe_timeout: the seconds after which the launcher gives up
+ * @error: return location for a #GError
+ *
+ * Has the resident launcher probe @file, and prints its JSON report on
+ * stdout, as a cold --probe does. When the launcher could not be asked,
+ * nothing is printed and @error is set.
+ *
+ * Returns: the exit status of the probe, or -1 on error
+ */
+gint
+virt_viewer_launcher_probe(GDBusConnection *connection, const gchar *name,
+                           GFile *file, const gchar *hint, gint probe_timeout,
+                           GError **error)
+{
+    GVariant *reply;
+    gchar *uri = g_file_get_uri(file);
+    const gchar *report;
+    gint status;
+
+    /* the launcher answers a timed out probe itself, wait a bit more */
+    reply = g_dbus_connection_call_sync(connection, name, LAUNCHER_OBJECT_PATH,
+                                        LAUNCHER_INTERFACE, "Probe",
+                                        g_variant_new("(ss)", uri, hint),
+                                        G_VARIANT_TYPE("(si)"),
+                                        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                        (MAX(probe_timeout, 1) + 5) * 1000,
+                                        NULL, error);
+    g_free(uri);
+    if (reply == NULL)
+        return -1;
+
+    g_variant_get(reply, "(&si)", &report, &status);
+    g_print("%s", report);
+    g_variant_unref(reply);
+
+    return status;
+}
+
+/**
+ * virt_viewer_launcher_close_window:
+ * @self: the launcher
+ * @window: a window being closed
+ *
+ * Closes the session shown in @window, if it was opened by the launcher.
+ *
+ * Returns: %TRUE if @window belonged to the launcher
+ */
+gboolean
+virt_viewer_launcher_close_window(VirtViewerLauncher *self, VirtViewerWindow *window)
+{
+    GList *l;
+
+    for (l = self->requests; l != NULL; l = l->next) {
+        LaunchRequest *req = l->data;
+
+        if (req->window == window) {
+            launch_request_close(req);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * virt_viewer_launcher_hint_new:
+ * @launch_time: the monotonic time at which the requesting process started
+ * @probe_timeout: the seconds after which a probed request fails
+ *
+ * Returns: (transfer full): the hint to send along with an open or probe
+ * request
+ */
+gchar *
+virt_viewer_launcher_hint_new(gint64 launch_time, gint probe_timeout)
+{
+    return g_strdup_printf("launch-time=%" G_GINT64_FORMAT ",probe-timeout=%d",
+                           launch_time, probe_timeout);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
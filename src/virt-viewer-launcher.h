@@ -0,0 +1,55 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#ifndef VIRT_VIEWER_LAUNCHER_H
+#define VIRT_VIEWER_LAUNCHER_H
+
+#include <gio/gio.h>
+
+#include "virt-viewer-app.h"
+
+G_BEGIN_DECLS
+
+typedef struct _VirtViewerLauncher VirtViewerLauncher;
+
+VirtViewerLauncher *virt_viewer_launcher_new(VirtViewerApp *app);
+void virt_viewer_launcher_free(VirtViewerLauncher *self);
+gboolean virt_viewer_launcher_start(VirtViewerLauncher *self, GError **error);
+void virt_viewer_launcher_open(VirtViewerLauncher *self, GFile **files, gint n_files, const gchar *hint);
+gboolean virt_viewer_launcher_close_window(VirtViewerLauncher *self, VirtViewerWindow *window);
+gboolean virt_viewer_launcher_dbus_register(VirtViewerLauncher *self, GDBusConnection *connection, GError **error);
+void virt_viewer_launcher_dbus_unregister(VirtViewerLauncher *self, GDBusConnection *connection);
+gint virt_viewer_launcher_probe(GDBusConnection *connection, const gchar *name, GFile *file,
+                                const gchar *hint, gint probe_timeout, GError **error);
+gchar *virt_viewer_launcher_hint_new(gint64 launch_time, gint probe_timeout);
+
+G_END_DECLS
+
+#endif /* VIRT_VIEWER_LAUNCHER_H */
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
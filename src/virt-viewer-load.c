@@ -0,0 +1,682 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+#include "virt-viewer-load.h"
+#include "virt-viewer-session.h"
+#include "virt-viewer-util.h"
+#ifdef HAVE_SPICE_GTK
+#include "virt-viewer-session-spice.h"
+#endif
+
+/*
+ * Headless load generator: opens many sessions in the current process,
+ * optionally plays a script of key presses in each of them, and reports
+ * per-session connection times, update rates, input latencies and
+ * failures once the run is over.
+ *
+ * Sessions are opened at a fixed rate, and no new one is opened while
+ * LOAD_MAX_CONNECTING are still being set up, so that the handshakes of
+ * the generator itself don't become what is being measured.
+ */
+#define LOAD_MAX_CONNECTING 16
+/* seconds for a session to receive its first frame before it counts as
+ * failed, so that unresponsive hosts don't stall the run */
+#define LOAD_CONNECT_TIMEOUT 30
+
+typedef struct {
+    gchar *name;
+    VirtViewerFile *file;
+} LoadSource;
+
+typedef struct {
+    guint delay; /* ms after the previous step */
+    guint *keyvals;
+    int nkeyvals;
+} LoadStep;
+
+typedef struct {
+    VirtViewerLoad *load;
+    gchar *name;
+    VirtViewerSession *session;
+    VirtViewerDisplay *display;
+    gchar *error;
+    gboolean closed;
+
+    gint64 open_time;
+    gint64 connect_time;
+    gint64 first_frame_time;
+    gint64 end_time;
+
+    /* only counted for Spice, VNC doesn't expose its updates */
+    gboolean has_updates;
+    guint updates;
+
+    /* time at which the last keys were sent, 0 once they were answered */
+    gint64 input_time;
+    guint nlatencies;
+    gint64 latency_min;
+    gint64 latency_max;
+    gint64 latency_total;
+
+    guint step;
+    guint step_id;
+} LoadSession;
+
+struct _VirtViewerLoad {
+    VirtViewerApp *app;
+    guint nsessions;
+    guint rate;
+    guint duration;
+
+    GPtrArray *sources;
+    GArray *script;
+    GPtrArray *sessions;
+
+    guint pace_id;
+    guint stop_id;
+    gint64 start_time;
+};
+
+static void
+load_source_free(LoadSource *source)
+{
+    g_free(source->name);
+    g_object_unref(source->file);
+    g_free(source);
+}
+
+static void
+load_step_clear(LoadStep *step)
+{
+    g_free(step->keyvals);
+}
+
+static void
+load_session_disconnect_handlers(LoadSession *ls)
+{
+    if (ls->session == NULL)
+        return;
+
+#ifdef HAVE_SPICE_GTK
+    if (VIRT_VIEWER_IS_SESSION_SPICE(ls->session)) {
+        SpiceSession *spice = NULL;
+        GList *channels, *l;
+
+        g_object_get(ls->session, "spice-session", &spice, NULL);
+        if (spice != NULL) {
+            g_signal_handlers_disconnect_by_data(spice, ls);
+            channels = spice_session_get_channels(spice);
+            for (l = channels; l != NULL; l = l->next)
+                g_signal_handlers_disconnect_by_data(l->data, ls);
+            g_list_free(channels);
+            g_object_unref(spice);
+        }
+    }
+#endif
+    if (ls->display != NULL)
+        g_signal_handlers_disconnect_by_data(ls->display, ls);
+    g_signal_handlers_disconnect_by_data(ls->session, ls);
+}
+
+static void
+load_session_free(LoadSession *ls)
+{
+    if (ls->step_id != 0)
+        g_source_remove(ls->step_id);
+    load_session_disconnect_handlers(ls);
+    g_clear_object(&ls->display);
+    g_clear_object(&ls->session);
+    g_free(ls->name);
+    g_free(ls->error);
+    g_free(ls);
+}
+
+static void
+load_session_fail(LoadSession *ls, const gchar *msg)
+{
+    if (ls->closed || ls->error != NULL)
+        return;
+
+    g_debug("load: %s failed: %s", ls->name, msg);
+    ls->error = g_strdup(msg);
+    ls->end_time = g_get_monotonic_time();
+    if (ls->step_id != 0) {
+        g_source_remove(ls->step_id);
+        ls->step_id = 0;
+    }
+}
+
+static gboolean load_session_step(gpointer opaque);
+
+static void
+load_session_schedule_step(LoadSession *ls)
+{
+    LoadStep *step = &g_array_index(ls->load->script, LoadStep, ls->step);
+
+    ls->step_id = g_timeout_add(MAX(step->delay, 1), load_session_step, ls);
+}
+
+static gboolean
+load_session_step(gpointer opaque)
+{
+    LoadSession *ls = opaque;
+    LoadStep *step = &g_array_index(ls->load->script, LoadStep, ls->step);
+
+    ls->step_id = 0;
+    if (ls->display != NULL) {
+        virt_viewer_display_send_keys(ls->display, step->keyvals, step->nkeyvals);
+        ls->input_time = g_get_monotonic_time();
+    }
+
+    /* the script is played in a loop until the end of the run */
+    ls->step = (ls->step + 1) % ls->load->script->len;
+    load_session_schedule_step(ls);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+load_session_show_hint(VirtViewerDisplay *display,
+                       GParamSpec *pspec G_GNUC_UNUSED,
+                       LoadSession *ls)
+{
+    if (ls->first_frame_time != 0 || ls->error != NULL ||
+        !(virt_viewer_display_get_show_hint(display) & VIRT_VIEWER_DISPLAY_SHOW_HINT_READY))
+        return;
+
+    ls->first_frame_time = g_get_monotonic_time();
+    g_debug("load: %s first frame after %" G_GINT64_FORMAT " ms",
+            ls->name, (ls->first_frame_time - ls->open_time) / 1000);
+
+    if (ls->load->script != NULL && ls->load->script->len > 0)
+        load_session_schedule_step(ls);
+}
+
+static void
+load_session_display_added(VirtViewerSession *session G_GNUC_UNUSED,
+                           VirtViewerDisplay *display,
+                           LoadSession *ls)
+{
+    /* the scripted input goes to the first display only */
+    if (ls->display != NULL)
+        return;
+
+    ls->display = g_object_ref(display);
+    g_signal_connect(display, "notify::show-hint",
+                     G_CALLBACK(load_session_show_hint), ls);
+    load_session_show_hint(display, NULL, ls);
+}
+
+static void
+load_session_connected(VirtViewerSession *session G_GNUC_UNUSED,
+                       LoadSession *ls)
+{
+    ls->connect_time = g_get_monotonic_time();
+}
+
+static void
+load_session_disconnected(VirtViewerSession *session G_GNUC_UNUSED,
+                          const gchar *msg,
+                          LoadSession *ls)
+{
+    load_session_fail(ls, msg ? msg : _("Disconnected from the graphic server"));
+}
+
+static void
+load_session_auth_failed(VirtViewerSession *session G_GNUC_UNUSED,
+                         const gchar *msg,
+                         LoadSession *ls)
+{
+    load_session_fail(ls, msg ? msg : _("Authentication failed"));
+}
+
+static void
+load_session_cancelled(VirtViewerSession *session G_GNUC_UNUSED,
+                       LoadSession *ls)
+{
+    load_session_fail(ls, _("Cancelled"));
+}
+
+#ifdef HAVE_SPICE_GTK
+static void
+load_session_display_invalidate(SpiceChannel *channel G_GNUC_UNUSED,
+                                gint x G_GNUC_UNUSED, gint y G_GNUC_UNUSED,
+                                gint w G_GNUC_UNUSED, gint h G_GNUC_UNUSED,
+                                LoadSession *ls)
+{
+    gint64 latency;
+
+    if (ls->closed || ls->error != NULL)
+        return;
+
+    ls->updates++;
+    if (ls->input_time == 0)
+        return;
+
+    /* the first update after some input is taken as its echo */
+    latency = g_get_monotonic_time() - ls->input_time;
+    ls->input_time = 0;
+    if (ls->nlatencies == 0 || latency < ls->latency_min)
+        ls->latency_min = latency;
+    if (latency > ls->latency_max)
+        ls->latency_max = latency;
+    ls->latency_total += latency;
+    ls->nlatencies++;
+}
+
+static void
+load_session_channel_new(SpiceSession *spice G_GNUC_UNUSED,
+                         SpiceChannel *channel,
+                         LoadSession *ls)
+{
+    if (!SPICE_IS_DISPLAY_CHANNEL(channel))
+        return;
+
+    ls->has_updates = TRUE;
+    g_signal_connect(channel, "display-invalidate",
+                     G_CALLBACK(load_session_display_invalidate), ls);
+}
+#endif
+
+static LoadSession *
+load_session_open(VirtViewerLoad *self, LoadSource *source, guint n)
+{
+    LoadSession *ls = g_new0(LoadSession, 1);
+    GError *error = NULL;
+    gchar *type = virt_viewer_file_get_file_type(source->file);
+
+    ls->load = self;
+    ls->name = g_strdup_printf("%s#%u", source->name, n);
+    ls->open_time = g_get_monotonic_time();
+
+    if (type == NULL) {
+        load_session_fail(ls, _("Cannot determine the connection type"));
+        return ls;
+    }
+
+    ls->session = virt_viewer_app_new_session(self->app, type, &error);
+    g_free(type);
+    if (ls->session == NULL) {
+        load_session_fail(ls, error->message);
+        g_clear_error(&error);
+        return ls;
+    }
+
+#ifdef HAVE_SPICE_GTK
+    if (VIRT_VIEWER_IS_SESSION_SPICE(ls->session)) {
+        SpiceSession *spice = NULL;
+
+        g_object_get(ls->session, "spice-session", &spice, NULL);
+        g_signal_connect(spice, "channel-new",
+                         G_CALLBACK(load_session_channel_new), ls);
+        g_object_unref(spice);
+    }
+#endif
+
+    g_signal_connect(ls->session, "session-connected",
+                     G_CALLBACK(load_session_connected), ls);
+    g_signal_connect(ls->session, "session-disconnected",
+                     G_CALLBACK(load_session_disconnected), ls);
+    g_signal_connect(ls->session, "session-auth-refused",
+                     G_CALLBACK(load_session_auth_failed), ls);
+    g_signal_connect(ls->session, "session-auth-unsupported",
+                     G_CALLBACK(load_session_auth_failed), ls);
+    g_signal_connect(ls->session, "session-cancelled",
+                     G_CALLBACK(load_session_cancelled), ls);
+    g_signal_connect(ls->session, "session-display-added",
+                     G_CALLBACK(load_session_display_added), ls);
+
+    virt_viewer_session_set_file(ls->session, source->file);
+    if (!virt_viewer_session_open_uri(ls->session, source->name, &error)) {
+        load_session_fail(ls, error ? error->message : _("Failed to initiate connection"));
+        g_clear_error(&error);
+    }
+
+    return ls;
+}
+
+/* the durations are printed with translatable formats, which can't use
+ * G_GINT64_FORMAT */
+static gint
+load_ms(gint64 us)
+{
+    return (gint) MIN(us / 1000, G_MAXINT);
+}
+
+static void
+virt_viewer_load_report(VirtViewerLoad *self)
+{
+    gint64 now = g_get_monotonic_time();
+    guint i, nfailed = 0, nupdating = 0;
+    gdouble total_rate = 0;
+
+    for (i = 0; i < self->sessions->len; i++) {
+        LoadSession *ls = g_ptr_array_index(self->sessions, i);
+        GString *line = g_string_new(NULL);
+
+        if (ls->error != NULL) {
+            g_string_printf(line, _("%s: failed after %d ms: %s"),
+                            ls->name, load_ms(ls->end_time - ls->open_time), ls->error);
+            nfailed++;
+        } else if (ls->first_frame_time == 0) {
+            g_string_printf(line, _("%s: no frame after %d ms"),
+                            ls->name, load_ms(ls->end_time - ls->open_time));
+            nfailed++;
+        } else {
+            g_string_printf(line, _("%s: connected in %d ms, first frame after %d ms"),
+                            ls->name,
+                            load_ms((ls->connect_time ? ls->connect_time : ls->first_frame_time) - ls->open_time),
+                            load_ms(ls->first_frame_time - ls->open_time));
+            if (ls->has_updates && ls->end_time > ls->first_frame_time) {
+                gdouble rate = ls->updates * 1000000.0 / (ls->end_time - ls->first_frame_time);
+
+                g_string_append_printf(line, _(", %.1f updates/s"), rate);
+                total_rate += rate;
+                nupdating++;
+            }
+            if (ls->nlatencies > 0)
+                g_string_append_printf(line, _(", input latency %d/%d/%d ms (min/avg/max)"),
+                                       load_ms(ls->latency_min),
+                                       load_ms(ls->latency_total / ls->nlatencies),
+                                       load_ms(ls->latency_max));
+        }
+        g_print("%s\n", line->str);
+        g_string_free(line, TRUE);
+    }
+
+    g_print(_("%u sessions, %u failures, %.1f updates/s on average, in %d s\n"),
+            self->sessions->len, nfailed, nupdating ? total_rate / nupdating : 0.0,
+            load_ms(now - self->start_time) / 1000);
+
+    virt_viewer_app_set_exit_status(self->app, nfailed == 0 ? 0 : 1);
+}
+
+static gboolean
+virt_viewer_load_stop(gpointer opaque)
+{
+    VirtViewerLoad *self = opaque;
+    gint64 now = g_get_monotonic_time();
+    guint i;
+
+    self->stop_id = 0;
+    for (i = 0; i < self->sessions->len; i++) {
+        LoadSession *ls = g_ptr_array_index(self->sessions, i);
+
+        if (ls->step_id != 0) {
+            g_source_remove(ls->step_id);
+            ls->step_id = 0;
+        }
+        if (ls->error == NULL)
+            ls->end_time = now;
+        ls->closed = TRUE;
+    }
+
+    virt_viewer_load_report(self);
+
+    for (i = 0; i < self->sessions->len; i++) {
+        LoadSession *ls = g_ptr_array_index(self->sessions, i);
+
+        load_session_disconnect_handlers(ls);
+        if (ls->session != NULL)
+            virt_viewer_session_close(ls->session);
+    }
+    g_application_quit(G_APPLICATION(self->app));
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+virt_viewer_load_pace(gpointer opaque)
+{
+    VirtViewerLoad *self = opaque;
+    LoadSource *source;
+    gint64 now = g_get_monotonic_time();
+    guint i, connecting = 0;
+
+    for (i = 0; i < self->sessions->len; i++) {
+        LoadSession *ls = g_ptr_array_index(self->sessions, i);
+
+        if (ls->error == NULL && ls->first_frame_time == 0 &&
+            now - ls->open_time >= LOAD_CONNECT_TIMEOUT * G_USEC_PER_SEC)
+            load_session_fail(ls, _("No frame received in time"));
+    }
+
+    if (self->sessions->len >= self->nsessions) {
+        g_debug("load: all %u sessions opened", self->sessions->len);
+        self->pace_id = 0;
+        self->stop_id = g_timeout_add_seconds(self->duration, virt_viewer_load_stop, self);
+        return G_SOURCE_REMOVE;
+    }
+
+    for (i = 0; i < self->sessions->len; i++) {
+        LoadSession *ls = g_ptr_array_index(self->sessions, i);
+
+        if (ls->error == NULL && ls->first_frame_time == 0)
+            connecting++;
+    }
+    if (connecting >= LOAD_MAX_CONNECTING) {
+        g_debug("load: %u sessions still connecting, waiting", connecting);
+        return G_SOURCE_CONTINUE;
+    }
+
+    source = g_ptr_array_index(self->sources, self->sessions->len % self->sources->len);
+    g_ptr_array_add(self->sessions,
+                    load_session_open(self, source, self->sessions->len / self->sources->len));
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * virt_viewer_load_new:
+ * @app: the application the sessions belong to
+ * @nsessions: the number of sessions to open
+ * @rate: the number of sessions opened per second
+ * @duration: the number of seconds the sessions are kept open once they
+ * have all been opened
+ *
+ * Returns: a new load generator, sessions are opened round robin from
+ * the files added with virt_viewer_load_add_file()
+ */
+VirtViewerLoad *
+virt_viewer_load_new(VirtViewerApp *app, guint nsessions,
+                     guint rate, guint duration)
+{
+    VirtViewerLoad *self = g_new0(VirtViewerLoad, 1);
+
+    self->app = app;
+    self->nsessions = nsessions;
+    self->rate = MAX(rate, 1);
+    self->duration = duration;
+    self->sources = g_ptr_array_new_with_free_func((GDestroyNotify)load_source_free);
+    self->sessions = g_ptr_array_new_with_free_func((GDestroyNotify)load_session_free);
+
+    return self;
+}
+
+void
+virt_viewer_load_free(VirtViewerLoad *self)
+{
+    if (self == NULL)
+        return;
+
+    if (self->pace_id != 0)
+        g_source_remove(self->pace_id);
+    if (self->stop_id != 0)
+        g_source_remove(self->stop_id);
+    g_ptr_array_unref(self->sessions);
+    g_ptr_array_unref(self->sources);
+    if (self->script != NULL)
+        g_array_unref(self->script);
+    g_free(self);
+}
+
+void
+virt_viewer_load_add_file(VirtViewerLoad *self, const gchar *name, VirtViewerFile *file)
+{
+    LoadSource *source = g_new0(LoadSource, 1);
+
+    source->name = g_strdup(name);
+    source->file = g_object_ref(file);
+    g_ptr_array_add(self->sources, source);
+}
+
+static guint
+load_parse_keyval(const gchar *name)
+{
+    static const struct {
+        const gchar *alias;
+        guint keyval;
+    } aliases[] = {
+        { "ctrl", GDK_KEY_Control_L },
+        { "alt", GDK_KEY_Alt_L },
+        { "shift", GDK_KEY_Shift_L },
+        { "super", GDK_KEY_Super_L },
+    };
+    int i;
+
+    for (i = 0; i < G_N_ELEMENTS(aliases); i++) {
+        if (g_ascii_strcasecmp(name, aliases[i].alias) == 0)
+            return aliases[i].keyval;
+    }
+
+    return gdk_keyval_from_name(name);
+}
+
+/**
+ * virt_viewer_load_set_script:
+ * @self: the load generator
+ * @filename: the script to play in every session
+ * @error: return location for a #GError
+ *
+ * Each line of the script holds a delay in milliseconds and the keys to
+ * press together once it elapsed, such as "500 ctrl+alt+F2". Empty lines
+ * and lines starting with '#' are ignored. Every session starts playing
+ * the script once its first frame is received, and loops over it.
+ *
+ * Returns: %TRUE if the script could be parsed
+ */
+gboolean
+virt_viewer_load_set_script(VirtViewerLoad *self, const gchar *filename, GError **error)
+{
+    gchar *contents = NULL;
+    gchar **lines;
+    GArray *script;
+    int i;
+
+    if (!g_file_get_contents(filename, &contents, NULL, error))
+        return FALSE;
+
+    script = g_array_new(FALSE, TRUE, sizeof(LoadStep));
+    g_array_set_clear_func(script, (GDestroyNotify)load_step_clear);
+
+    lines = g_strsplit(contents, "\n", -1);
+    for (i = 0; lines[i] != NULL; i++) {
+        gchar *line = g_strstrip(lines[i]);
+        gchar **keys;
+        gchar *end;
+        LoadStep step = { 0, };
+        int j;
+
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        step.delay = g_ascii_strtoull(line, &end, 10);
+        if (end == line || !g_ascii_isspace(*end)) {
+            g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        _("%s:%d: expected a delay in milliseconds followed by keys"),
+                        filename, i + 1);
+            goto error;
+        }
+
+        keys = g_strsplit(g_strstrip(end), "+", -1);
+        step.nkeyvals = g_strv_length(keys);
+        step.keyvals = g_new0(guint, step.nkeyvals);
+        for (j = 0; j < step.nkeyvals; j++) {
+            step.keyvals[j] = load_parse_keyval(keys[j]);
+            if (step.keyvals[j] == GDK_KEY_VoidSymbol) {
+                g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("%s:%d: unknown key '%s'"), filename, i + 1, keys[j]);
+                g_strfreev(keys);
+                load_step_clear(&step);
+                goto error;
+            }
+        }
+        g_strfreev(keys);
+        g_array_append_val(script, step);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+
+    if (self->script != NULL)
+        g_array_unref(self->script);
+    self->script = script;
+    return TRUE;
+
+error:
+    g_strfreev(lines);
+    g_free(contents);
+    g_array_unref(script);
+    return FALSE;
+}
+
+/**
+ * virt_viewer_load_start:
+ * @self: the load generator
+ * @error: return location for a #GError
+ *
+ * Starts opening the sessions. Once they have all been kept open for the
+ * requested duration, a report is printed and the application quits, with
+ * a non-zero exit status if any of the sessions failed.
+ *
+ * Returns: %TRUE if the run started
+ */
+gboolean
+virt_viewer_load_start(VirtViewerLoad *self, GError **error)
+{
+    g_return_val_if_fail(self->pace_id == 0, FALSE);
+
+    if (self->sources->len == 0) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("No virtual machine to connect to"));
+        return FALSE;
+    }
+
+    g_debug("load: opening %u sessions to %u guests, %u per second",
+            self->nsessions, self->sources->len, self->rate);
+    self->start_time = g_get_monotonic_time();
+    self->pace_id = g_timeout_add(1000 / self->rate, virt_viewer_load_pace, self);
+
+    return TRUE;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -39,6 +39,8 @@ int main(int argc, char **argv)
     app = G_APPLICATION(virt_viewer_new());
 
     ret = g_application_run(app, argc, argv);
+    if (ret == 0)
+        ret = virt_viewer_app_get_exit_status(VIRT_VIEWER_APP(app));
     g_object_unref(app);
 
     return ret;
@@ -0,0 +1,354 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <config.h>
+
+#include <glib/gi18n.h>
+
+#include "virt-viewer-race.h"
+
+/*
+ * Connection racing, after RFC 8305 "happy eyeballs": every address of the
+ * host is tried on every port, IPv6 and IPv4 addresses alternating, a new
+ * attempt being started each RACE_STAGGER milliseconds or as soon as the
+ * previous one fails. The first connection established wins and the other
+ * attempts are cancelled, so that a broken address family or a filtered
+ * port no longer costs a kernel connect timeout.
+ */
+#define RACE_STAGGER 250
+
+typedef struct {
+    gchar *host;
+    GArray *ports; /* guint16 */
+    GPtrArray *candidates; /* GInetSocketAddress, in the order they are tried */
+    guint next;
+    guint running;
+    guint stagger_id;
+    gboolean done;
+    gint64 start;
+    GSocketClient *client;
+    GCancellable *cancellable; /* stops the attempts left once one won */
+    GCancellable *caller_cancellable;
+    gulong cancelled_id;
+    GError *error; /* of the last attempt that failed */
+} Race;
+
+typedef struct {
+    GTask *task;
+    guint index;
+} RaceAttempt;
+
+static void race_next(GTask *task);
+
+static void
+race_free(gpointer data)
+{
+    Race *race = data;
+
+    if (race->stagger_id > 0)
+        g_source_remove(race->stagger_id);
+    if (race->caller_cancellable != NULL) {
+        g_cancellable_disconnect(race->caller_cancellable, race->cancelled_id);
+        g_object_unref(race->caller_cancellable);
+    }
+    g_clear_object(&race->cancellable);
+    g_clear_object(&race->client);
+    if (race->candidates != NULL)
+        g_ptr_array_unref(race->candidates);
+    g_array_unref(race->ports);
+    g_clear_error(&race->error);
+    g_free(race->host);
+    g_free(race);
+}
+
+static void
+race_caller_cancelled(GCancellable *caller G_GNUC_UNUSED, gpointer data)
+{
+    g_cancellable_cancel(data);
+}
+
+static gchar *
+race_candidate_to_string(GInetSocketAddress *candidate)
+{
+    gchar *address = g_inet_address_to_string(g_inet_socket_address_get_address(candidate));
+    gchar *str;
+
+    if (g_inet_address_get_family(g_inet_socket_address_get_address(candidate)) == G_SOCKET_FAMILY_IPV6)
+        str = g_strdup_printf("[%s]:%u", address, g_inet_socket_address_get_port(candidate));
+    else
+        str = g_strdup_printf("%s:%u", address, g_inet_socket_address_get_port(candidate));
+    g_free(address);
+    return str;
+}
+
+static void
+race_finish(GTask *task, GSocketConnection *connection, GError *error)
+{
+    Race *race = g_task_get_task_data(task);
+
+    race->done = TRUE;
+    if (race->stagger_id > 0) {
+        g_source_remove(race->stagger_id);
+        race->stagger_id = 0;
+    }
+    g_cancellable_cancel(race->cancellable);
+
+    if (connection != NULL)
+        g_task_return_pointer(task, connection, g_object_unref);
+    else
+        g_task_return_error(task, error);
+}
+
+static void
+race_attempt_ready(GObject *source, GAsyncResult *result, gpointer data)
+{
+    RaceAttempt *attempt = data;
+    GTask *task = attempt->task;
+    Race *race = g_task_get_task_data(task);
+    GInetSocketAddress *candidate = g_ptr_array_index(race->candidates, attempt->index);
+    GSocketConnection *connection;
+    GError *error = NULL;
+    gchar *name;
+
+    race->running--;
+    connection = g_socket_client_connect_finish(G_SOCKET_CLIENT(source), result, &error);
+    if (race->done) {
+        g_clear_object(&connection);
+        g_clear_error(&error);
+        goto end;
+    }
+
+    name = race_candidate_to_string(candidate);
+    if (connection != NULL) {
+        g_debug("Connected to %s at %s in %" G_GINT64_FORMAT " ms, attempt %u of %u",
+                race->host, name, (g_get_monotonic_time() - race->start) / 1000,
+                attempt->index + 1, race->candidates->len);
+        g_free(name);
+        race_finish(task, connection, NULL);
+        goto end;
+    }
+
+    g_debug("Failed to connect to %s at %s: %s", race->host, name, error->message);
+    g_free(name);
+    if (g_cancellable_is_cancelled(race->caller_cancellable)) {
+        race_finish(task, NULL, error);
+        goto end;
+    }
+
+    g_clear_error(&race->error);
+    race->error = error;
+    if (race->next < race->candidates->len) {
+        /* no need to wait for the stagger delay */
+        race_next(task);
+    } else if (race->running == 0) {
+        error = race->error;
+        race->error = NULL;
+        race_finish(task, NULL, error);
+    }
+
+end:
+    g_object_unref(task);
+    g_free(attempt);
+}
+
+static gboolean
+race_stagger_cb(gpointer data)
+{
+    GTask *task = data;
+    Race *race = g_task_get_task_data(task);
+
+    race->stagger_id = 0;
+    race_next(task);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+race_next(GTask *task)
+{
+    Race *race = g_task_get_task_data(task);
+    RaceAttempt *attempt;
+
+    if (race->stagger_id > 0) {
+        g_source_remove(race->stagger_id);
+        race->stagger_id = 0;
+    }
+    if (race->next >= race->candidates->len)
+        return;
+
+    attempt = g_new0(RaceAttempt, 1);
+    attempt->task = g_object_ref(task);
+    attempt->index = race->next++;
+    race->running++;
+    g_socket_client_connect_async(race->client,
+                                  g_ptr_array_index(race->candidates, attempt->index),
+                                  race->cancellable, race_attempt_ready, attempt);
+
+    if (race->next < race->candidates->len)
+        race->stagger_id = g_timeout_add(RACE_STAGGER, race_stagger_cb, task);
+}
+
+static void
+race_add_candidates(Race *race, GInetAddress *address)
+{
+    guint i;
+
+    for (i = 0; i < race->ports->len; i++) {
+        guint16 port = g_array_index(race->ports, guint16, i);
+        g_ptr_array_add(race->candidates, g_inet_socket_address_new(address, port));
+    }
+}
+
+static void
+race_resolved(GObject *source, GAsyncResult *result, gpointer data)
+{
+    GTask *task = data;
+    Race *race = g_task_get_task_data(task);
+    GList *addresses, *first = NULL, *second = NULL, *l;
+    GSocketFamily family;
+    GError *error = NULL;
+
+    addresses = g_resolver_lookup_by_name_finish(G_RESOLVER(source), result, &error);
+    if (addresses == NULL) {
+        race_finish(task, NULL, error);
+        g_object_unref(task);
+        return;
+    }
+
+    /* alternate address families, starting with the preferred one */
+    family = g_inet_address_get_family(addresses->data);
+    for (l = addresses; l != NULL; l = l->next) {
+        if (g_inet_address_get_family(l->data) == family)
+            first = g_list_prepend(first, l->data);
+        else
+            second = g_list_prepend(second, l->data);
+    }
+    first = g_list_reverse(first);
+    second = g_list_reverse(second);
+
+    race->candidates = g_ptr_array_new_with_free_func(g_object_unref);
+    for (l = first; l != NULL; l = l->next) {
+        race_add_candidates(race, l->data);
+        if (second != NULL) {
+            race_add_candidates(race, second->data);
+            second = g_list_delete_link(second, second);
+        }
+    }
+    for (l = second; l != NULL; l = l->next)
+        race_add_candidates(race, l->data);
+
+    g_list_free(first);
+    g_list_free(second);
+    g_resolver_free_addresses(addresses);
+
+    g_debug("Racing %u connections to %s", race->candidates->len, race->host);
+    race_next(task);
+    g_object_unref(task);
+}
+
+/**
+ * virt_viewer_race_connect_async:
+ * @host: the host name or address to connect to
+ * @ports: a %NULL-terminated array of TCP ports, in order of preference
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called once a connection is established or all failed
+ * @user_data: data for @callback
+ *
+ * Connects to every address of @host on every port in @ports, and keeps the
+ * first connection established.
+ */
+void
+virt_viewer_race_connect_async(const gchar *host,
+                               const gchar * const *ports,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+    GTask *task;
+    Race *race;
+    GResolver *resolver;
+    guint i;
+
+    g_return_if_fail(host != NULL);
+    g_return_if_fail(ports != NULL);
+
+    race = g_new0(Race, 1);
+    race->host = g_strdup(host);
+    race->ports = g_array_new(FALSE, FALSE, sizeof(guint16));
+    for (i = 0; ports[i] != NULL; i++) {
+        gint64 port = g_ascii_strtoll(ports[i], NULL, 10);
+        guint16 port16;
+
+        if (port <= 0 || port > G_MAXUINT16)
+            continue;
+        port16 = port;
+        g_array_append_val(race->ports, port16);
+    }
+    race->start = g_get_monotonic_time();
+    race->client = g_socket_client_new();
+    race->cancellable = g_cancellable_new();
+    if (cancellable != NULL) {
+        race->caller_cancellable = g_object_ref(cancellable);
+        race->cancelled_id = g_cancellable_connect(cancellable,
+                                                   G_CALLBACK(race_caller_cancelled),
+                                                   g_object_ref(race->cancellable),
+                                                   g_object_unref);
+    }
+
+    task = g_task_new(NULL, cancellable, callback, user_data);
+    g_task_set_task_data(task, race, race_free);
+
+    if (race->ports->len == 0) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                                _("No valid port to connect to %s"), host);
+        g_object_unref(task);
+        return;
+    }
+
+    resolver = g_resolver_get_default();
+    g_resolver_lookup_by_name_async(resolver, host, race->cancellable,
+                                    race_resolved, task);
+    g_object_unref(resolver);
+}
+
+/**
+ * virt_viewer_race_connect_finish:
+ * @result: the #GAsyncResult passed to the callback
+ * @error: return location for the error of the last attempt
+ *
+ * Returns: (transfer full): the winning connection, or %NULL on failure
+ */
+GSocketConnection *
+virt_viewer_race_connect_finish(GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -24,7 +24,14 @@
 
 #include <config.h>
 
+#include <errno.h>
 #include <glib/gi18n.h>
+#include <unistd.h>
+#ifdef HAVE_NETINET_TCP_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 #include <spice-client-gtk.h>
 
@@ -51,7 +58,20 @@ struct _VirtViewerSessionSpicePrivate {
     guint pass_try;
     gboolean did_auto_conf;
     VirtViewerFileTransferDialog *file_transfer_dialog;
-
+    gint preferred_compression; /* SPICE_IMAGE_COMPRESSION_INVALID if unset */
+    GArray *video_codecs; /* SPICE_VIDEO_CODEC_TYPE_*, in order of preference */
+    gint adaptive_quality; /* ADAPTIVE_QUALITY_* */
+    VirtViewerQualityController quality;
+    gboolean quality_decided; /* the level was changed during this session */
+    guint quality_timeout_id;
+    guint64 quality_last_bytes;
+    gint64 quality_last_time;
+    guint quality_stable_samples;
+    guint quality_saved_scale; /* render scale before the controller raised it, or 0 */
+    gint stall_timeout; /* in seconds, 0 to disable the liveness watchdog */
+    VirtViewerStallWatchdog watchdog;
+    guint watchdog_timeout_id;
+    const VirtViewerProfile *profile;
 };
 
 #define VIRT_VIEWER_SESSION_SPICE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE((o), VIRT_VIEWER_TYPE_SESSION_SPICE, VirtViewerSessionSpicePrivate))
@@ -80,6 +100,8 @@ static void virt_viewer_session_spice_smartcard_insert(VirtViewerSession *sessio
 static void virt_viewer_session_spice_smartcard_remove(VirtViewerSession *session);
 static gboolean virt_viewer_session_spice_fullscreen_auto_conf(VirtViewerSessionSpice *self);
 static void virt_viewer_session_spice_apply_monitor_geometry(VirtViewerSession *self, GHashTable *monitors);
+static void virt_viewer_session_spice_stop_quality(VirtViewerSessionSpice *self);
+static void virt_viewer_session_spice_stop_watchdog(VirtViewerSessionSpice *self);
 
 static void virt_viewer_session_spice_clear_displays(VirtViewerSessionSpice *self)
 {
@@ -148,7 +170,10 @@ virt_viewer_session_spice_dispose(GObject *obj)
 
     spice->priv->audio = NULL;
 
+    virt_viewer_session_spice_stop_quality(spice);
+    virt_viewer_session_spice_stop_watchdog(spice);
     g_clear_object(&spice->priv->main_window);
+    g_clear_pointer(&spice->priv->video_codecs, g_array_unref);
     if (spice->priv->file_transfer_dialog) {
         gtk_widget_destroy(GTK_WIDGET(spice->priv->file_transfer_dialog));
         spice->priv->file_transfer_dialog = NULL;
@@ -164,6 +189,13 @@ virt_viewer_session_spice_mime_type(VirtViewerSession *self G_GNUC_UNUSED)
     return "application/x-spice";
 }
 
+/* the guest agent resizes the guest displays to the monitors requested */
+static gboolean
+virt_viewer_session_spice_can_render_scale(VirtViewerSession *session G_GNUC_UNUSED)
+{
+    return TRUE;
+}
+
 static gboolean
 virt_viewer_session_spice_can_share_folder(VirtViewerSession *session)
 {
@@ -178,6 +210,861 @@ virt_viewer_session_spice_can_retry_auth(VirtViewerSession *session G_GNUC_UNUSE
     return TRUE;
 }
 
+typedef struct {
+    const gchar *name;
+    gint value;
+} SpiceEnumName;
+
+static const SpiceEnumName compression_names[] = {
+    { "off", SPICE_IMAGE_COMPRESSION_OFF },
+    { "auto-glz", SPICE_IMAGE_COMPRESSION_AUTO_GLZ },
+    { "auto-lz", SPICE_IMAGE_COMPRESSION_AUTO_LZ },
+    { "quic", SPICE_IMAGE_COMPRESSION_QUIC },
+    { "glz", SPICE_IMAGE_COMPRESSION_GLZ },
+    { "lz", SPICE_IMAGE_COMPRESSION_LZ },
+    { "lz4", SPICE_IMAGE_COMPRESSION_LZ4 },
+};
+
+static const SpiceEnumName video_codec_names[] = {
+    { "mjpeg", SPICE_VIDEO_CODEC_TYPE_MJPEG },
+    { "vp8", SPICE_VIDEO_CODEC_TYPE_VP8 },
+    { "h264", SPICE_VIDEO_CODEC_TYPE_H264 },
+};
+
+static gint
+spice_enum_from_name(const SpiceEnumName *names, gsize n_names, const gchar *name)
+{
+    gsize i;
+
+    for (i = 0; i < n_names; i++) {
+        if (g_ascii_strcasecmp(names[i].name, name) == 0)
+            return names[i].value;
+    }
+
+    return -1;
+}
+
+static const gchar *
+spice_enum_to_name(const SpiceEnumName *names, gsize n_names, gint value)
+{
+    gsize i;
+
+    for (i = 0; i < n_names; i++) {
+        if (names[i].value == value)
+            return names[i].name;
+    }
+
+    return NULL;
+}
+
+enum {
+    ADAPTIVE_QUALITY_DISABLED,
+    ADAPTIVE_QUALITY_ENABLED,
+    ADAPTIVE_QUALITY_RENDER_SCALE, /* also lower the render scale */
+};
+
+typedef struct {
+    gint compression;
+    gint video_codecs[3];
+    gint color_depth; /* 0 for the server default */
+    guint render_scale;
+} QualityProfile;
+
+/* Fast but light compression and cheap codecs when the bandwidth is
+ * plentiful, more CPU intensive but more efficient ones as it shrinks */
+static const QualityProfile quality_profiles[] = {
+    [VIRT_VIEWER_QUALITY_HIGH] = {
+        SPICE_IMAGE_COMPRESSION_LZ4,
+        { SPICE_VIDEO_CODEC_TYPE_MJPEG, SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_H264 },
+        0, 1
+    },
+    [VIRT_VIEWER_QUALITY_MEDIUM] = {
+        SPICE_IMAGE_COMPRESSION_AUTO_GLZ,
+        { SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_H264, SPICE_VIDEO_CODEC_TYPE_MJPEG },
+        0, 1
+    },
+    [VIRT_VIEWER_QUALITY_LOW] = {
+        SPICE_IMAGE_COMPRESSION_GLZ,
+        { SPICE_VIDEO_CODEC_TYPE_H264, SPICE_VIDEO_CODEC_TYPE_VP8, SPICE_VIDEO_CODEC_TYPE_MJPEG },
+        16, 2
+    },
+};
+
+#define QUALITY_SAMPLE_INTERVAL 2 /* seconds */
+/* how many samples without change before the level is remembered */
+#define QUALITY_SAVE_SAMPLES 30
+
+static void
+virt_viewer_session_spice_apply_display_preferences(VirtViewerSessionSpice *self,
+                                                    SpiceChannel *channel)
+{
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+    gint compression = priv->preferred_compression;
+    const gint *codecs = NULL;
+    guint n_codecs = 0;
+    gint profile_codecs[G_N_ELEMENTS(priv->profile->video_codecs)];
+
+    if (priv->video_codecs != NULL) {
+        codecs = (const gint *) priv->video_codecs->data;
+        n_codecs = priv->video_codecs->len;
+    }
+
+    /* the connection profile only provides defaults */
+    if (priv->profile != NULL) {
+        if (compression == SPICE_IMAGE_COMPRESSION_INVALID && priv->profile->image_compression != NULL)
+            compression = spice_enum_from_name(compression_names, G_N_ELEMENTS(compression_names),
+                                               priv->profile->image_compression);
+
+        if (n_codecs == 0) {
+            for (; n_codecs < G_N_ELEMENTS(profile_codecs) &&
+                   priv->profile->video_codecs[n_codecs] != NULL; n_codecs++)
+                profile_codecs[n_codecs] = spice_enum_from_name(video_codec_names,
+                                                                G_N_ELEMENTS(video_codec_names),
+                                                                priv->profile->video_codecs[n_codecs]);
+            codecs = profile_codecs;
+        }
+    }
+
+    /* the adaptive quality takes precedence over the static preferences */
+    if (priv->adaptive_quality != ADAPTIVE_QUALITY_DISABLED) {
+        const QualityProfile *profile = &quality_profiles[priv->quality.level];
+
+        compression = profile->compression;
+        codecs = profile->video_codecs;
+        n_codecs = G_N_ELEMENTS(profile->video_codecs);
+    }
+
+    if (compression != SPICE_IMAGE_COMPRESSION_INVALID) {
+        g_debug("Setting preferred image compression to %s",
+                spice_enum_to_name(compression_names, G_N_ELEMENTS(compression_names),
+                                   compression));
+#if SPICE_GTK_CHECK_VERSION(0, 35, 0)
+        spice_display_channel_change_preferred_compression(channel, compression);
+#else
+        spice_display_change_preferred_compression(channel, compression);
+#endif
+    }
+
+    if (n_codecs > 0) {
+#if SPICE_GTK_CHECK_VERSION(0, 38, 0)
+        GError *error = NULL;
+
+        if (!spice_display_channel_change_preferred_video_codec_types(channel, codecs,
+                                                                      n_codecs,
+                                                                      &error)) {
+            g_warning("Failed to set the preferred video codecs: %s", error->message);
+            g_clear_error(&error);
+        }
+#elif SPICE_GTK_CHECK_VERSION(0, 35, 0)
+        spice_display_channel_change_preferred_video_codec_type(channel, codecs[0]);
+#elif SPICE_GTK_CHECK_VERSION(0, 34, 0)
+        spice_display_change_preferred_video_codec_type(channel, codecs[0]);
+#else
+        g_debug("Ignoring preferred video codec %d, spice-gtk is too old", codecs[0]);
+#endif
+    }
+}
+
+static void
+virt_viewer_session_spice_update_display_preferences(VirtViewerSessionSpice *self)
+{
+    GList *l, *channels;
+
+    if (self->priv->session == NULL)
+        return;
+
+    channels = spice_session_get_channels(self->priv->session);
+    for (l = channels; l != NULL; l = l->next) {
+        SpiceChannel *channel = l->data;
+
+        /* the preferences are sent once the channel is opened */
+        if (!SPICE_IS_DISPLAY_CHANNEL(channel) ||
+            !g_object_get_data(G_OBJECT(channel), "virt-viewer-opened"))
+            continue;
+
+        virt_viewer_session_spice_apply_display_preferences(self, channel);
+    }
+    g_list_free(channels);
+}
+
+/* Applies the connection profile. Its values are only used for the settings
+ * that were not set explicitly, and some of them are only used when
+ * connecting. */
+static void
+virt_viewer_session_spice_apply_profile(VirtViewerSessionSpice *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    const VirtViewerProfile *profile = virt_viewer_app_get_profile(app);
+    SpiceSession *session = self->priv->session;
+
+    self->priv->profile = profile;
+
+    if (profile != NULL && session != NULL) {
+        g_debug("Using the %s profile", profile->name);
+
+        if (profile->color_depth != 0) {
+            gint depth = 0;
+
+            g_object_get(session, "color-depth", &depth, NULL);
+            if (depth == 0)
+                g_object_set(session, "color-depth", profile->color_depth, NULL);
+        }
+
+        if (profile->disable_effects[0] != NULL) {
+            gchar **effects = NULL;
+
+            g_object_get(session, "disable-effects", &effects, NULL);
+            if (effects == NULL)
+                g_object_set(session, "disable-effects", profile->disable_effects, NULL);
+            g_strfreev(effects);
+        }
+
+        if (profile->disable_audio)
+            g_object_set(session, "enable-audio", FALSE, NULL);
+        if (profile->disable_usbredir)
+            g_object_set(session, "enable-usbredir", FALSE, NULL);
+    }
+
+    virt_viewer_session_spice_update_display_preferences(self);
+}
+
+static guint64
+virt_viewer_session_spice_get_display_bytes(VirtViewerSessionSpice *self)
+{
+    GList *l, *channels;
+    guint64 total = 0;
+
+    if (self->priv->session == NULL)
+        return 0;
+
+    channels = spice_session_get_channels(self->priv->session);
+    for (l = channels; l != NULL; l = l->next) {
+        gulong bytes = 0;
+
+        if (!SPICE_IS_DISPLAY_CHANNEL(l->data))
+            continue;
+
+        g_object_get(l->data, "total-read-bytes", &bytes, NULL);
+        total += bytes;
+    }
+    g_list_free(channels);
+
+    return total;
+}
+
+/*
+ * Returns the smoothed round-trip time of the main channel connection as
+ * measured by the kernel, in ms, or -1 if it is not available. The server
+ * acknowledgements travel along the display data, so this includes the
+ * queueing delay of the downstream link.
+ */
+static gint
+virt_viewer_session_spice_get_rtt(VirtViewerSessionSpice *self)
+{
+    gint rtt = -1;
+#if defined(HAVE_NETINET_TCP_H) && defined(TCP_INFO)
+    GSocket *socket = NULL;
+
+    if (self->priv->main_channel == NULL)
+        return -1;
+
+    g_object_get(self->priv->main_channel, "socket", &socket, NULL);
+    if (socket == NULL)
+        return -1;
+
+    if (g_socket_get_family(socket) != G_SOCKET_FAMILY_UNIX) {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+
+        if (getsockopt(g_socket_get_fd(socket), IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+            rtt = info.tcpi_rtt / 1000;
+    }
+    g_object_unref(socket);
+#else
+    (void) self;
+#endif
+
+    return rtt;
+}
+
+static void
+virt_viewer_session_spice_apply_quality(VirtViewerSessionSpice *self)
+{
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+    const QualityProfile *profile = &quality_profiles[priv->quality.level];
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    gboolean update_geometry = FALSE;
+
+    virt_viewer_session_spice_update_display_preferences(self);
+
+    /* the color depth is sent along the monitor configuration */
+    if (priv->main_channel != NULL &&
+        g_object_class_find_property(G_OBJECT_GET_CLASS(priv->main_channel), "color-depth")) {
+        gint depth = 0;
+
+        g_object_get(priv->main_channel, "color-depth", &depth, NULL);
+        if (depth != profile->color_depth) {
+            g_object_set(priv->main_channel, "color-depth", profile->color_depth, NULL);
+            update_geometry = TRUE;
+        }
+    }
+
+    if (priv->adaptive_quality == ADAPTIVE_QUALITY_RENDER_SCALE) {
+        guint scale = virt_viewer_app_get_render_scale(app);
+
+        if (profile->render_scale > 1 && priv->quality_saved_scale == 0) {
+            priv->quality_saved_scale = scale;
+            if (profile->render_scale > scale) {
+                virt_viewer_app_set_render_scale(app, profile->render_scale);
+                update_geometry = TRUE;
+            }
+        } else if (profile->render_scale <= 1 && priv->quality_saved_scale != 0) {
+            virt_viewer_app_set_render_scale(app, priv->quality_saved_scale);
+            update_geometry = priv->quality_saved_scale != scale;
+            priv->quality_saved_scale = 0;
+        }
+    }
+
+    if (update_geometry && priv->main_channel != NULL)
+        virt_viewer_session_update_displays_geometry(VIRT_VIEWER_SESSION(self));
+}
+
+/* Starts from the level remembered for this guest, unless the controller
+ * already made a decision during this session */
+static void
+virt_viewer_session_spice_restore_quality(VirtViewerSessionSpice *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    VirtViewerQualityLevel level;
+    gchar *value;
+
+    if (self->priv->adaptive_quality == ADAPTIVE_QUALITY_DISABLED ||
+        self->priv->quality_decided)
+        return;
+
+    value = virt_viewer_app_get_guest_setting(app, "quality-level");
+    if (virt_viewer_quality_level_from_string(value, &level) &&
+        level != self->priv->quality.level) {
+        g_debug("Restoring %s adaptive quality", value);
+        virt_viewer_quality_controller_init(&self->priv->quality, level);
+        virt_viewer_session_spice_apply_quality(self);
+    }
+    g_free(value);
+}
+
+static gboolean
+virt_viewer_session_spice_sample_quality(gpointer user_data)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(user_data);
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    VirtViewerQualityLevel previous = priv->quality.level;
+    guint64 bytes = virt_viewer_session_spice_get_display_bytes(self);
+    gint64 now = g_get_monotonic_time();
+    guint64 rate = 0;
+    gint rtt = virt_viewer_session_spice_get_rtt(self);
+
+    /* the counters restart from 0 with new display channels */
+    if (now > priv->quality_last_time && bytes >= priv->quality_last_bytes)
+        rate = (bytes - priv->quality_last_bytes) * G_USEC_PER_SEC / (now - priv->quality_last_time);
+    priv->quality_last_bytes = bytes;
+    priv->quality_last_time = now;
+
+    if (!virt_viewer_quality_controller_sample(&priv->quality, rate, rtt)) {
+        if (++priv->quality_stable_samples == QUALITY_SAVE_SAMPLES)
+            virt_viewer_app_set_guest_setting(app, "quality-level",
+                                              virt_viewer_quality_level_to_string(priv->quality.level));
+        return G_SOURCE_CONTINUE;
+    }
+
+    virt_viewer_app_trace(app, "Switching from %s to %s display quality "
+                          "(%" G_GUINT64_FORMAT " bytes/s, round-trip time %d ms, base %d ms)",
+                          virt_viewer_quality_level_to_string(previous),
+                          virt_viewer_quality_level_to_string(priv->quality.level),
+                          rate, rtt, priv->quality.min_rtt);
+
+    priv->quality_decided = TRUE;
+    priv->quality_stable_samples = 0;
+    virt_viewer_session_spice_apply_quality(self);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+virt_viewer_session_spice_start_quality(VirtViewerSessionSpice *self)
+{
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+
+    if (priv->adaptive_quality == ADAPTIVE_QUALITY_DISABLED ||
+        priv->quality_timeout_id != 0)
+        return;
+
+    /* the base round-trip time of a new connection may differ */
+    virt_viewer_quality_controller_init(&priv->quality, priv->quality.level);
+    virt_viewer_session_spice_restore_quality(self);
+    virt_viewer_session_spice_apply_quality(self);
+
+    priv->quality_last_bytes = virt_viewer_session_spice_get_display_bytes(self);
+    priv->quality_last_time = g_get_monotonic_time();
+    priv->quality_stable_samples = 0;
+    priv->quality_timeout_id = g_timeout_add_seconds(QUALITY_SAMPLE_INTERVAL,
+                                                     virt_viewer_session_spice_sample_quality,
+                                                     self);
+}
+
+static void
+virt_viewer_session_spice_stop_quality(VirtViewerSessionSpice *self)
+{
+    if (self->priv->quality_timeout_id != 0) {
+        g_source_remove(self->priv->quality_timeout_id);
+        self->priv->quality_timeout_id = 0;
+    }
+}
+
+/**
+ * virt_viewer_session_spice_set_adaptive_quality:
+ * @self: the session
+ * @mode: 0 to disable, 1 to adapt the display quality to the network, 2 to
+ * also lower the render scale
+ *
+ * When enabled, the image compression, the video codecs and the color depth
+ * are chosen according to the throughput and the round-trip time measured
+ * during the session, instead of the static preferences. The last stable
+ * quality level is remembered for the next connection to the same guest.
+ */
+void
+virt_viewer_session_spice_set_adaptive_quality(VirtViewerSessionSpice *self, gint mode)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self));
+    g_return_if_fail(mode >= ADAPTIVE_QUALITY_DISABLED && mode <= ADAPTIVE_QUALITY_RENDER_SCALE);
+
+    if (self->priv->adaptive_quality == mode)
+        return;
+
+    self->priv->adaptive_quality = mode;
+    if (mode == ADAPTIVE_QUALITY_DISABLED) {
+        virt_viewer_session_spice_stop_quality(self);
+        virt_viewer_session_spice_update_display_preferences(self);
+    }
+}
+
+#define WATCHDOG_SAMPLE_INTERVAL 1 /* seconds */
+/* keepalive probes sent before the kernel gives up on the connection */
+#define WATCHDOG_KEEPALIVE_PROBES 3
+
+/*
+ * Returns the time since anything, data or acknowledgement, was last
+ * received on the connection of @channel, in ms, or -1 if it is not known.
+ */
+static gint
+virt_viewer_session_spice_get_channel_silence(SpiceChannel *channel G_GNUC_UNUSED)
+{
+    gint silence = -1;
+#if defined(HAVE_NETINET_TCP_H) && defined(TCP_INFO) && defined(HAVE_STRUCT_TCP_INFO_TCPI_LAST_ACK_RECV)
+    GSocket *socket = NULL;
+
+    g_object_get(channel, "socket", &socket, NULL);
+    if (socket == NULL)
+        return -1;
+
+    if (g_socket_get_family(socket) != G_SOCKET_FAMILY_UNIX) {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+
+        if (getsockopt(g_socket_get_fd(socket), IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+            silence = MIN(MIN(info.tcpi_last_data_recv, info.tcpi_last_ack_recv), G_MAXINT);
+    }
+    g_object_unref(socket);
+#endif
+
+    return silence;
+}
+
+/*
+ * Returns the longest silence of the main channel and the open display
+ * channels, in ms, or -1 if it is not known. A single stuck channel is
+ * enough to freeze the session.
+ */
+static gint
+virt_viewer_session_spice_get_silence(VirtViewerSessionSpice *self)
+{
+    GList *l, *channels;
+    gint silence = -1;
+
+    if (self->priv->session == NULL || self->priv->main_channel == NULL)
+        return -1;
+
+    channels = spice_session_get_channels(self->priv->session);
+    for (l = channels; l != NULL; l = l->next) {
+        if (l->data != (gpointer) self->priv->main_channel &&
+            !(SPICE_IS_DISPLAY_CHANNEL(l->data) &&
+              g_object_get_data(l->data, "virt-viewer-opened")))
+            continue;
+
+        silence = MAX(silence, virt_viewer_session_spice_get_channel_silence(l->data));
+    }
+    g_list_free(channels);
+
+    return silence;
+}
+
+/*
+ * Enables TCP keepalive on the connection of @channel so that an idle but
+ * healthy connection still gets acknowledgements from the server well
+ * within the stall timeout, and so that the kernel eventually gives up on
+ * a dead one by itself.
+ */
+static void
+virt_viewer_session_spice_set_keepalive(VirtViewerSessionSpice *self,
+                                        SpiceChannel *channel)
+{
+    GSocket *socket = NULL;
+
+    if (self->priv->stall_timeout <= 0)
+        return;
+
+    g_object_get(channel, "socket", &socket, NULL);
+    if (socket == NULL)
+        return;
+
+    if (g_socket_get_family(socket) != G_SOCKET_FAMILY_UNIX) {
+        g_socket_set_keepalive(socket, TRUE);
+#if defined(HAVE_NETINET_TCP_H) && defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+        {
+            int fd = g_socket_get_fd(socket);
+            int interval = MAX(self->priv->stall_timeout / WATCHDOG_KEEPALIVE_PROBES, 1);
+            int probes = WATCHDOG_KEEPALIVE_PROBES;
+
+            if (setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &interval, sizeof(interval)) < 0 ||
+                setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) < 0 ||
+                setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) < 0)
+                g_debug("Failed to set the keepalive parameters: %s", g_strerror(errno));
+        }
+#endif
+    }
+    g_object_unref(socket);
+}
+
+/* Counts the stalls of each guest, to tell a flaky network from a flaky
+ * host across sessions */
+static void
+virt_viewer_session_spice_record_stall(VirtViewerSessionSpice *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    GDateTime *now = g_date_time_new_now_utc();
+    gchar *value = virt_viewer_app_get_guest_setting(app, "stall-count");
+    guint64 count = value != NULL ? g_ascii_strtoull(value, NULL, 10) : 0;
+
+    g_free(value);
+    value = g_strdup_printf("%" G_GUINT64_FORMAT, count + 1);
+    virt_viewer_app_set_guest_setting(app, "stall-count", value);
+    g_free(value);
+
+    value = g_date_time_format(now, "%Y-%m-%dT%H:%M:%SZ");
+    virt_viewer_app_set_guest_setting(app, "last-stall", value);
+    g_free(value);
+    g_date_time_unref(now);
+}
+
+static gboolean
+virt_viewer_session_spice_sample_watchdog(gpointer user_data)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(user_data);
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+    SpiceSession *session;
+    gint silence = virt_viewer_session_spice_get_silence(self);
+
+    if (!virt_viewer_stall_watchdog_sample(&priv->watchdog, silence))
+        return G_SOURCE_CONTINUE;
+
+    virt_viewer_app_trace(app, "Nothing received from the graphic server for %d ms, "
+                          "the connection stalled (%u hiccups during the session)",
+                          silence, priv->watchdog.hiccups);
+    virt_viewer_session_spice_record_stall(self);
+    virt_viewer_app_show_status(app, _("The connection to the graphic server stalled"));
+    virt_viewer_app_set_disconnect_reason(app, _("The connection to the graphic server stalled"));
+
+    /* disconnecting lets the application reconnect or give up as it would
+     * for a lost connection, and may release the last reference to us */
+    priv->watchdog_timeout_id = 0;
+    session = g_object_ref(priv->session);
+    g_object_ref(self);
+    spice_session_disconnect(session);
+    g_object_unref(session);
+    g_object_unref(self);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_session_spice_start_watchdog(VirtViewerSessionSpice *self)
+{
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+
+    if (priv->stall_timeout <= 0 || priv->watchdog_timeout_id != 0)
+        return;
+
+    virt_viewer_stall_watchdog_init(&priv->watchdog, MIN(priv->stall_timeout, G_MAXINT / 1000) * 1000);
+    priv->watchdog_timeout_id = g_timeout_add_seconds(WATCHDOG_SAMPLE_INTERVAL,
+                                                      virt_viewer_session_spice_sample_watchdog,
+                                                      self);
+}
+
+static void
+virt_viewer_session_spice_stop_watchdog(VirtViewerSessionSpice *self)
+{
+    VirtViewerSessionSpicePrivate *priv = self->priv;
+
+    if (priv->watchdog_timeout_id != 0) {
+        g_source_remove(priv->watchdog_timeout_id);
+        priv->watchdog_timeout_id = 0;
+        g_debug("Liveness watchdog stopped: %u hiccups, longest silence %u ms",
+                priv->watchdog.hiccups, priv->watchdog.longest_silence);
+    }
+}
+
+/**
+ * virt_viewer_session_spice_set_stall_timeout:
+ * @self: the session
+ * @timeout: in seconds, 0 to disable
+ *
+ * When enabled, the main and display channel connections are kept alive
+ * with TCP keepalive probes, and the session is disconnected once nothing
+ * was received on one of them for @timeout seconds, instead of waiting for
+ * the kernel to give up on a black-holed connection. The stalls are
+ * counted in the guest settings. Takes effect at the next connection.
+ */
+void
+virt_viewer_session_spice_set_stall_timeout(VirtViewerSessionSpice *self, gint timeout)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self));
+    g_return_if_fail(timeout >= 0);
+
+    self->priv->stall_timeout = timeout;
+    if (timeout == 0)
+        virt_viewer_session_spice_stop_watchdog(self);
+}
+
+/**
+ * virt_viewer_session_spice_set_preferred_compression:
+ * @self: the session
+ * @compression: an image compression name (off, auto-glz, auto-lz, quic,
+ * glz, lz or lz4), or %NULL to use the server default
+ * @error: return location for an error
+ *
+ * Sets the image compression that the display channels will ask the server
+ * to use.
+ *
+ * Returns: %TRUE on success, %FALSE if @compression is unknown
+ */
+gboolean
+virt_viewer_session_spice_set_preferred_compression(VirtViewerSessionSpice *self,
+                                                    const gchar *compression,
+                                                    GError **error)
+{
+    gint value = SPICE_IMAGE_COMPRESSION_INVALID;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self), FALSE);
+
+    if (compression != NULL) {
+        value = spice_enum_from_name(compression_names, G_N_ELEMENTS(compression_names),
+                                     compression);
+        if (value < 0) {
+            g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        _("Unknown image compression: %s"), compression);
+            return FALSE;
+        }
+    }
+
+    if (self->priv->preferred_compression == value)
+        return TRUE;
+
+    self->priv->preferred_compression = value;
+    virt_viewer_session_spice_update_display_preferences(self);
+
+    return TRUE;
+}
+
+const gchar *
+virt_viewer_session_spice_get_preferred_compression(VirtViewerSessionSpice *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self), NULL);
+
+    return spice_enum_to_name(compression_names, G_N_ELEMENTS(compression_names),
+                              self->priv->preferred_compression);
+}
+
+/**
+ * virt_viewer_session_spice_set_preferred_video_codecs:
+ * @self: the session
+ * @codecs: (array zero-terminated=1): video codec names (mjpeg, vp8 or h264)
+ * in order of preference, or %NULL to use the server default
+ * @error: return location for an error
+ *
+ * Sets the video codecs that the display channels will ask the server to use
+ * for video streams.
+ *
+ * Returns: %TRUE on success, %FALSE if one of @codecs is unknown
+ */
+gboolean
+virt_viewer_session_spice_set_preferred_video_codecs(VirtViewerSessionSpice *self,
+                                                     const gchar * const *codecs,
+                                                     GError **error)
+{
+    GArray *values = NULL;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self), FALSE);
+
+    if (codecs != NULL && codecs[0] != NULL) {
+        gsize i;
+
+        values = g_array_new(FALSE, FALSE, sizeof(gint));
+        for (i = 0; codecs[i] != NULL; i++) {
+            gint value = spice_enum_from_name(video_codec_names, G_N_ELEMENTS(video_codec_names),
+                                              codecs[i]);
+            if (value < 0) {
+                g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Unknown video codec: %s"), codecs[i]);
+                g_array_unref(values);
+                return FALSE;
+            }
+            g_array_append_val(values, value);
+        }
+    }
+
+    g_clear_pointer(&self->priv->video_codecs, g_array_unref);
+    self->priv->video_codecs = values;
+    virt_viewer_session_spice_update_display_preferences(self);
+
+    return TRUE;
+}
+
+/**
+ * virt_viewer_session_spice_get_preferred_video_codecs:
+ * @self: the session
+ *
+ * Returns: (transfer full): the preferred video codec names, or %NULL if
+ * none was set
+ */
+gchar **
+virt_viewer_session_spice_get_preferred_video_codecs(VirtViewerSessionSpice *self)
+{
+    gchar **codecs;
+    guint i;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_SPICE(self), NULL);
+
+    if (self->priv->video_codecs == NULL)
+        return NULL;
+
+    codecs = g_new0(gchar *, self->priv->video_codecs->len + 1);
+    for (i = 0; i < self->priv->video_codecs->len; i++) {
+        gint value = g_array_index(self->priv->video_codecs, gint, i);
+        codecs[i] = g_strdup(spice_enum_to_name(video_codec_names,
+                                                G_N_ELEMENTS(video_codec_names),
+                                                value));
+    }
+
+    return codecs;
+}
+
+static gchar *
+virt_viewer_session_spice_get_display_settings(VirtViewerSession *session)
+{
+    VirtViewerSessionSpice *self = VIRT_VIEWER_SESSION_SPICE(session);
+    const gchar *compression = virt_viewer_session_spice_get_preferred_compression(self);
+    gchar **codecs = virt_viewer_session_spice_get_preferred_video_codecs(self);
+    GString *settings = g_string_new(NULL);
+
+    if (compression != NULL)
+        g_string_append_printf(settings, _("image compression: %s"), compression);
+
+    if (codecs != NULL) {
+        gchar *list = g_strjoinv(", ", codecs);
+
+        if (settings->len > 0)
+            g_string_append(settings, "; ");
+        g_string_append_printf(settings, _("video codecs: %s"), list);
+        g_free(list);
+        g_strfreev(codecs);
+    }
+
+    if (self->priv->adaptive_quality != ADAPTIVE_QUALITY_DISABLED) {
+        if (settings->len > 0)
+            g_string_append(settings, "; ");
+        g_string_append_printf(settings, _("adaptive quality: %s"),
+                               virt_viewer_quality_level_to_string(self->priv->quality.level));
+    }
+
+    if (self->priv->stall_timeout > 0) {
+        if (settings->len > 0)
+            g_string_append(settings, "; ");
+        g_string_append_printf(settings, _("stall timeout: %d s (longest silence: %u ms)"),
+                               self->priv->stall_timeout, self->priv->watchdog.longest_silence);
+    }
+
+    return g_string_free(settings, settings->len == 0);
+}
+
+static gchar *opt_preferred_compression = NULL;
+static gchar *opt_video_codecs = NULL;
+static gint opt_adaptive_quality = -1;
+static gint opt_stall_timeout = -1;
+
+void
+virt_viewer_session_spice_add_option_entries(GOptionGroup *group)
+{
+    static const GOptionEntry options[] = {
+        { "preferred-compression", '\0', 0, G_OPTION_ARG_STRING, &opt_preferred_compression,
+          N_("Preferred image compression of the Spice displays"),
+          N_("<off|auto-glz|auto-lz|quic|glz|lz|lz4>") },
+        { "video-codecs", '\0', 0, G_OPTION_ARG_STRING, &opt_video_codecs,
+          N_("Comma separated list of preferred Spice video codecs"),
+          N_("<mjpeg,vp8,h264>") },
+        { "adaptive-quality", '\0', 0, G_OPTION_ARG_INT, &opt_adaptive_quality,
+          N_("Adapt the Spice display quality to the network (0: off, 1: on, 2: also lower the render scale)"),
+          N_("<0|1|2>") },
+        { "stall-timeout", '\0', 0, G_OPTION_ARG_INT, &opt_stall_timeout,
+          N_("Consider the Spice connection stalled after this many seconds without traffic (0: off)"),
+          N_("<seconds>") },
+        { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
+    };
+
+    g_option_group_add_entries(group, options);
+}
+
+static void
+virt_viewer_session_spice_set_options(VirtViewerSessionSpice *self)
+{
+    GError *error = NULL;
+
+    if (opt_preferred_compression != NULL &&
+        !virt_viewer_session_spice_set_preferred_compression(self, opt_preferred_compression, &error)) {
+        g_warning("%s", error->message);
+        g_clear_error(&error);
+    }
+
+    if (opt_video_codecs != NULL) {
+        gchar **codecs = g_strsplit(opt_video_codecs, ",", -1);
+
+        if (!virt_viewer_session_spice_set_preferred_video_codecs(self, (const gchar * const *) codecs, &error)) {
+            g_warning("%s", error->message);
+            g_clear_error(&error);
+        }
+        g_strfreev(codecs);
+    }
+
+    if (opt_adaptive_quality > ADAPTIVE_QUALITY_RENDER_SCALE) {
+        g_warning("Invalid adaptive quality mode: %d", opt_adaptive_quality);
+    } else if (opt_adaptive_quality >= 0) {
+        virt_viewer_session_spice_set_adaptive_quality(self, opt_adaptive_quality);
+    }
+
+    if (opt_stall_timeout >= 0)
+        virt_viewer_session_spice_set_stall_timeout(self, opt_stall_timeout);
+}
+
 static void
 create_spice_session(VirtViewerSessionSpice *self);
 
@@ -233,6 +1120,8 @@ virt_viewer_session_spice_constructed(GObject *obj)
     self->priv->file_transfer_dialog =
         virt_viewer_file_transfer_dialog_new(self->priv->main_window);
 
+    virt_viewer_session_spice_set_options(self);
+
     G_OBJECT_CLASS(virt_viewer_session_spice_parent_class)->constructed(obj);
 }
 
@@ -259,6 +1148,8 @@ virt_viewer_session_spice_class_init(VirtViewerSessionSpiceClass *klass)
     dclass->apply_monitor_geometry = virt_viewer_session_spice_apply_monitor_geometry;
     dclass->can_share_folder = virt_viewer_session_spice_can_share_folder;
     dclass->can_retry_auth = virt_viewer_session_spice_can_retry_auth;
+    dclass->can_render_scale = virt_viewer_session_spice_can_render_scale;
+    dclass->get_display_settings = virt_viewer_session_spice_get_display_settings;
 
     g_type_class_add_private(klass, sizeof(VirtViewerSessionSpicePrivate));
 
@@ -287,6 +1178,8 @@ static void
 virt_viewer_session_spice_init(VirtViewerSessionSpice *self G_GNUC_UNUSED)
 {
     self->priv = VIRT_VIEWER_SESSION_SPICE_GET_PRIVATE(self);
+    self->priv->preferred_compression = SPICE_IMAGE_COMPRESSION_INVALID;
+    virt_viewer_quality_controller_init(&self->priv->quality, VIRT_VIEWER_QUALITY_HIGH);
 }
 
 static void
@@ -363,6 +1256,10 @@ uuid_changed(GObject *gobject G_GNUC_UNUSED,
         }
     }
 
+    /* the guest may have its own profile in the settings */
+    virt_viewer_session_spice_apply_profile(self);
+    virt_viewer_session_spice_restore_quality(self);
+
     virt_viewer_session_spice_fullscreen_auto_conf(self);
 }
 
@@ -457,6 +1354,8 @@ virt_viewer_session_spice_close(VirtViewerSession *session)
     g_object_add_weak_pointer(G_OBJECT(self), (gpointer*)&self);
 
     virt_viewer_session_spice_clear_displays(self);
+    virt_viewer_session_spice_stop_quality(self);
+    virt_viewer_session_spice_stop_watchdog(self);
 
     if (self->priv->session) {
         spice_session_disconnect(self->priv->session);
@@ -475,6 +1374,26 @@ virt_viewer_session_spice_close(VirtViewerSession *session)
     create_spice_session(self);
 }
 
+static gboolean
+virt_viewer_session_spice_connect(VirtViewerSessionSpice *self)
+{
+    int fd = virt_viewer_session_steal_preconnected_fd(VIRT_VIEWER_SESSION(self));
+
+    if (fd >= 0) {
+        /* Only the main channel gets the pre-connected socket, the others
+         * connect to the host and port of the session as usual */
+        g_debug("Using pre-connected socket %d for the main channel", fd);
+        if (!spice_session_open_fd(self->priv->session, fd)) {
+            close(fd);
+            return FALSE;
+        }
+        g_object_set(self->priv->session, "client-sockets", FALSE, NULL);
+        return TRUE;
+    }
+
+    return spice_session_connect(self->priv->session);
+}
+
 static gboolean
 virt_viewer_session_spice_open_host(VirtViewerSession *session,
                                     const gchar *host,
@@ -491,56 +1410,51 @@ virt_viewer_session_spice_open_host(VirtViewerSession *session,
                  "port", port,
                  "tls-port", tlsport,
                  NULL);
+    virt_viewer_session_spice_apply_profile(self);
 
-    return spice_session_connect(self->priv->session);
+    return virt_viewer_session_spice_connect(self);
 }
 
 static void
 fill_session(VirtViewerFile *file, SpiceSession *session)
 {
+    const VirtViewerFileSettings *settings;
+
     g_return_if_fail(VIRT_VIEWER_IS_FILE(file));
     g_return_if_fail(SPICE_IS_SESSION(session));
 
-    if (virt_viewer_file_is_set(file, "host")) {
-        gchar *val = virt_viewer_file_get_host(file);
-        g_object_set(G_OBJECT(session), "host", val, NULL);
-        g_free(val);
-    }
+    settings = virt_viewer_file_get_settings(file);
+
+    if (virt_viewer_file_is_set(file, "host"))
+        g_object_set(G_OBJECT(session), "host", settings->host, NULL);
 
     if (virt_viewer_file_is_set(file, "port")) {
-        gchar *port = g_strdup_printf("%d", virt_viewer_file_get_port(file));
+        gchar port[16];
+        g_snprintf(port, sizeof(port), "%d", settings->port);
         g_object_set(G_OBJECT(session), "port", port, NULL);
-        g_free(port);
     }
     if (virt_viewer_file_is_set(file, "tls-port")) {
-        gchar *tls_port = g_strdup_printf("%d", virt_viewer_file_get_tls_port(file));
+        gchar tls_port[16];
+        g_snprintf(tls_port, sizeof(tls_port), "%d", settings->tls_port);
         g_object_set(G_OBJECT(session), "tls-port", tls_port, NULL);
-        g_free(tls_port);
     }
 
-    if (virt_viewer_file_is_set(file, "username")) {
-        gchar *val = virt_viewer_file_get_username(file);
-        g_object_set(G_OBJECT(session), "username", val, NULL);
-        g_free(val);
-    }
+    if (virt_viewer_file_is_set(file, "username"))
+        g_object_set(G_OBJECT(session), "username", settings->username, NULL);
 
-    if (virt_viewer_file_is_set(file, "password")) {
-        gchar *val = virt_viewer_file_get_password(file);
-        g_object_set(G_OBJECT(session), "password", val, NULL);
-        g_free(val);
-    }
+    if (virt_viewer_file_is_set(file, "password"))
+        g_object_set(G_OBJECT(session), "password", settings->password, NULL);
 
-    if (virt_viewer_file_is_set(file, "tls-ciphers")) {
-        gchar *val = virt_viewer_file_get_tls_ciphers(file);
-        g_object_set(G_OBJECT(session), "ciphers", val, NULL);
-        g_free(val);
-    }
+    if (virt_viewer_file_is_set(file, "tls-ciphers"))
+        g_object_set(G_OBJECT(session), "ciphers", settings->tls_ciphers, NULL);
 
     if (virt_viewer_file_is_set(file, "ca")) {
-        gchar *ca = virt_viewer_file_get_ca(file);
-        g_return_if_fail(ca != NULL);
+        GByteArray *ba;
+
+        g_return_if_fail(settings->ca != NULL);
 
-        GByteArray *ba = g_byte_array_new_take((guint8 *)ca, strlen(ca) + 1);
+        ba = g_byte_array_sized_new(strlen(settings->ca) + 1);
+        g_byte_array_append(ba, (const guint8 *)settings->ca, strlen(settings->ca) + 1);
         g_object_set(G_OBJECT(session),
                      "ca", ba,
                      "ca-file", NULL,
@@ -548,66 +1462,78 @@ fill_session(VirtViewerFile *file, SpiceSession *session)
         g_byte_array_unref(ba);
     }
 
-    if (virt_viewer_file_is_set(file, "host-subject")) {
-        gchar *val = virt_viewer_file_get_host_subject(file);
-        g_object_set(G_OBJECT(session), "cert-subject", val, NULL);
-        g_free(val);
-    }
+    if (virt_viewer_file_is_set(file, "host-subject"))
+        g_object_set(G_OBJECT(session), "cert-subject", settings->host_subject, NULL);
 
-    if (virt_viewer_file_is_set(file, "proxy")) {
-        gchar *val = virt_viewer_file_get_proxy(file);
-        g_object_set(G_OBJECT(session), "proxy", val, NULL);
-        g_free(val);
-    }
+    if (virt_viewer_file_is_set(file, "proxy"))
+        g_object_set(G_OBJECT(session), "proxy", settings->proxy, NULL);
 
     if (virt_viewer_file_is_set(file, "enable-smartcard")) {
         g_object_set(G_OBJECT(session),
-                     "enable-smartcard", virt_viewer_file_get_enable_smartcard(file), NULL);
+                     "enable-smartcard", settings->enable_smartcard, NULL);
     }
 
     if (virt_viewer_file_is_set(file, "enable-usbredir")) {
         g_object_set(G_OBJECT(session),
-                     "enable-usbredir", virt_viewer_file_get_enable_usbredir(file), NULL);
+                     "enable-usbredir", settings->enable_usbredir, NULL);
     }
 
     if (virt_viewer_file_is_set(file, "color-depth")) {
         g_object_set(G_OBJECT(session),
-                     "color-depth", virt_viewer_file_get_color_depth(file), NULL);
+                     "color-depth", settings->color_depth, NULL);
     }
 
-    if (virt_viewer_file_is_set(file, "disable-effects")) {
-        gchar **disabled = virt_viewer_file_get_disable_effects(file, NULL);
-        g_object_set(G_OBJECT(session), "disable-effects", disabled, NULL);
-        g_strfreev(disabled);
-    }
+    if (virt_viewer_file_is_set(file, "disable-effects"))
+        g_object_set(G_OBJECT(session), "disable-effects", settings->disable_effects, NULL);
 
     if (virt_viewer_file_is_set(file, "enable-usb-autoshare")) {
-        gboolean enabled = virt_viewer_file_get_enable_usb_autoshare(file);
         SpiceGtkSession *gtk = spice_gtk_session_get(session);
-        g_object_set(G_OBJECT(gtk), "auto-usbredir", enabled, NULL);
+        g_object_set(G_OBJECT(gtk), "auto-usbredir", settings->enable_usb_autoshare, NULL);
     }
 
     if (virt_viewer_file_is_set(file, "usb-filter")) {
-        gchar *filterstr = virt_viewer_file_get_usb_filter(file);
         SpiceUsbDeviceManager *manager = spice_usb_device_manager_get(session,
                                                                       NULL);
         if (manager != NULL) {
-            g_object_set(manager, "auto-connect-filter", filterstr, NULL);
+            g_object_set(manager, "auto-connect-filter", settings->usb_filter, NULL);
         }
-        g_free(filterstr);
     }
 
-    if (virt_viewer_file_is_set(file, "secure-channels")) {
-        gchar **channels = virt_viewer_file_get_secure_channels(file, NULL);
-        g_object_set(G_OBJECT(session), "secure-channels", channels, NULL);
-        g_strfreev(channels);
-    }
+    if (virt_viewer_file_is_set(file, "secure-channels"))
+        g_object_set(G_OBJECT(session), "secure-channels", settings->secure_channels, NULL);
 
     if (virt_viewer_file_is_set(file, "disable-channels")) {
         g_debug("FIXME: disable-channels is not supported atm");
     }
 }
 
+static void
+fill_display_preferences(VirtViewerFile *file, VirtViewerSessionSpice *self)
+{
+    const VirtViewerFileSettings *settings = virt_viewer_file_get_settings(file);
+    GError *error = NULL;
+
+    if (virt_viewer_file_is_set(file, "preferred-compression")) {
+        if (!virt_viewer_session_spice_set_preferred_compression(self, settings->preferred_compression, &error)) {
+            g_warning("%s", error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    if (virt_viewer_file_is_set(file, "preferred-video-codecs")) {
+        if (!virt_viewer_session_spice_set_preferred_video_codecs(self, settings->preferred_video_codecs, &error)) {
+            g_warning("%s", error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    if (virt_viewer_file_is_set(file, "adaptive-quality"))
+        virt_viewer_session_spice_set_adaptive_quality(self, settings->adaptive_quality);
+
+    if (virt_viewer_file_is_set(file, "stall-timeout"))
+        virt_viewer_session_spice_set_stall_timeout(self, settings->stall_timeout);
+}
+
 static gboolean
 virt_viewer_session_spice_open_uri(VirtViewerSession *session,
                                    const gchar *uri, GError **error)
@@ -620,14 +1546,24 @@ virt_viewer_session_spice_open_uri(VirtViewerSession *session,
     g_return_val_if_fail(self->priv->session != NULL, FALSE);
 
     if (file) {
-        fill_session(file, self->priv->session);
-        if (!virt_viewer_file_fill_app(file, app, error))
+        /* the profile may come from the file, and its other settings take
+         * precedence over it; the settings of the application only come
+         * from the file of its own session */
+        if (virt_viewer_app_get_session(app) == session) {
+            if (!virt_viewer_file_fill_app(file, app, error))
+                return FALSE;
+        } else if (!virt_viewer_file_check_min_version(file, error)) {
             return FALSE;
+        }
+        virt_viewer_session_spice_apply_profile(self);
+        fill_session(file, self->priv->session);
+        fill_display_preferences(file, self);
     } else {
         g_object_set(self->priv->session, "uri", uri, NULL);
+        virt_viewer_session_spice_apply_profile(self);
     }
 
-    return spice_session_connect(self->priv->session);
+    return virt_viewer_session_spice_connect(self);
 }
 
 static gboolean
@@ -638,6 +1574,7 @@ virt_viewer_session_spice_open_fd(VirtViewerSession *session,
 
     g_return_val_if_fail(self != NULL, FALSE);
 
+    virt_viewer_session_spice_apply_profile(self);
     return spice_session_open_fd(self->priv->session, fd);
 }
 
@@ -655,9 +1592,11 @@ virt_viewer_session_spice_channel_open_fd(VirtViewerSession *session,
 
 static void
 virt_viewer_session_spice_channel_open_fd_request(SpiceChannel *channel,
-                                                  gint tls G_GNUC_UNUSED,
+                                                  gint tls,
                                                   VirtViewerSession *session)
 {
+    /* tells a connection broker which port the channel expects */
+    g_object_set_data(G_OBJECT(channel), "virt-viewer-tls", GINT_TO_POINTER(tls));
     g_signal_emit_by_name(session, "session-channel-open", channel);
 }
 
@@ -677,9 +1616,14 @@ virt_viewer_session_spice_main_channel_event(SpiceChannel *channel,
     case SPICE_CHANNEL_OPENED:
         g_debug("main channel: opened");
         g_signal_emit_by_name(session, "session-connected");
+        virt_viewer_session_spice_start_quality(self);
+        virt_viewer_session_spice_set_keepalive(self, channel);
+        virt_viewer_session_spice_start_watchdog(self);
         break;
     case SPICE_CHANNEL_CLOSED:
         g_debug("main channel: closed");
+        virt_viewer_session_spice_stop_quality(self);
+        virt_viewer_session_spice_stop_watchdog(self);
         /* Ensure the other channels get closed too */
         virt_viewer_session_spice_clear_displays(self);
         if (self->priv->session)
@@ -882,6 +1826,9 @@ virt_viewer_session_spice_display_monitors(SpiceChannel *channel,
     g_return_if_fail(monitors != NULL);
     g_return_if_fail(monitors->len <= monitors_max);
 
+    if (self->priv->profile != NULL && self->priv->profile->max_monitors > 0)
+        monitors_max = MIN(monitors_max, self->priv->profile->max_monitors);
+
     displays = g_object_get_data(G_OBJECT(channel), "virt-viewer-displays");
     if (displays == NULL) {
         displays = g_ptr_array_new();
@@ -910,6 +1857,12 @@ virt_viewer_session_spice_display_monitors(SpiceChannel *channel,
     for (i = 0; i < monitors->len; i++) {
         SpiceDisplayMonitorConfig *monitor = &g_array_index(monitors, SpiceDisplayMonitorConfig, i);
         gboolean disabled = monitor->width == 0 || monitor->height == 0;
+
+        if (monitor->id >= monitors_max) {
+            g_debug("ignoring display %d, above the profile limit", monitor->id + 1);
+            continue;
+        }
+
         display = g_ptr_array_index(displays, monitor->id);
         g_return_if_fail(display != NULL);
 
@@ -947,6 +1900,19 @@ on_new_file_transfer(SpiceMainChannel *channel G_GNUC_UNUSED,
                                               task);
 }
 
+static void
+virt_viewer_session_spice_display_channel_event(SpiceChannel *channel,
+                                                SpiceChannelEvent event,
+                                                VirtViewerSessionSpice *self)
+{
+    if (event != SPICE_CHANNEL_OPENED)
+        return;
+
+    g_object_set_data(G_OBJECT(channel), "virt-viewer-opened", GINT_TO_POINTER(TRUE));
+    virt_viewer_session_spice_apply_display_preferences(self, channel);
+    virt_viewer_session_spice_set_keepalive(self, channel);
+}
+
 static void
 virt_viewer_session_spice_channel_new(SpiceSession *s,
                                       SpiceChannel *channel,
@@ -986,6 +1952,9 @@ virt_viewer_session_spice_channel_new(SpiceSession *s,
     if (SPICE_IS_DISPLAY_CHANNEL(channel)) {
         g_signal_emit_by_name(session, "session-initialized");
 
+        virt_viewer_signal_connect_object(channel, "channel-event",
+                                          G_CALLBACK(virt_viewer_session_spice_display_channel_event), self, 0);
+
         virt_viewer_signal_connect_object(channel, "notify::monitors",
                                           G_CALLBACK(virt_viewer_session_spice_display_monitors), self, 0);
 
@@ -1069,6 +2038,7 @@ virt_viewer_session_spice_fullscreen_auto_conf(VirtViewerSessionSpice *self)
     }
 
     virt_viewer_shift_monitors_to_origin(displays);
+    virt_viewer_scale_monitors(displays, virt_viewer_session_get_render_scale(VIRT_VIEWER_SESSION(self)));
 
     g_hash_table_iter_init(&iter, displays);
     while (g_hash_table_iter_next(&iter, &key, &value)) {
@@ -66,6 +66,17 @@ GType virt_viewer_session_spice_get_type(void);
 
 VirtViewerSession* virt_viewer_session_spice_new(VirtViewerApp *app, GtkWindow *main_window);
 SpiceMainChannel* virt_viewer_session_spice_get_main_channel(VirtViewerSessionSpice *self);
+gboolean virt_viewer_session_spice_set_preferred_compression(VirtViewerSessionSpice *self,
+                                                             const gchar *compression,
+                                                             GError **error);
+const gchar *virt_viewer_session_spice_get_preferred_compression(VirtViewerSessionSpice *self);
+gboolean virt_viewer_session_spice_set_preferred_video_codecs(VirtViewerSessionSpice *self,
+                                                              const gchar * const *codecs,
+                                                              GError **error);
+gchar **virt_viewer_session_spice_get_preferred_video_codecs(VirtViewerSessionSpice *self);
+void virt_viewer_session_spice_set_adaptive_quality(VirtViewerSessionSpice *self, gint mode);
+void virt_viewer_session_spice_set_stall_timeout(VirtViewerSessionSpice *self, gint timeout);
+void virt_viewer_session_spice_add_option_entries(GOptionGroup *group);
 
 G_END_DECLS
 
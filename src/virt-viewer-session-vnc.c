@@ -28,6 +28,7 @@
 #define GLIB_DISABLE_DEPRECATION_WARNINGS
 
 #include "virt-viewer-auth.h"
+#include "virt-viewer-util.h"
 #include "virt-viewer-session-vnc.h"
 #include "virt-viewer-display-vnc.h"
 
@@ -40,6 +41,10 @@ struct _VirtViewerSessionVncPrivate {
     GtkWindow *main_window;
     /* XXX we should really just have a VncConnection */
     VncDisplay *vnc;
+    gint lossy_encoding; /* -1 for the profile default */
+    VncDisplayDepthColor depth;
+    gint shared_flag; /* -1 for the gtk-vnc default */
+    const VirtViewerProfile *profile;
 };
 
 #define VIRT_VIEWER_SESSION_VNC_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE((o), VIRT_VIEWER_TYPE_SESSION_VNC, VirtViewerSessionVncPrivate))
@@ -50,6 +55,7 @@ static gboolean virt_viewer_session_vnc_open_host(VirtViewerSession* session, co
 static gboolean virt_viewer_session_vnc_open_uri(VirtViewerSession* session, const gchar *uri, GError **error);
 static gboolean virt_viewer_session_vnc_channel_open_fd(VirtViewerSession* session,
                                                         VirtViewerSessionChannel* channel, int fd);
+static gchar *virt_viewer_session_vnc_get_display_settings(VirtViewerSession *session);
 
 
 static void
@@ -87,6 +93,7 @@ virt_viewer_session_vnc_class_init(VirtViewerSessionVncClass *klass)
     dclass->open_uri = virt_viewer_session_vnc_open_uri;
     dclass->channel_open_fd = virt_viewer_session_vnc_channel_open_fd;
     dclass->mime_type = virt_viewer_session_vnc_mime_type;
+    dclass->get_display_settings = virt_viewer_session_vnc_get_display_settings;
 
     g_type_class_add_private(klass, sizeof(VirtViewerSessionVncPrivate));
 }
@@ -95,6 +102,253 @@ static void
 virt_viewer_session_vnc_init(VirtViewerSessionVnc *self G_GNUC_UNUSED)
 {
     self->priv = VIRT_VIEWER_SESSION_VNC_GET_PRIVATE(self);
+    self->priv->lossy_encoding = -1;
+    self->priv->depth = VNC_DISPLAY_DEPTH_COLOR_DEFAULT;
+    self->priv->shared_flag = -1;
+}
+
+static const struct {
+    VncDisplayDepthColor depth;
+    const gchar *name;
+} depth_names[] = {
+    { VNC_DISPLAY_DEPTH_COLOR_DEFAULT, "default" },
+    { VNC_DISPLAY_DEPTH_COLOR_FULL, "full" },
+    { VNC_DISPLAY_DEPTH_COLOR_MEDIUM, "medium" },
+    { VNC_DISPLAY_DEPTH_COLOR_LOW, "low" },
+    { VNC_DISPLAY_DEPTH_COLOR_ULTRA_LOW, "ultra-low" },
+};
+
+/**
+ * virt_viewer_session_vnc_set_lossy_encoding:
+ * @self: the session
+ * @lossy: whether to allow lossy encodings
+ *
+ * Allows the server to use lossy (JPEG compressed tight) encodings, which
+ * need a lot less bandwidth for photographic content. This takes effect at
+ * the next connection.
+ */
+void
+virt_viewer_session_vnc_set_lossy_encoding(VirtViewerSessionVnc *self, gboolean lossy)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION_VNC(self));
+
+    self->priv->lossy_encoding = lossy ? 1 : 0;
+}
+
+gboolean
+virt_viewer_session_vnc_get_lossy_encoding(VirtViewerSessionVnc *self)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_VNC(self), FALSE);
+
+    if (self->priv->lossy_encoding >= 0)
+        return self->priv->lossy_encoding;
+
+    return self->priv->profile != NULL && self->priv->profile->vnc_lossy_encoding;
+}
+
+static gboolean
+depth_from_name(const gchar *name, VncDisplayDepthColor *depth)
+{
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS(depth_names); i++) {
+        if (g_str_equal(name, depth_names[i].name)) {
+            *depth = depth_names[i].depth;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * virt_viewer_session_vnc_set_depth:
+ * @self: the session
+ * @depth: a color depth name (default, full, medium, low or ultra-low)
+ * @error: return location for an error
+ *
+ * Sets the pixel format requested from the server: full is 24 bits per
+ * pixel, medium 16, low 8 and ultra-low 3. This takes effect at the next
+ * connection.
+ *
+ * Returns: %TRUE on success, %FALSE if @depth is unknown
+ */
+gboolean
+virt_viewer_session_vnc_set_depth(VirtViewerSessionVnc *self,
+                                  const gchar *depth,
+                                  GError **error)
+{
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_VNC(self), FALSE);
+    g_return_val_if_fail(depth != NULL, FALSE);
+
+    if (!depth_from_name(depth, &self->priv->depth)) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("Unknown color depth: %s"), depth);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+VncDisplayDepthColor
+virt_viewer_session_vnc_get_depth(VirtViewerSessionVnc *self)
+{
+    VncDisplayDepthColor depth = VNC_DISPLAY_DEPTH_COLOR_DEFAULT;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION_VNC(self), VNC_DISPLAY_DEPTH_COLOR_DEFAULT);
+
+    if (self->priv->depth != VNC_DISPLAY_DEPTH_COLOR_DEFAULT)
+        return self->priv->depth;
+
+    if (self->priv->profile != NULL && self->priv->profile->vnc_depth != NULL)
+        depth_from_name(self->priv->profile->vnc_depth, &depth);
+
+    return depth;
+}
+
+static void
+virt_viewer_session_vnc_apply_profile(VirtViewerSessionVnc *self)
+{
+    VirtViewerApp *app = virt_viewer_session_get_app(VIRT_VIEWER_SESSION(self));
+
+    self->priv->profile = virt_viewer_app_get_profile(app);
+    if (self->priv->profile != NULL)
+        g_debug("Using the %s profile", self->priv->profile->name);
+}
+
+/**
+ * virt_viewer_session_vnc_set_shared_flag:
+ * @self: the session
+ * @shared: whether other clients may stay connected to the server
+ *
+ * This takes effect at the next connection.
+ */
+void
+virt_viewer_session_vnc_set_shared_flag(VirtViewerSessionVnc *self, gboolean shared)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION_VNC(self));
+
+    self->priv->shared_flag = shared ? 1 : 0;
+}
+
+/* Called before opening the connection. Unlike the other settings, which
+ * are only used once the connection is initialized, gtk-vnc reads the
+ * shared flag when opening. */
+static void
+virt_viewer_session_vnc_prepare_open(VirtViewerSessionVnc *self)
+{
+    virt_viewer_session_vnc_apply_profile(self);
+
+    if (self->priv->shared_flag >= 0)
+        vnc_display_set_shared_flag(self->priv->vnc, self->priv->shared_flag);
+}
+
+static gchar *
+virt_viewer_session_vnc_get_display_settings(VirtViewerSession *session)
+{
+    VirtViewerSessionVnc *self = VIRT_VIEWER_SESSION_VNC(session);
+    GString *settings = g_string_new(NULL);
+    gsize i;
+
+    VncDisplayDepthColor depth = virt_viewer_session_vnc_get_depth(self);
+
+    if (virt_viewer_session_vnc_get_lossy_encoding(self))
+        g_string_append(settings, _("lossy encoding"));
+
+    for (i = 1; i < G_N_ELEMENTS(depth_names); i++) {
+        if (depth != depth_names[i].depth)
+            continue;
+
+        if (settings->len > 0)
+            g_string_append(settings, "; ");
+        g_string_append_printf(settings, _("color depth: %s"), depth_names[i].name);
+        break;
+    }
+
+    if (self->priv->shared_flag >= 0) {
+        if (settings->len > 0)
+            g_string_append(settings, "; ");
+        g_string_append(settings, self->priv->shared_flag ? _("shared") : _("exclusive"));
+    }
+
+    return g_string_free(settings, settings->len == 0);
+}
+
+static gboolean opt_vnc_lossy_encoding = FALSE;
+static gchar *opt_vnc_depth = NULL;
+static gboolean opt_vnc_shared = FALSE;
+static gboolean opt_vnc_exclusive = FALSE;
+
+void
+virt_viewer_session_vnc_add_option_entries(GOptionGroup *group)
+{
+    static const GOptionEntry options[] = {
+        { "vnc-lossy-encoding", '\0', 0, G_OPTION_ARG_NONE, &opt_vnc_lossy_encoding,
+          N_("Allow lossy JPEG encodings of the VNC display"), NULL },
+        { "vnc-depth", '\0', 0, G_OPTION_ARG_STRING, &opt_vnc_depth,
+          N_("Color depth of the VNC display"),
+          N_("<default|full|medium|low|ultra-low>") },
+        { "vnc-shared", '\0', 0, G_OPTION_ARG_NONE, &opt_vnc_shared,
+          N_("Let other clients stay connected to the VNC server"), NULL },
+        { "vnc-exclusive", '\0', 0, G_OPTION_ARG_NONE, &opt_vnc_exclusive,
+          N_("Disconnect other clients of the VNC server"), NULL },
+        { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
+    };
+
+    g_option_group_add_entries(group, options);
+}
+
+/* Checks the options once parsed, before any session is created */
+gboolean
+virt_viewer_session_vnc_check_options(GError **error)
+{
+    if (opt_vnc_shared && opt_vnc_exclusive) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("--vnc-shared and --vnc-exclusive can't be used together"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+virt_viewer_session_vnc_set_options(VirtViewerSessionVnc *self)
+{
+    GError *error = NULL;
+
+    if (opt_vnc_lossy_encoding)
+        virt_viewer_session_vnc_set_lossy_encoding(self, TRUE);
+
+    if (opt_vnc_depth != NULL &&
+        !virt_viewer_session_vnc_set_depth(self, opt_vnc_depth, &error)) {
+        g_warning("%s", error->message);
+        g_clear_error(&error);
+    }
+
+    if (opt_vnc_shared)
+        virt_viewer_session_vnc_set_shared_flag(self, TRUE);
+    else if (opt_vnc_exclusive)
+        virt_viewer_session_vnc_set_shared_flag(self, FALSE);
+}
+
+static void
+fill_display_settings(VirtViewerFile *file, VirtViewerSessionVnc *self)
+{
+    const VirtViewerFileSettings *settings = virt_viewer_file_get_settings(file);
+    GError *error = NULL;
+
+    if (virt_viewer_file_is_set(file, "vnc-lossy-encoding"))
+        virt_viewer_session_vnc_set_lossy_encoding(self, settings->vnc_lossy_encoding);
+
+    if (virt_viewer_file_is_set(file, "vnc-depth")) {
+        if (!virt_viewer_session_vnc_set_depth(self, settings->vnc_depth, &error)) {
+            g_warning("%s", error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    if (virt_viewer_file_is_set(file, "vnc-shared"))
+        virt_viewer_session_vnc_set_shared_flag(self, settings->vnc_shared);
 }
 
 static void
@@ -180,6 +434,7 @@ virt_viewer_session_vnc_open_fd(VirtViewerSession* session,
     g_return_val_if_fail(self != NULL, FALSE);
     g_return_val_if_fail(self->priv->vnc != NULL, FALSE);
 
+    virt_viewer_session_vnc_prepare_open(self);
     return vnc_display_open_fd(self->priv->vnc, fd);
 }
 
@@ -192,6 +447,22 @@ virt_viewer_session_vnc_channel_open_fd(VirtViewerSession* session G_GNUC_UNUSED
     return FALSE;
 }
 
+static gboolean
+virt_viewer_session_vnc_connect(VirtViewerSessionVnc *self,
+                                const gchar *host,
+                                const gchar *port)
+{
+    int fd = virt_viewer_session_steal_preconnected_fd(VIRT_VIEWER_SESSION(self));
+
+    virt_viewer_session_vnc_prepare_open(self);
+    if (fd >= 0) {
+        g_debug("Using pre-connected socket %d", fd);
+        return vnc_display_open_fd(self->priv->vnc, fd);
+    }
+
+    return vnc_display_open_host(self->priv->vnc, host, port);
+}
+
 static gboolean
 virt_viewer_session_vnc_open_host(VirtViewerSession* session,
                                   const gchar *host,
@@ -203,7 +474,7 @@ virt_viewer_session_vnc_open_host(VirtViewerSession* session,
     g_return_val_if_fail(self != NULL, FALSE);
     g_return_val_if_fail(self->priv->vnc != NULL, FALSE);
 
-    return vnc_display_open_host(self->priv->vnc, host, port);
+    return virt_viewer_session_vnc_connect(self, host, port);
 }
 
 static gboolean
@@ -227,9 +498,16 @@ virt_viewer_session_vnc_open_uri(VirtViewerSession* session,
 
         portstr = g_strdup_printf("%d", virt_viewer_file_get_port(file));
         hoststr = g_strdup(virt_viewer_file_get_host(file));
-
-        if (!virt_viewer_file_fill_app(file, app, error))
+        fill_display_settings(file, self);
+
+        /* the settings of the application only come from the file of its
+         * own session */
+        if (virt_viewer_app_get_session(app) == session) {
+            if (!virt_viewer_file_fill_app(file, app, error))
+                return FALSE;
+        } else if (!virt_viewer_file_check_min_version(file, error)) {
             return FALSE;
+        }
     } else {
         xmlURIPtr uri = NULL;
         if (!(uri = xmlParseURI(uristr)))
@@ -251,9 +529,7 @@ virt_viewer_session_vnc_open_uri(VirtViewerSession* session,
         xmlFreeURI(uri);
     }
 
-    ret = vnc_display_open_host(self->priv->vnc,
-                                hoststr,
-                                portstr);
+    ret = virt_viewer_session_vnc_connect(self, hoststr, portstr);
     g_free(portstr);
     g_free(hoststr);
     return ret;
@@ -428,6 +704,8 @@ virt_viewer_session_vnc_new(VirtViewerApp *app, GtkWindow *main_window)
     g_signal_connect(session->priv->vnc, "vnc-auth-credential",
                      G_CALLBACK(virt_viewer_session_vnc_auth_credential), session);
 
+    virt_viewer_session_vnc_set_options(session);
+
     return VIRT_VIEWER_SESSION(session);
 }
 
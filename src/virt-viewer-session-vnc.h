@@ -65,6 +65,15 @@ struct _VirtViewerSessionVncClass {
 GType virt_viewer_session_vnc_get_type(void);
 
 VirtViewerSession *virt_viewer_session_vnc_new(VirtViewerApp *app, GtkWindow *main_window);
+void virt_viewer_session_vnc_set_lossy_encoding(VirtViewerSessionVnc *self, gboolean lossy);
+gboolean virt_viewer_session_vnc_get_lossy_encoding(VirtViewerSessionVnc *self);
+gboolean virt_viewer_session_vnc_set_depth(VirtViewerSessionVnc *self,
+                                           const gchar *depth,
+                                           GError **error);
+VncDisplayDepthColor virt_viewer_session_vnc_get_depth(VirtViewerSessionVnc *self);
+void virt_viewer_session_vnc_set_shared_flag(VirtViewerSessionVnc *self, gboolean shared);
+void virt_viewer_session_vnc_add_option_entries(GOptionGroup *group);
+gboolean virt_viewer_session_vnc_check_options(GError **error);
 
 G_END_DECLS
 
@@ -26,6 +26,7 @@
 
 #include <locale.h>
 #include <math.h>
+#include <unistd.h>
 
 #include "virt-viewer-session.h"
 #include "virt-viewer-util.h"
@@ -44,6 +45,7 @@ struct _VirtViewerSessionPrivate
     gboolean share_folder;
     gchar *shared_folder;
     gboolean share_folder_ro;
+    int preconnected_fd;
 };
 
 G_DEFINE_ABSTRACT_TYPE(VirtViewerSession, virt_viewer_session, G_TYPE_OBJECT)
@@ -76,6 +78,8 @@ virt_viewer_session_finalize(GObject *obj)
     g_free(session->priv->uri);
     g_clear_object(&session->priv->file);
     g_free(session->priv->shared_folder);
+    if (session->priv->preconnected_fd >= 0)
+        close(session->priv->preconnected_fd);
 
     G_OBJECT_CLASS(virt_viewer_session_parent_class)->finalize(obj);
 }
@@ -396,6 +400,7 @@ static void
 virt_viewer_session_init(VirtViewerSession *session)
 {
     session->priv = VIRT_VIEWER_SESSION_GET_PRIVATE(session);
+    session->priv->preconnected_fd = -1;
 }
 
 static void
@@ -432,6 +437,7 @@ virt_viewer_session_on_monitor_geometry_changed(VirtViewerSession* self,
         virt_viewer_align_monitors_linear(monitors);
 
     virt_viewer_shift_monitors_to_origin(monitors);
+    virt_viewer_scale_monitors(monitors, virt_viewer_session_get_render_scale(self));
 
     klass->apply_monitor_geometry(self, monitors);
     g_hash_table_unref(monitors);
@@ -655,6 +661,32 @@ VirtViewerFile* virt_viewer_session_get_file(VirtViewerSession *self)
     return self->priv->file;
 }
 
+/*
+ * Hands the session a socket already connected to the server it is about to
+ * open, so that virt_viewer_session_open_uri() can skip the name lookup and
+ * the TCP connection. The session takes ownership of @fd.
+ */
+void virt_viewer_session_set_preconnected_fd(VirtViewerSession *self, int fd)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_SESSION(self));
+
+    if (self->priv->preconnected_fd >= 0)
+        close(self->priv->preconnected_fd);
+    self->priv->preconnected_fd = fd;
+}
+
+/* Returns the pre-connected socket, if any, and gives up its ownership */
+int virt_viewer_session_steal_preconnected_fd(VirtViewerSession *self)
+{
+    int fd;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION(self), -1);
+
+    fd = self->priv->preconnected_fd;
+    self->priv->preconnected_fd = -1;
+    return fd;
+}
+
 gboolean virt_viewer_session_can_share_folder(VirtViewerSession *self)
 {
     VirtViewerSessionClass *klass;
@@ -677,6 +709,45 @@ gboolean virt_viewer_session_can_retry_auth(VirtViewerSession *self)
     return klass->can_retry_auth ? klass->can_retry_auth(self) : FALSE;
 }
 
+/**
+ * virt_viewer_session_get_render_scale:
+ * @self: the session
+ *
+ * Returns: the render scale of the application if the guests of this kind
+ * of session can be asked to render at a smaller size, 1 otherwise
+ */
+guint virt_viewer_session_get_render_scale(VirtViewerSession *self)
+{
+    VirtViewerSessionClass *klass;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION(self), 1);
+
+    klass = VIRT_VIEWER_SESSION_GET_CLASS(self);
+    if (self->priv->app == NULL || klass->can_render_scale == NULL ||
+        !klass->can_render_scale(self))
+        return 1;
+
+    return virt_viewer_app_get_render_scale(self->priv->app);
+}
+
+/**
+ * virt_viewer_session_get_display_settings:
+ * @self: the session
+ *
+ * Returns: (transfer full): a human readable description of the display
+ * encoding settings in use, or %NULL if the defaults are used
+ */
+gchar* virt_viewer_session_get_display_settings(VirtViewerSession *self)
+{
+    VirtViewerSessionClass *klass;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_SESSION(self), NULL);
+
+    klass = VIRT_VIEWER_SESSION_GET_CLASS(self);
+
+    return klass->get_display_settings ? klass->get_display_settings(self) : NULL;
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -98,6 +98,8 @@ struct _VirtViewerSessionClass {
     void (*apply_monitor_geometry)(VirtViewerSession *session, GHashTable* monitors);
     gboolean (*can_share_folder)(VirtViewerSession *session);
     gboolean (*can_retry_auth)(VirtViewerSession *session);
+    gboolean (*can_render_scale)(VirtViewerSession *session);
+    gchar* (*get_display_settings)(VirtViewerSession *session);
 };
 
 GType virt_viewer_session_get_type(void);
@@ -133,8 +135,12 @@ VirtViewerApp* virt_viewer_session_get_app(VirtViewerSession *self);
 gchar* virt_viewer_session_get_uri(VirtViewerSession *self);
 void virt_viewer_session_set_file(VirtViewerSession *self, VirtViewerFile *file);
 VirtViewerFile* virt_viewer_session_get_file(VirtViewerSession *self);
+void virt_viewer_session_set_preconnected_fd(VirtViewerSession *self, int fd);
+int virt_viewer_session_steal_preconnected_fd(VirtViewerSession *self);
 gboolean virt_viewer_session_can_share_folder(VirtViewerSession *self);
 gboolean virt_viewer_session_can_retry_auth(VirtViewerSession *self);
+guint virt_viewer_session_get_render_scale(VirtViewerSession *self);
+gchar* virt_viewer_session_get_display_settings(VirtViewerSession *self);
 
 G_END_DECLS
 
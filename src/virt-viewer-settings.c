@@ -0,0 +1,497 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "virt-viewer-settings.h"
+
+/*
+ * Settings store: the global groups ("virt-viewer", "fallback") live in
+ * DIR/settings, and the group of each guest, named after its UUID, in its
+ * own DIR/guests/UUID file. A guest file is only read the first time its
+ * UUID is looked up, so startup does not depend on how many guests were
+ * ever opened. At most SETTINGS_MAX_GUESTS guest files are kept, the least
+ * recently used ones (oldest modification time, refreshed on each load)
+ * being removed first.
+ *
+ * Changes are written SETTINGS_SAVE_DELAY seconds after they are made, by
+ * a single writer thread so that the writes of a file stay in order, each
+ * file being atomically replaced, so that a crash only loses the last
+ * changes; virt_viewer_settings_flush() queues what is left and waits for
+ * the writer. A file which could not be written stays dirty, and is
+ * written again with the next change or flush.
+ */
+#define SETTINGS_SAVE_DELAY 1
+#define SETTINGS_MAX_GUESTS 256
+#define SETTINGS_GLOBAL_FILE "settings"
+#define SETTINGS_GUESTS_DIR "guests"
+
+typedef struct {
+    VirtViewerSettings *settings;
+    gchar *path;
+    GKeyFile *keyfile;
+    gboolean dirty;
+    guint pending; /* writes queued */
+    gboolean created; /* not on disk before */
+} SettingsFile;
+
+/* A write handed to the writer thread, and back once done */
+typedef struct {
+    SettingsFile *file;
+    gchar *path;
+    gchar *data;
+    gboolean ok;
+} SettingsWrite;
+
+struct _VirtViewerSettings {
+    gchar *dir;
+    SettingsFile *global;
+    GHashTable *guests; /* UUID -> SettingsFile */
+    guint save_id;
+    GThreadPool *writer;
+    GAsyncQueue *written; /* SettingsWrite done by the writer */
+};
+
+static gboolean
+is_global_group(const gchar *group)
+{
+    return g_str_equal(group, "virt-viewer") || g_str_equal(group, "fallback");
+}
+
+static gboolean virt_viewer_settings_written_cb(gpointer data);
+
+static SettingsFile *
+settings_file_new(VirtViewerSettings *settings, gchar *path)
+{
+    SettingsFile *file = g_new0(SettingsFile, 1);
+    GError *error = NULL;
+
+    file->settings = settings;
+    file->path = path;
+    file->keyfile = g_key_file_new();
+    if (!g_key_file_load_from_file(file->keyfile, path,
+                                   G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
+                                   &error)) {
+        if (g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_debug("No configuration file %s", path);
+        else
+            g_warning("Couldn't load configuration: %s", error->message);
+        g_clear_error(&error);
+        file->created = TRUE;
+    }
+
+    return file;
+}
+
+static void
+settings_file_free(gpointer data)
+{
+    SettingsFile *file = data;
+
+    g_return_if_fail(file->pending == 0);
+
+    g_key_file_free(file->keyfile);
+    g_free(file->path);
+    g_free(file);
+}
+
+/* Guest UUIDs come from the connection, make sure they are safe file names */
+static gchar *
+virt_viewer_settings_guest_path(VirtViewerSettings *self, const gchar *uuid)
+{
+    gchar *name, *path;
+
+    if (*uuid != '\0' && *uuid != '.' &&
+        strspn(uuid, "0123456789abcdefABCDEF-") == strlen(uuid))
+        name = g_strdup(uuid);
+    else
+        name = g_compute_checksum_for_string(G_CHECKSUM_SHA1, uuid, -1);
+
+    path = g_build_filename(self->dir, SETTINGS_GUESTS_DIR, name, NULL);
+    g_free(name);
+    return path;
+}
+
+typedef struct {
+    time_t mtime;
+    gchar *path;
+} GuestFile;
+
+static void
+guest_file_free(gpointer data)
+{
+    GuestFile *guest = data;
+
+    g_free(guest->path);
+    g_free(guest);
+}
+
+static gint
+compare_mtime(gconstpointer a, gconstpointer b)
+{
+    const GuestFile *ga = *(GuestFile * const *)a;
+    const GuestFile *gb = *(GuestFile * const *)b;
+
+    return (ga->mtime > gb->mtime) - (ga->mtime < gb->mtime);
+}
+
+/* Removes the least recently used guest files beyond SETTINGS_MAX_GUESTS */
+static void
+virt_viewer_settings_evict(VirtViewerSettings *self)
+{
+    gchar *dirname = g_build_filename(self->dir, SETTINGS_GUESTS_DIR, NULL);
+    GPtrArray *guests;
+    const gchar *name;
+    GDir *dir;
+    guint i;
+
+    dir = g_dir_open(dirname, 0, NULL);
+    if (dir == NULL) {
+        g_free(dirname);
+        return;
+    }
+
+    guests = g_ptr_array_new_with_free_func(guest_file_free);
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        gchar *path = g_build_filename(dirname, name, NULL);
+        GStatBuf st;
+
+        if (g_stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            GuestFile *guest = g_new0(GuestFile, 1);
+            guest->mtime = st.st_mtime;
+            guest->path = path;
+            g_ptr_array_add(guests, guest);
+        } else {
+            g_free(path);
+        }
+    }
+    g_dir_close(dir);
+
+    if (guests->len > SETTINGS_MAX_GUESTS) {
+        g_ptr_array_sort(guests, compare_mtime);
+        for (i = 0; i < guests->len - SETTINGS_MAX_GUESTS; i++) {
+            GuestFile *guest = g_ptr_array_index(guests, i);
+
+            g_debug("Removing settings of unused guest %s", guest->path);
+            if (g_unlink(guest->path) != 0)
+                g_debug("Couldn't remove %s", guest->path);
+        }
+    }
+
+    g_ptr_array_unref(guests);
+    g_free(dirname);
+}
+
+static gboolean
+settings_prepare_dir(const gchar *path)
+{
+    gchar *dir = g_path_get_dirname(path);
+    gboolean ok = g_mkdir_with_parents(dir, S_IRWXU) == 0;
+
+    if (!ok)
+        g_warning("failed to create config directory");
+    g_free(dir);
+    return ok;
+}
+
+/* Runs in the writer thread */
+static void
+settings_write_run(gpointer data, gpointer user_data)
+{
+    SettingsWrite *write = data;
+    VirtViewerSettings *self = user_data;
+    GError *error = NULL;
+
+    write->ok = settings_prepare_dir(write->path);
+    if (write->ok && !g_file_set_contents(write->path, write->data, -1, &error)) {
+        g_warning("Couldn't save configuration: %s", error->message);
+        g_clear_error(&error);
+        write->ok = FALSE;
+    }
+
+    g_async_queue_push(self->written, write);
+    g_idle_add(virt_viewer_settings_written_cb, self);
+}
+
+static void
+settings_file_written(SettingsWrite *write)
+{
+    SettingsFile *file = write->file;
+
+    file->pending--;
+    if (!write->ok) {
+        /* not rescheduled, a persistent error would be retried forever */
+        file->dirty = TRUE;
+    } else if (file->created) {
+        file->created = FALSE;
+        if (file != file->settings->global)
+            virt_viewer_settings_evict(file->settings);
+    }
+
+    g_free(write->path);
+    g_free(write->data);
+    g_free(write);
+}
+
+static gboolean
+virt_viewer_settings_written_cb(gpointer data)
+{
+    VirtViewerSettings *self = data;
+    SettingsWrite *write;
+
+    while ((write = g_async_queue_try_pop(self->written)) != NULL)
+        settings_file_written(write);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+settings_file_queue_write(SettingsFile *file)
+{
+    SettingsWrite *write;
+
+    if (!file->dirty)
+        return;
+
+    file->dirty = FALSE;
+    file->pending++;
+    write = g_new0(SettingsWrite, 1);
+    write->file = file;
+    write->path = g_strdup(file->path);
+    write->data = g_key_file_to_data(file->keyfile, NULL, NULL);
+    g_thread_pool_push(file->settings->writer, write, NULL);
+}
+
+static GThreadPool *
+settings_writer_new(VirtViewerSettings *self)
+{
+    return g_thread_pool_new(settings_write_run, self, 1, FALSE, NULL);
+}
+
+/* Waits for the queued writes, and handles their results */
+static void
+virt_viewer_settings_wait(VirtViewerSettings *self)
+{
+    g_thread_pool_free(self->writer, FALSE, TRUE);
+    self->writer = settings_writer_new(self);
+    virt_viewer_settings_written_cb(self);
+}
+
+static gboolean
+virt_viewer_settings_save_cb(gpointer data)
+{
+    VirtViewerSettings *self = data;
+    GHashTableIter iter;
+    gpointer file;
+
+    self->save_id = 0;
+    settings_file_queue_write(self->global);
+    g_hash_table_iter_init(&iter, self->guests);
+    while (g_hash_table_iter_next(&iter, NULL, &file))
+        settings_file_queue_write(file);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+virt_viewer_settings_schedule(VirtViewerSettings *self)
+{
+    if (self->save_id == 0)
+        self->save_id = g_timeout_add_seconds(SETTINGS_SAVE_DELAY,
+                                              virt_viewer_settings_save_cb, self);
+}
+
+/*
+ * Earlier versions kept the groups of all guests in the global file, move
+ * them to their own files. A guest group is removed from the global file
+ * once moved, so one found there again was written by an earlier version
+ * or edited by hand since: its values replace those of the guest file.
+ */
+static void
+virt_viewer_settings_migrate(VirtViewerSettings *self)
+{
+    gchar **groups = g_key_file_get_groups(self->global->keyfile, NULL);
+    guint i;
+
+    for (i = 0; groups[i] != NULL; i++) {
+        GKeyFile *guest;
+        gchar **keys, *comment;
+        guint j;
+
+        if (is_global_group(groups[i]))
+            continue;
+
+        g_debug("Moving settings of guest %s to their own file", groups[i]);
+        guest = virt_viewer_settings_get_guest(self, groups[i]);
+        comment = g_key_file_get_comment(self->global->keyfile, groups[i], NULL, NULL);
+        keys = g_key_file_get_keys(self->global->keyfile, groups[i], NULL, NULL);
+        for (j = 0; keys != NULL && keys[j] != NULL; j++) {
+            gchar *value = g_key_file_get_value(self->global->keyfile, groups[i], keys[j], NULL);
+            gchar *old = g_key_file_get_value(guest, groups[i], keys[j], NULL);
+            if (old != NULL && g_strcmp0(old, value) != 0)
+                g_debug("Overwriting %s of guest %s: '%s' replaced by '%s'",
+                        keys[j], groups[i], old, value);
+            g_key_file_set_value(guest, groups[i], keys[j], value);
+            g_free(old);
+            g_free(value);
+        }
+        if (comment != NULL && *comment != '\0')
+            g_key_file_set_comment(guest, groups[i], NULL, comment, NULL);
+        g_strfreev(keys);
+        g_free(comment);
+
+        g_key_file_remove_group(self->global->keyfile, groups[i], NULL);
+        virt_viewer_settings_changed(self, groups[i]);
+        virt_viewer_settings_changed(self, NULL);
+    }
+
+    g_strfreev(groups);
+}
+
+VirtViewerSettings *
+virt_viewer_settings_new(const gchar *dir)
+{
+    VirtViewerSettings *self = g_new0(VirtViewerSettings, 1);
+
+    self->dir = g_strdup(dir);
+    self->written = g_async_queue_new();
+    self->writer = settings_writer_new(self);
+    self->global = settings_file_new(self, g_build_filename(dir, SETTINGS_GLOBAL_FILE, NULL));
+    self->guests = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, settings_file_free);
+    virt_viewer_settings_migrate(self);
+
+    return self;
+}
+
+void
+virt_viewer_settings_free(VirtViewerSettings *self)
+{
+    if (self == NULL)
+        return;
+
+    virt_viewer_settings_flush(self);
+    g_thread_pool_free(self->writer, FALSE, TRUE);
+    /* the idle callbacks of the writes already handled */
+    while (g_source_remove_by_user_data(self))
+        continue;
+    g_async_queue_unref(self->written);
+    g_hash_table_unref(self->guests);
+    settings_file_free(self->global);
+    g_free(self->dir);
+    g_free(self);
+}
+
+/* The "virt-viewer" and "fallback" groups */
+GKeyFile *
+virt_viewer_settings_get_global(VirtViewerSettings *self)
+{
+    return self->global->keyfile;
+}
+
+/* A key file holding the group named @uuid, read on first use */
+GKeyFile *
+virt_viewer_settings_get_guest(VirtViewerSettings *self, const gchar *uuid)
+{
+    SettingsFile *file;
+
+    g_return_val_if_fail(uuid != NULL, NULL);
+
+    file = g_hash_table_lookup(self->guests, uuid);
+    if (file == NULL) {
+        file = settings_file_new(self, virt_viewer_settings_guest_path(self, uuid));
+        /* mark it as recently used */
+        if (!file->created && g_utime(file->path, NULL) != 0)
+            g_debug("Couldn't update the time of %s", file->path);
+        g_hash_table_insert(self->guests, g_strdup(uuid), file);
+    }
+
+    return file->keyfile;
+}
+
+/* Names the group of @uuid after the guest, so that the file makes sense to users */
+void
+virt_viewer_settings_set_guest_name(VirtViewerSettings *self, const gchar *uuid, const gchar *name)
+{
+    GKeyFile *keyfile;
+    gchar *comment;
+
+    g_return_if_fail(uuid != NULL);
+
+    keyfile = virt_viewer_settings_get_guest(self, uuid);
+    if (name == NULL || !g_key_file_has_group(keyfile, uuid))
+        return;
+
+    comment = g_key_file_get_comment(keyfile, uuid, NULL, NULL);
+    if (comment == NULL || *comment == '\0') {
+        g_key_file_set_comment(keyfile, uuid, NULL, name, NULL);
+        virt_viewer_settings_changed(self, uuid);
+    }
+    g_free(comment);
+}
+
+/* Schedules writing the global settings, or those of @uuid */
+void
+virt_viewer_settings_changed(VirtViewerSettings *self, const gchar *uuid)
+{
+    SettingsFile *file = self->global;
+
+    if (uuid != NULL) {
+        virt_viewer_settings_get_guest(self, uuid);
+        file = g_hash_table_lookup(self->guests, uuid);
+    }
+
+    file->dirty = TRUE;
+    virt_viewer_settings_schedule(self);
+}
+
+void
+virt_viewer_settings_flush(VirtViewerSettings *self)
+{
+    GHashTableIter iter;
+    gpointer file;
+
+    if (self->save_id > 0) {
+        g_source_remove(self->save_id);
+        self->save_id = 0;
+    }
+
+    settings_file_queue_write(self->global);
+    g_hash_table_iter_init(&iter, self->guests);
+    while (g_hash_table_iter_next(&iter, NULL, &file))
+        settings_file_queue_write(file);
+
+    virt_viewer_settings_wait(self);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
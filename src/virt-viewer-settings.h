@@ -0,0 +1,50 @@
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+
+#ifndef VIRT_VIEWER_SETTINGS_H
+#define VIRT_VIEWER_SETTINGS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _VirtViewerSettings VirtViewerSettings;
+
+VirtViewerSettings *virt_viewer_settings_new(const gchar *dir);
+void virt_viewer_settings_free(VirtViewerSettings *self);
+GKeyFile *virt_viewer_settings_get_global(VirtViewerSettings *self);
+GKeyFile *virt_viewer_settings_get_guest(VirtViewerSettings *self, const gchar *uuid);
+void virt_viewer_settings_set_guest_name(VirtViewerSettings *self, const gchar *uuid, const gchar *name);
+void virt_viewer_settings_changed(VirtViewerSettings *self, const gchar *uuid);
+void virt_viewer_settings_flush(VirtViewerSettings *self);
+
+G_END_DECLS
+
+#endif /* VIRT_VIEWER_SETTINGS_H */
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -626,6 +626,36 @@ virt_viewer_shift_monitors_to_origin(GHashTable *displays)
     }
 }
 
+/* Divide the geometry of all displays by @scale. The edges of each display are
+ * scaled rather than its size, so that displays which were adjacent before
+ * scaling are still adjacent afterwards.
+ */
+void
+virt_viewer_scale_monitors(GHashTable *displays, guint scale)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    g_return_if_fail(scale > 0);
+
+    if (scale == 1)
+        return;
+
+    g_hash_table_iter_init(&iter, displays);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        GdkRectangle *display = value;
+        gint right, bottom;
+
+        g_return_if_fail(display != NULL);
+        right = (display->x + display->width) / (gint) scale;
+        bottom = (display->y + display->height) / (gint) scale;
+        display->x /= (gint) scale;
+        display->y /= (gint) scale;
+        display->width = right - display->x;
+        display->height = bottom - display->y;
+    }
+}
+
 /**
  * virt_viewer_parse_monitor_mappings:
  * @mappings: (array zero-terminated=1) values for the "monitor-mapping" key
@@ -714,6 +744,258 @@ configerror:
     return NULL;
 }
 
+/* queueing delays, in ms */
+#define QUALITY_CONGESTED_DELAY 100
+#define QUALITY_IDLE_DELAY 20
+/* below this, the displays are considered idle, in bytes per second */
+#define QUALITY_ACTIVE_THROUGHPUT (64 * 1024)
+#define QUALITY_DOWNGRADE_SAMPLES 3
+#define QUALITY_UPGRADE_SAMPLES 15
+/* a level up roughly doubles the throughput of the same activity */
+#define QUALITY_UPGRADE_HEADROOM 2
+
+static const gchar *quality_level_names[] = {
+    [VIRT_VIEWER_QUALITY_HIGH] = "high",
+    [VIRT_VIEWER_QUALITY_MEDIUM] = "medium",
+    [VIRT_VIEWER_QUALITY_LOW] = "low",
+};
+
+const gchar*
+virt_viewer_quality_level_to_string(VirtViewerQualityLevel level)
+{
+    g_return_val_if_fail(level < G_N_ELEMENTS(quality_level_names), NULL);
+
+    return quality_level_names[level];
+}
+
+gboolean
+virt_viewer_quality_level_from_string(const gchar *str, VirtViewerQualityLevel *level)
+{
+    guint i;
+
+    g_return_val_if_fail(level != NULL, FALSE);
+
+    for (i = 0; str != NULL && i < G_N_ELEMENTS(quality_level_names); i++) {
+        if (g_str_equal(str, quality_level_names[i])) {
+            *level = i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void
+virt_viewer_quality_controller_init(VirtViewerQualityController *controller,
+                                    VirtViewerQualityLevel level)
+{
+    g_return_if_fail(controller != NULL);
+    g_return_if_fail(level <= VIRT_VIEWER_QUALITY_LOW);
+
+    controller->level = level;
+    controller->min_rtt = -1;
+    controller->congested_rate = 0;
+    controller->bad_samples = 0;
+    controller->good_samples = 0;
+}
+
+/**
+ * virt_viewer_quality_controller_sample:
+ * @controller: the controller state
+ * @bytes_per_sec: the display throughput measured since the last sample
+ * @rtt: the round-trip time of the connection in ms, or -1 if unknown
+ *
+ * Feeds one sample to the controller. The queueing delay, the difference
+ * between @rtt and the smallest round-trip time seen so far, is used as the
+ * congestion signal so that links with a high but stable latency are not
+ * penalized. A sample only counts as congested if the displays are actually
+ * transferring data, otherwise the delay is not caused by the session.
+ *
+ * The level is lowered after a few consecutive congested samples, and raised
+ * again only after a much longer period without congestion, so that the
+ * controller does not oscillate on a link near its capacity. The throughput
+ * at which the link congested is remembered as its capacity: the level is
+ * not raised while @bytes_per_sec is too close to it for the next level to
+ * fit, and the capacity is forgotten once the link carries more than that
+ * without delay.
+ *
+ * Returns: %TRUE if the level of @controller changed
+ */
+gboolean
+virt_viewer_quality_controller_sample(VirtViewerQualityController *controller,
+                                      guint64 bytes_per_sec,
+                                      gint rtt)
+{
+    gint delay;
+
+    g_return_val_if_fail(controller != NULL, FALSE);
+
+    if (rtt < 0) {
+        controller->bad_samples = 0;
+        controller->good_samples = 0;
+        return FALSE;
+    }
+
+    if (controller->min_rtt < 0 || rtt < controller->min_rtt)
+        controller->min_rtt = rtt;
+    delay = rtt - controller->min_rtt;
+
+    if (delay >= QUALITY_CONGESTED_DELAY && bytes_per_sec >= QUALITY_ACTIVE_THROUGHPUT) {
+        if (controller->bad_samples == 0 || bytes_per_sec > controller->congested_rate)
+            controller->congested_rate = bytes_per_sec;
+        controller->good_samples = 0;
+        controller->bad_samples++;
+    } else if (delay <= QUALITY_IDLE_DELAY) {
+        if (bytes_per_sec > controller->congested_rate)
+            controller->congested_rate = 0;
+        controller->bad_samples = 0;
+        controller->good_samples++;
+    } else {
+        controller->bad_samples = 0;
+        controller->good_samples = 0;
+    }
+
+    if (controller->bad_samples >= QUALITY_DOWNGRADE_SAMPLES &&
+        controller->level < VIRT_VIEWER_QUALITY_LOW) {
+        controller->level++;
+    } else if (controller->good_samples >= QUALITY_UPGRADE_SAMPLES &&
+               controller->level > VIRT_VIEWER_QUALITY_HIGH &&
+               (controller->congested_rate == 0 ||
+                bytes_per_sec * QUALITY_UPGRADE_HEADROOM <= controller->congested_rate)) {
+        controller->level--;
+    } else {
+        return FALSE;
+    }
+
+    controller->bad_samples = 0;
+    controller->good_samples = 0;
+    return TRUE;
+}
+
+void
+virt_viewer_stall_watchdog_init(VirtViewerStallWatchdog *watchdog, guint timeout)
+{
+    g_return_if_fail(watchdog != NULL);
+
+    watchdog->timeout = timeout;
+    watchdog->stalled = FALSE;
+    watchdog->late = FALSE;
+    watchdog->hiccups = 0;
+    watchdog->longest_silence = 0;
+}
+
+/**
+ * virt_viewer_stall_watchdog_sample:
+ * @watchdog: the watchdog state
+ * @silence: the time since anything was last received from the server in
+ * ms, or -1 if unknown
+ *
+ * Feeds one sample to the watchdog. The connection is declared stalled once
+ * @silence reaches the timeout. Silences longer than half the timeout that
+ * end before it are counted as hiccups, and the longest silence is kept, to
+ * help choosing a timeout that does not trip on a merely slow link.
+ *
+ * Returns: %TRUE if the connection just stalled
+ */
+gboolean
+virt_viewer_stall_watchdog_sample(VirtViewerStallWatchdog *watchdog, gint silence)
+{
+    g_return_val_if_fail(watchdog != NULL, FALSE);
+
+    if (watchdog->timeout == 0 || watchdog->stalled || silence < 0)
+        return FALSE;
+
+    if ((guint) silence > watchdog->longest_silence)
+        watchdog->longest_silence = silence;
+
+    if ((guint) silence >= watchdog->timeout) {
+        watchdog->stalled = TRUE;
+        watchdog->late = FALSE;
+        return TRUE;
+    }
+
+    if ((guint) silence >= watchdog->timeout / 2) {
+        watchdog->late = TRUE;
+    } else if (watchdog->late) {
+        watchdog->late = FALSE;
+        watchdog->hiccups++;
+    }
+
+    return FALSE;
+}
+
+static const VirtViewerProfile profiles[] = {
+    {
+        .name = "lan",
+    },
+    {
+        .name = "wan",
+        .disable_effects = { "wallpaper", "animation", NULL },
+        .image_compression = "auto-glz",
+        .video_codecs = { "vp8", "h264", "mjpeg", NULL },
+        .vnc_lossy_encoding = TRUE,
+    },
+    {
+        .name = "cellular",
+        .color_depth = 16,
+        .disable_effects = { "all", NULL },
+        .disable_audio = TRUE,
+        .disable_usbredir = TRUE,
+        .image_compression = "glz",
+        .video_codecs = { "h264", "vp8", "mjpeg", NULL },
+        .vnc_lossy_encoding = TRUE,
+        .vnc_depth = "medium",
+        .max_monitors = 1,
+    },
+};
+
+/**
+ * virt_viewer_profile_lookup:
+ * @name: a profile name (lan, wan or cellular)
+ *
+ * Returns: the profile called @name, or %NULL if there is none
+ */
+const VirtViewerProfile*
+virt_viewer_profile_lookup(const gchar *name)
+{
+    gsize i;
+
+    g_return_val_if_fail(name != NULL, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(profiles); i++) {
+        if (g_str_equal(name, profiles[i].name))
+            return &profiles[i];
+    }
+
+    return NULL;
+}
+
+/* Appends @str to @json as a JSON string literal */
+void
+virt_viewer_util_json_append_string(GString *json, const gchar *str)
+{
+    g_string_append_c(json, '"');
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\')
+            g_string_append_printf(json, "\\%c", *str);
+        else if ((guchar)*str < 0x20)
+            g_string_append_printf(json, "\\u%04x", (guchar)*str);
+        else
+            g_string_append_c(json, *str);
+    }
+    g_string_append_c(json, '"');
+}
+
+/* Appends @us microseconds to @json as a number of milliseconds */
+void
+virt_viewer_util_json_append_ms(GString *json, gint64 us)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    /* not printf, the decimal separator must not depend on the locale */
+    g_string_append(json, g_ascii_formatd(buf, sizeof(buf), "%.1f", us / 1000.0));
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -60,11 +60,66 @@ gint virt_viewer_compare_buildid(const gchar *s1, const gchar *s2);
 /* monitor alignment */
 void virt_viewer_align_monitors_linear(GHashTable *displays);
 void virt_viewer_shift_monitors_to_origin(GHashTable *displays);
+void virt_viewer_scale_monitors(GHashTable *displays, guint scale);
 
 /* monitor mapping */
 GHashTable* virt_viewer_parse_monitor_mappings(gchar **mappings,
                                                const gsize nmappings,
                                                const gint nmonitors);
+
+/* adaptive display quality */
+typedef enum {
+    VIRT_VIEWER_QUALITY_HIGH,
+    VIRT_VIEWER_QUALITY_MEDIUM,
+    VIRT_VIEWER_QUALITY_LOW,
+} VirtViewerQualityLevel;
+
+typedef struct {
+    VirtViewerQualityLevel level;
+    gint min_rtt; /* in ms, -1 until the first sample */
+    guint64 congested_rate; /* bytes per second the link last congested at, 0 if unknown */
+    guint bad_samples;
+    guint good_samples;
+} VirtViewerQualityController;
+
+const gchar* virt_viewer_quality_level_to_string(VirtViewerQualityLevel level);
+gboolean virt_viewer_quality_level_from_string(const gchar *str, VirtViewerQualityLevel *level);
+void virt_viewer_quality_controller_init(VirtViewerQualityController *controller,
+                                         VirtViewerQualityLevel level);
+gboolean virt_viewer_quality_controller_sample(VirtViewerQualityController *controller,
+                                               guint64 bytes_per_sec,
+                                               gint rtt);
+
+/* connection liveness */
+typedef struct {
+    guint timeout; /* in ms, 0 to disable */
+    gboolean stalled;
+    gboolean late; /* the current silence is longer than half the timeout */
+    guint hiccups;
+    guint longest_silence; /* in ms */
+} VirtViewerStallWatchdog;
+
+void virt_viewer_stall_watchdog_init(VirtViewerStallWatchdog *watchdog, guint timeout);
+gboolean virt_viewer_stall_watchdog_sample(VirtViewerStallWatchdog *watchdog, gint silence);
+
+/* connection profiles, bundles of settings for a type of network */
+typedef struct {
+    const gchar *name;
+    gint color_depth; /* 0 for the default */
+    const gchar *disable_effects[4];
+    gboolean disable_audio;
+    gboolean disable_usbredir;
+    const gchar *image_compression; /* NULL for the default */
+    const gchar *video_codecs[4];
+    gboolean vnc_lossy_encoding;
+    const gchar *vnc_depth; /* NULL for the default */
+    guint max_monitors; /* 0 for no limit */
+} VirtViewerProfile;
+
+const VirtViewerProfile* virt_viewer_profile_lookup(const gchar *name);
+
+void virt_viewer_util_json_append_string(GString *json, const gchar *str);
+void virt_viewer_util_json_append_ms(GString *json, gint64 us);
 #endif
 
 /*
@@ -22,10 +22,36 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <string.h>
 
 #include "virt-viewer-vm-connection.h"
 #include "virt-viewer-util.h"
 
+typedef struct {
+    GtkBuilder *builder;
+    GtkTreeView *treeview;
+    GtkTreeSelection *selection;
+    GtkTreeModelFilter *filter;
+    GtkLabel *label;
+    /* casefolded text typed in the search entry */
+    gchar *filter_text;
+} VmConnectionDialog;
+
+static void
+vm_connection_dialog_free(VmConnectionDialog *data)
+{
+    g_object_unref(data->filter);
+    g_object_unref(data->builder);
+    g_free(data->filter_text);
+    g_free(data);
+}
+
+static VmConnectionDialog *
+vm_connection_dialog_get(GtkWidget *dialog)
+{
+    return g_object_get_data(G_OBJECT(dialog), "vm-connection-dialog");
+}
+
 static void
 treeview_row_activated_cb(GtkTreeView *treeview G_GNUC_UNUSED,
                           GtkTreePath *path G_GNUC_UNUSED,
@@ -42,51 +68,173 @@ treeselection_changed_cb(GtkTreeSelection *selection, gpointer userdata)
                              gtk_tree_selection_count_selected_rows(selection) == 1);
 }
 
-gchar*
-virt_viewer_vm_connection_choose_name_dialog(GtkWindow *main_window,
-                                             GtkTreeModel *model,
-                                             GError **error)
+static void
+search_changed_cb(GtkSearchEntry *entry, gpointer userdata)
+{
+    VmConnectionDialog *data = userdata;
+    const gchar *text = gtk_entry_get_text(GTK_ENTRY(entry));
+
+    g_free(data->filter_text);
+    data->filter_text = (*text != '\0') ? g_utf8_casefold(text, -1) : NULL;
+    gtk_tree_model_filter_refilter(data->filter);
+}
+
+static gboolean
+row_visible(GtkTreeModel *model, GtkTreeIter *iter, gpointer userdata)
+{
+    VmConnectionDialog *data = userdata;
+    gboolean visible = FALSE;
+    gint i;
+
+    if (data->filter_text == NULL)
+        return TRUE;
+
+    /* the text can match the name as well as the state or the host */
+    for (i = 0; i < gtk_tree_model_get_n_columns(model) && !visible; i++) {
+        gchar *text, *key;
+
+        if (gtk_tree_model_get_column_type(model, i) != G_TYPE_STRING)
+            continue;
+
+        gtk_tree_model_get(model, iter, i, &text, -1);
+        if (text == NULL)
+            continue;
+
+        key = g_utf8_casefold(text, -1);
+        visible = (strstr(key, data->filter_text) != NULL);
+        g_free(key);
+        g_free(text);
+    }
+
+    return visible;
+}
+
+/* Adds a column showing @column of the model, as wide as @sample */
+static void
+add_column(VmConnectionDialog *data, const gchar *title, gint column, const gchar *sample)
+{
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    PangoLayout *layout = gtk_widget_create_pango_layout(GTK_WIDGET(data->treeview), sample);
+    GtkTreeViewColumn *view_column;
+    gint width, xpad;
+
+    g_object_set(renderer,
+                 "sensitive", FALSE,
+                 "ellipsize", PANGO_ELLIPSIZE_MIDDLE,
+                 NULL);
+    view_column = gtk_tree_view_column_new_with_attributes(title, renderer,
+                                                           "text", column, NULL);
+    /* all the columns must have a fixed size for the fixed height mode */
+    pango_layout_get_pixel_size(layout, &width, NULL);
+    gtk_cell_renderer_get_padding(renderer, &xpad, NULL);
+    gtk_tree_view_column_set_sizing(view_column, GTK_TREE_VIEW_COLUMN_FIXED);
+    gtk_tree_view_column_set_fixed_width(view_column, width + 4 * xpad);
+    gtk_tree_view_column_set_resizable(view_column, TRUE);
+    gtk_tree_view_append_column(data->treeview, view_column);
+    g_object_unref(layout);
+}
+
+/*
+ * The rows of @model have the name of the virtual machine in their first
+ * column, and optionally a description of its state in the second one and
+ * the host running it in the third one. Any further string column is not
+ * shown, but matched by the filter as well. @model can be filled while the
+ * dialog is shown.
+ */
+GtkWidget *
+virt_viewer_vm_connection_dialog_new(GtkWindow *main_window,
+                                     GtkTreeModel *model)
 {
-    GtkBuilder *vm_connection;
+    VmConnectionDialog *data;
     GtkWidget *dialog;
     GtkButton *button_connect;
-    GtkTreeView *treeview;
-    GtkTreeSelection *selection;
-    GtkTreeIter iter;
-    int dialog_response;
-    gchar *vm_name = NULL;
 
     g_return_val_if_fail(model != NULL, NULL);
 
-    if (!gtk_tree_model_get_iter_first(model, &iter)) {
-        g_set_error_literal(error,
-                            VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
-                            _("No virtual machine found"));
-        return NULL;
-    }
-
-    vm_connection = virt_viewer_util_load_ui("virt-viewer-vm-connection.ui");
-    g_return_val_if_fail(vm_connection != NULL, NULL);
+    data = g_new0(VmConnectionDialog, 1);
+    data->builder = virt_viewer_util_load_ui("virt-viewer-vm-connection.ui");
+    g_return_val_if_fail(data->builder != NULL, NULL);
 
-    dialog = GTK_WIDGET(gtk_builder_get_object(vm_connection, "vm-connection-dialog"));
+    dialog = GTK_WIDGET(gtk_builder_get_object(data->builder, "vm-connection-dialog"));
     gtk_window_set_transient_for(GTK_WINDOW(dialog), main_window);
-    button_connect = GTK_BUTTON(gtk_builder_get_object(vm_connection, "button-connect"));
-    treeview = GTK_TREE_VIEW(gtk_builder_get_object(vm_connection, "treeview"));
-    selection = GTK_TREE_SELECTION(gtk_builder_get_object(vm_connection, "treeview-selection"));
-    gtk_tree_view_set_model(treeview, model);
+    button_connect = GTK_BUTTON(gtk_builder_get_object(data->builder, "button-connect"));
+    data->treeview = GTK_TREE_VIEW(gtk_builder_get_object(data->builder, "treeview"));
+    data->selection = GTK_TREE_SELECTION(gtk_builder_get_object(data->builder, "treeview-selection"));
+    data->label = GTK_LABEL(gtk_builder_get_object(data->builder, "label"));
 
-    g_signal_connect(treeview, "row-activated",
+    data->filter = GTK_TREE_MODEL_FILTER(gtk_tree_model_filter_new(model, NULL));
+    gtk_tree_model_filter_set_visible_func(data->filter, row_visible, data, NULL);
+    gtk_tree_view_set_model(data->treeview, GTK_TREE_MODEL(data->filter));
+    gtk_tree_view_set_search_entry(data->treeview,
+                                   GTK_ENTRY(gtk_builder_get_object(data->builder, "search")));
+
+    if (gtk_tree_model_get_n_columns(model) > 1)
+        add_column(data, _("State"), 1, _("paused"));
+    if (gtk_tree_model_get_n_columns(model) > 2)
+        add_column(data, _("Host"), 2, "qemu+ssh://hypervisor/system");
+    gtk_tree_view_set_fixed_height_mode(data->treeview, TRUE);
+
+    g_signal_connect(data->treeview, "row-activated",
                      G_CALLBACK(treeview_row_activated_cb), button_connect);
-    g_signal_connect(selection, "changed",
+    g_signal_connect(data->selection, "changed",
                      G_CALLBACK(treeselection_changed_cb), button_connect);
+    g_signal_connect(gtk_builder_get_object(data->builder, "search"), "search-changed",
+                     G_CALLBACK(search_changed_cb), data);
+
+    g_object_set_data_full(G_OBJECT(dialog), "vm-connection-dialog", data,
+                           (GDestroyNotify)vm_connection_dialog_free);
+
+    return dialog;
+}
+
+/* Replaces the heading of the list, NULL restores the default one */
+void
+virt_viewer_vm_connection_dialog_set_status(GtkWidget *dialog,
+                                            const gchar *status)
+{
+    VmConnectionDialog *data = vm_connection_dialog_get(dialog);
+
+    g_return_if_fail(data != NULL);
+
+    gtk_label_set_text(data->label,
+                       status != NULL ? status : _("Available virtual machines"));
+}
+
+/* Only shows the rows matching @text, as if it was typed by the user */
+void
+virt_viewer_vm_connection_dialog_set_filter(GtkWidget *dialog,
+                                            const gchar *text)
+{
+    VmConnectionDialog *data = vm_connection_dialog_get(dialog);
+
+    g_return_if_fail(data != NULL);
+
+    gtk_entry_set_text(GTK_ENTRY(gtk_builder_get_object(data->builder, "search")),
+                       text != NULL ? text : "");
+}
+
+/* Runs the dialog and destroys it, sets @iter to the chosen row of the model
+ * the dialog was created with */
+gboolean
+virt_viewer_vm_connection_dialog_run_for_iter(GtkWidget *dialog,
+                                              GtkTreeIter *iter,
+                                              GError **error)
+{
+    VmConnectionDialog *data = vm_connection_dialog_get(dialog);
+    GtkTreeIter filter_iter;
+    int dialog_response;
+    gboolean chosen = FALSE;
+
+    g_return_val_if_fail(data != NULL, FALSE);
 
     gtk_widget_show_all(dialog);
     dialog_response = gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_hide(dialog);
 
     if (dialog_response == GTK_RESPONSE_ACCEPT &&
-        gtk_tree_selection_get_selected(selection, &model, &iter)) {
-        gtk_tree_model_get(model, &iter, 0, &vm_name, -1);
+        gtk_tree_selection_get_selected(data->selection, NULL, &filter_iter)) {
+        gtk_tree_model_filter_convert_iter_to_child_iter(data->filter, iter, &filter_iter);
+        chosen = TRUE;
     } else {
         g_set_error_literal(error,
                             VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_CANCELLED,
@@ -94,11 +242,51 @@ virt_viewer_vm_connection_choose_name_dialog(GtkWindow *main_window,
     }
 
     gtk_widget_destroy(dialog);
-    g_object_unref(G_OBJECT(vm_connection));
+
+    return chosen;
+}
+
+/* Runs the dialog and destroys it, returns the name of the chosen machine */
+gchar*
+virt_viewer_vm_connection_dialog_run(GtkWidget *dialog,
+                                     GError **error)
+{
+    VmConnectionDialog *data = vm_connection_dialog_get(dialog);
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    gchar *vm_name = NULL;
+
+    g_return_val_if_fail(data != NULL, NULL);
+
+    /* the dialog data goes away with the dialog */
+    model = g_object_ref(gtk_tree_model_filter_get_model(data->filter));
+    if (virt_viewer_vm_connection_dialog_run_for_iter(dialog, &iter, error))
+        gtk_tree_model_get(model, &iter, 0, &vm_name, -1);
+    g_object_unref(model);
 
     return vm_name;
 }
 
+gchar*
+virt_viewer_vm_connection_choose_name_dialog(GtkWindow *main_window,
+                                             GtkTreeModel *model,
+                                             GError **error)
+{
+    GtkTreeIter iter;
+
+    g_return_val_if_fail(model != NULL, NULL);
+
+    if (!gtk_tree_model_get_iter_first(model, &iter)) {
+        g_set_error_literal(error,
+                            VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("No virtual machine found"));
+        return NULL;
+    }
+
+    return virt_viewer_vm_connection_dialog_run(virt_viewer_vm_connection_dialog_new(main_window, model),
+                                                error);
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
@@ -28,6 +28,18 @@ gchar* virt_viewer_vm_connection_choose_name_dialog(GtkWindow *main_window,
                                                     GtkTreeModel *model,
                                                     GError **error);
 
+GtkWidget* virt_viewer_vm_connection_dialog_new(GtkWindow *main_window,
+                                                GtkTreeModel *model);
+void virt_viewer_vm_connection_dialog_set_status(GtkWidget *dialog,
+                                                 const gchar *status);
+void virt_viewer_vm_connection_dialog_set_filter(GtkWidget *dialog,
+                                                 const gchar *text);
+gboolean virt_viewer_vm_connection_dialog_run_for_iter(GtkWidget *dialog,
+                                                       GtkTreeIter *iter,
+                                                       GError **error);
+gchar* virt_viewer_vm_connection_dialog_run(GtkWidget *dialog,
+                                            GError **error);
+
 #endif
 /*
  * Local variables:
@@ -100,6 +100,7 @@ struct _VirtViewerWindowPrivate {
     GtkAccelGroup *accel_group;
     VirtViewerNotebook *notebook;
     VirtViewerDisplay *display;
+    GtkWidget *snapshot; /* replaces the display while it is frozen */
     VirtViewerTimedRevealer *revealer;
 
     gboolean accel_enabled;
@@ -115,6 +116,9 @@ struct _VirtViewerWindowPrivate {
     gboolean fullscreen;
     gchar *subtitle;
     gboolean initial_zoom_set;
+    /* the guest of the display, when it is not the one of the application */
+    gchar *guest_name;
+    gchar *uuid;
 };
 
 static void
@@ -201,6 +205,8 @@ virt_viewer_window_dispose (GObject *object)
 
     g_free(priv->subtitle);
     priv->subtitle = NULL;
+    g_clear_pointer(&priv->guest_name, g_free);
+    g_clear_pointer(&priv->uuid, g_free);
 
     g_value_unset(&priv->accel_setting);
     priv->toolbar = NULL;
@@ -381,6 +387,8 @@ virt_viewer_window_get_real_zoom_level(VirtViewerWindow *self)
 
     gtk_widget_get_allocation(GTK_WIDGET(self->priv->display), &allocation);
     virt_viewer_display_get_desktop_size(self->priv->display, &width, &height);
+    /* the guest desktop is shown render_scale times larger */
+    width *= virt_viewer_display_get_render_scale(self->priv->display);
 
     return round((double) NORMAL_ZOOM_LEVEL * allocation.width / width);
 }
@@ -944,11 +952,23 @@ virt_viewer_window_menu_file_screenshot(GtkWidget *menu G_GNUC_UNUSED,
     gtk_widget_destroy(dialog);
 }
 
+/* The session of the display, which may not be the one of the application */
+static VirtViewerSession *
+virt_viewer_window_get_session(VirtViewerWindow *self)
+{
+    VirtViewerSession *session = NULL;
+
+    if (self->priv->display != NULL)
+        session = virt_viewer_display_get_session(self->priv->display);
+
+    return session != NULL ? session : virt_viewer_app_get_session(self->priv->app);
+}
+
 G_MODULE_EXPORT void
 virt_viewer_window_menu_file_usb_device_selection(GtkWidget *menu G_GNUC_UNUSED,
                                                   VirtViewerWindow *self)
 {
-    virt_viewer_session_usb_device_selection(virt_viewer_app_get_session(self->priv->app),
+    virt_viewer_session_usb_device_selection(virt_viewer_window_get_session(self),
                                              GTK_WINDOW(self->priv->window));
 }
 
@@ -956,14 +976,14 @@ G_MODULE_EXPORT void
 virt_viewer_window_menu_file_smartcard_insert(GtkWidget *menu G_GNUC_UNUSED,
                                               VirtViewerWindow *self)
 {
-    virt_viewer_session_smartcard_insert(virt_viewer_app_get_session(self->priv->app));
+    virt_viewer_session_smartcard_insert(virt_viewer_window_get_session(self));
 }
 
 G_MODULE_EXPORT void
 virt_viewer_window_menu_file_smartcard_remove(GtkWidget *menu G_GNUC_UNUSED,
                                               VirtViewerWindow *self)
 {
-    virt_viewer_session_smartcard_remove(virt_viewer_app_get_session(self->priv->app));
+    virt_viewer_session_smartcard_remove(virt_viewer_window_get_session(self));
 }
 
 G_MODULE_EXPORT void
@@ -994,19 +1014,43 @@ virt_viewer_window_menu_help_guest_details(GtkWidget *menu G_GNUC_UNUSED,
     GtkWidget *dialog = GTK_WIDGET(gtk_builder_get_object(ui, "guestdetailsdialog"));
     GtkWidget *namelabel = GTK_WIDGET(gtk_builder_get_object(ui, "namevaluelabel"));
     GtkWidget *guidlabel = GTK_WIDGET(gtk_builder_get_object(ui, "guidvaluelabel"));
+    GtkWidget *displaylabel = GTK_WIDGET(gtk_builder_get_object(ui, "displayvaluelabel"));
+    VirtViewerSession *session = virt_viewer_window_get_session(self);
+    char *display_settings = NULL;
+    const VirtViewerProfile *profile = virt_viewer_app_get_profile(self->priv->app);
 
-    g_return_if_fail(dialog && namelabel && guidlabel);
+    g_return_if_fail(dialog && namelabel && guidlabel && displaylabel);
 
-    g_object_get(self->priv->app, "guest-name", &name, "uuid", &uuid, NULL);
+    if (self->priv->guest_name != NULL) {
+        name = g_strdup(self->priv->guest_name);
+        uuid = g_strdup(self->priv->uuid);
+    } else {
+        g_object_get(self->priv->app, "guest-name", &name, "uuid", &uuid, NULL);
+    }
+    if (session != NULL)
+        display_settings = virt_viewer_session_get_display_settings(session);
+    if (profile != NULL) {
+        gchar *tmp = display_settings;
+
+        if (tmp != NULL && *tmp != '\0')
+            display_settings = g_strdup_printf(_("profile: %s; %s"), profile->name, tmp);
+        else
+            display_settings = g_strdup_printf(_("profile: %s"), profile->name);
+        g_free(tmp);
+    }
 
     if (!name || *name == '\0')
         name = g_strdup(_("Unknown"));
     if (!uuid || *uuid == '\0')
         uuid = g_strdup(_("Unknown"));
+    if (!display_settings || *display_settings == '\0')
+        display_settings = g_strdup(_("Default"));
     gtk_label_set_text(GTK_LABEL(namelabel), name);
     gtk_label_set_text(GTK_LABEL(guidlabel), uuid);
+    gtk_label_set_text(GTK_LABEL(displaylabel), display_settings);
     g_free(name);
     g_free(uuid);
+    g_free(display_settings);
 
     gtk_window_set_transient_for(GTK_WINDOW(dialog),
                                  GTK_WINDOW(self->priv->window));
@@ -1332,13 +1376,18 @@ virt_viewer_window_set_display(VirtViewerWindow *self, VirtViewerDisplay *displa
 
     priv = self->priv;
     if (priv->display) {
+        /* removes the snapshot instead when the display is frozen */
         gtk_notebook_remove_page(GTK_NOTEBOOK(priv->notebook), 1);
         g_object_unref(priv->display);
         priv->display = NULL;
+        priv->snapshot = NULL;
     }
 
     if (display != NULL) {
         priv->display = g_object_ref(display);
+        /* a new display starts unzoomed, the zoom level of the window is
+         * applied again once it is ready */
+        priv->initial_zoom_set = FALSE;
 
         virt_viewer_display_set_monitor(VIRT_VIEWER_DISPLAY(priv->display), priv->fullscreen_monitor);
         virt_viewer_display_set_fullscreen(VIRT_VIEWER_DISPLAY(priv->display), priv->fullscreen);
@@ -1380,6 +1429,64 @@ virt_viewer_window_set_display(VirtViewerWindow *self, VirtViewerDisplay *displa
     }
 }
 
+/**
+ * virt_viewer_window_freeze_display:
+ * @self: the window
+ *
+ * Replaces the display with a picture of its last frame, which stays in
+ * place after the display stopped updating, until the next call to
+ * virt_viewer_window_set_display().
+ *
+ * Returns: %FALSE if the display has no frame to show
+ */
+gboolean
+virt_viewer_window_freeze_display(VirtViewerWindow *self)
+{
+    VirtViewerWindowPrivate *priv;
+    GdkPixbuf *pixbuf, *scaled;
+    gint width, height, pix_width, pix_height;
+    gdouble scale;
+    gboolean showing;
+
+    g_return_val_if_fail(VIRT_VIEWER_IS_WINDOW(self), FALSE);
+
+    priv = self->priv;
+    if (priv->display == NULL || priv->snapshot != NULL)
+        return priv->snapshot != NULL;
+
+    pixbuf = virt_viewer_display_get_pixbuf(priv->display);
+    if (pixbuf == NULL)
+        return FALSE;
+
+    /* shown like the display, scaled to fit and centered */
+    width = gtk_widget_get_allocated_width(GTK_WIDGET(priv->display));
+    height = gtk_widget_get_allocated_height(GTK_WIDGET(priv->display));
+    pix_width = gdk_pixbuf_get_width(pixbuf);
+    pix_height = gdk_pixbuf_get_height(pixbuf);
+    scale = MIN((gdouble) width / pix_width, (gdouble) height / pix_height);
+    if (width > 1 && height > 1 && scale != 1.0) {
+        scaled = gdk_pixbuf_scale_simple(pixbuf,
+                                         MAX(pix_width * scale, 1),
+                                         MAX(pix_height * scale, 1),
+                                         GDK_INTERP_BILINEAR);
+        g_object_unref(pixbuf);
+        pixbuf = scaled;
+    }
+
+    priv->snapshot = gtk_image_new_from_pixbuf(pixbuf);
+    g_object_unref(pixbuf);
+
+    /* the window keeps its reference to the display */
+    showing = gtk_notebook_get_current_page(GTK_NOTEBOOK(priv->notebook)) == 1;
+    gtk_notebook_remove_page(GTK_NOTEBOOK(priv->notebook), 1);
+    gtk_widget_show(priv->snapshot);
+    gtk_notebook_append_page(GTK_NOTEBOOK(priv->notebook), priv->snapshot, NULL);
+    if (showing)
+        gtk_notebook_set_current_page(GTK_NOTEBOOK(priv->notebook), 1);
+
+    return TRUE;
+}
+
 static void
 virt_viewer_window_enable_kiosk(VirtViewerWindow *self)
 {
@@ -1398,6 +1505,9 @@ virt_viewer_window_enable_kiosk(VirtViewerWindow *self)
 void
 virt_viewer_window_show(VirtViewerWindow *self)
 {
+    if (virt_viewer_app_get_probe(self->priv->app))
+        return;
+
     if (self->priv->display && !virt_viewer_display_get_enabled(self->priv->display))
         virt_viewer_display_enable(self->priv->display);
 
@@ -1496,6 +1606,27 @@ virt_viewer_window_get_display(VirtViewerWindow *self)
     return self->priv->display;
 }
 
+/**
+ * virt_viewer_window_set_guest:
+ * @self: the window
+ * @name: the name of the guest shown by the window
+ * @uuid: (allow-none): its UUID
+ *
+ * Sets the guest the window shows, for windows whose display does not
+ * belong to the session of the application. The guest details of the
+ * other windows are those of the application.
+ */
+void
+virt_viewer_window_set_guest(VirtViewerWindow *self, const gchar *name, const gchar *uuid)
+{
+    g_return_if_fail(VIRT_VIEWER_IS_WINDOW(self));
+
+    g_free(self->priv->guest_name);
+    self->priv->guest_name = g_strdup(name);
+    g_free(self->priv->uuid);
+    self->priv->uuid = g_strdup(uuid);
+}
+
 void
 virt_viewer_window_set_kiosk(VirtViewerWindow *self, gboolean enabled)
 {
@@ -1551,6 +1682,8 @@ virt_viewer_window_get_minimal_zoom_level(VirtViewerWindow *self)
 
     virt_viewer_window_get_minimal_dimensions(self, &min_width, &min_height);
     virt_viewer_display_get_desktop_size(virt_viewer_window_get_display(self), &width, &height);
+    width *= virt_viewer_display_get_render_scale(self->priv->display);
+    height *= virt_viewer_display_get_render_scale(self->priv->display);
 
     /* e.g. minimal width = 200, desktop width = 550 => width ratio = 0.36
      * which means that the minimal zoom level is 40 (4 * ZOOM_STEP)
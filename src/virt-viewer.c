@@ -54,6 +54,8 @@
 
 struct _VirtViewerPrivate {
     char *uri;
+    /* hypervisors to choose a domain from */
+    gchar **uris;
     virConnectPtr conn;
     virDomainPtr dom;
     char *domkey;
@@ -74,9 +76,11 @@ static void virt_viewer_deactivated(VirtViewerApp *self, gboolean connect_error)
 static gboolean virt_viewer_start(VirtViewerApp *self, GError **error);
 static void virt_viewer_dispose (GObject *object);
 static int virt_viewer_connect(VirtViewerApp *app, GError **error);
+static gboolean virt_viewer_screenshot_all(gchar **uris, const gchar *dir);
 
 static gchar **opt_args = NULL;
-static gchar *opt_uri = NULL;
+static gchar **opt_uris = NULL;
+static gchar *opt_screenshot_dir = NULL;
 static gboolean opt_direct = FALSE;
 static gboolean opt_attach = FALSE;
 static gboolean opt_waitvm = FALSE;
@@ -121,6 +125,17 @@ opt_domain_selection_cb(const gchar *option_name,
     return FALSE;
 }
 
+static gboolean
+opt_screenshot_all_cb(const gchar *option_name G_GNUC_UNUSED,
+                      const gchar *value,
+                      gpointer data G_GNUC_UNUSED,
+                      GError **error G_GNUC_UNUSED)
+{
+    g_free(opt_screenshot_dir);
+    opt_screenshot_dir = g_strdup(value != NULL ? value : ".");
+    return TRUE;
+}
+
 static void
 virt_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOptionGroup *group)
 {
@@ -129,8 +144,8 @@ virt_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOp
           N_("Direct connection with no automatic tunnels"), NULL },
         { "attach", 'a', 0, G_OPTION_ARG_NONE, &opt_attach,
           N_("Attach to the local display using libvirt"), NULL },
-        { "connect", 'c', 0, G_OPTION_ARG_STRING, &opt_uri,
-          N_("Connect to hypervisor"), "URI"},
+        { "connect", 'c', 0, G_OPTION_ARG_STRING_ARRAY, &opt_uris,
+          N_("Connect to hypervisor, can be repeated to choose among several ones"), "URI"},
         { "wait", 'w', 0, G_OPTION_ARG_NONE, &opt_waitvm,
           N_("Wait for domain to start"), NULL },
         { "reconnect", 'r', 0, G_OPTION_ARG_NONE, &opt_reconnect,
@@ -141,6 +156,8 @@ virt_viewer_add_option_entries(VirtViewerApp *self, GOptionContext *context, GOp
           N_("Select the virtual machine only by its id"), NULL },
         { "uuid", '\0', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, opt_domain_selection_cb,
           N_("Select the virtual machine only by its uuid"), NULL },
+        { "screenshot-all", '\0', G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, opt_screenshot_all_cb,
+          N_("Save a screenshot of every running virtual machine in DIR and exit"), "DIR" },
         { G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &opt_args,
           NULL, "-- ID|UUID|DOMAIN-NAME" },
         { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
@@ -164,6 +181,15 @@ virt_viewer_local_command_line (GApplication   *gapp,
     if (ret)
         goto end;
 
+    if (opt_screenshot_dir) {
+        gchar *default_uris[] = { "", NULL };
+
+        *status = virt_viewer_screenshot_all(opt_uris ? opt_uris : default_uris,
+                                             opt_screenshot_dir) ? 0 : 1;
+        ret = TRUE;
+        goto end;
+    }
+
     if (opt_args) {
         if (g_strv_length(opt_args) != 1) {
             g_printerr(_("\nUsage: %s [OPTIONS] [ID|UUID|DOMAIN-NAME]\n\n"), PACKAGE);
@@ -191,14 +217,19 @@ virt_viewer_local_command_line (GApplication   *gapp,
     virt_viewer_app_set_direct(app, opt_direct);
     virt_viewer_app_set_attach(app, opt_attach);
     self->priv->reconnect = opt_reconnect;
-    self->priv->uri = g_strdup(opt_uri);
+    virt_viewer_app_set_reconnect(app, opt_reconnect);
+    if (opt_uris != NULL && g_strv_length(opt_uris) > 1)
+        self->priv->uris = g_strdupv(opt_uris);
+    else if (opt_uris != NULL)
+        self->priv->uri = g_strdup(opt_uris[0]);
 
 end:
     if (ret && *status)
         g_printerr(_("Run '%s --help' to see a full list of available command line options\n"), g_get_prgname());
 
     g_strfreev(opt_args);
-    g_free(opt_uri);
+    g_strfreev(opt_uris);
+    g_free(opt_screenshot_dir);
     return ret;
 }
 
@@ -281,19 +312,28 @@ virt_viewer_deactivated(VirtViewerApp *app, gboolean connect_error)
 {
     VirtViewer *self = VIRT_VIEWER(app);
     VirtViewerPrivate *priv = self->priv;
+    gboolean running = FALSE;
 
     if (priv->dom) {
+        /* the display connection was lost, not the guest */
+        running = virDomainIsActive(priv->dom) == 1;
         virDomainFree(priv->dom);
         priv->dom = NULL;
     }
 
     if (priv->reconnect && !virt_viewer_app_get_session_cancelled(app)) {
-        if (priv->domain_event < 0) {
+        if (running) {
+            g_debug("Guest domain still running, reconnecting");
+            virt_viewer_start_reconnect_poll(self);
+        } else if (priv->domain_event < 0) {
             g_debug("No domain events, falling back to polling");
             virt_viewer_start_reconnect_poll(self);
         }
 
-        virt_viewer_app_show_status(app, _("Waiting for guest domain to re-start"));
+        if (running)
+            virt_viewer_app_show_status(app, _("Connection to the graphic server lost, reconnecting..."));
+        else
+            virt_viewer_app_show_status(app, _("Waiting for guest domain to re-start"));
         virt_viewer_app_trace(app, "Guest %s display has disconnected, waiting to reconnect", priv->domkey);
         virt_viewer_app_set_menus_sensitive(app, FALSE);
     } else {
@@ -790,40 +830,313 @@ virt_viewer_dispose (GObject *object)
     }
     g_free(priv->uri);
     priv->uri = NULL;
+    g_strfreev(priv->uris);
+    priv->uris = NULL;
     g_free(priv->domkey);
     priv->domkey = NULL;
     G_OBJECT_CLASS(virt_viewer_parent_class)->dispose (object);
 }
 
+/*
+ * The domain chooser is shown right away and filled from a background
+ * listing, hosts can have thousands of domains. Lifecycle events keep it
+ * up to date while it is shown.
+ */
+enum {
+    CHOOSER_COLUMN_NAME,
+    CHOOSER_COLUMN_STATE,
+};
+
+/* number of rows added to the chooser per main loop iteration */
+#define CHOOSER_BATCH_SIZE 256
+
+typedef struct {
+    gchar *name;
+    const gchar *state;
+    gchar *uuid;
+    gchar *id;
+} ChooserEntry;
+
+typedef struct {
+    gint refs;
+    virConnectPtr conn;
+    GtkListStore *model;
+    GtkWidget *dialog;
+    GCancellable *cancellable;
+    /* name -> GtkTreeIter, or NULL for domains which were stopped */
+    GHashTable *rows;
+    GPtrArray *entries;
+    guint next_entry;
+    guint batch_id; /* source id */
+    gint domain_event;
+} DomainChooser;
+
+static void
+chooser_entry_free(ChooserEntry *entry)
+{
+    g_free(entry->name);
+    g_free(entry->uuid);
+    g_free(entry->id);
+    g_free(entry);
+}
+
+static DomainChooser *
+domain_chooser_ref(DomainChooser *chooser)
+{
+    chooser->refs++;
+    return chooser;
+}
+
+static void
+domain_chooser_unref(DomainChooser *chooser)
+{
+    if (--chooser->refs > 0)
+        return;
+
+    g_object_unref(chooser->model);
+    g_object_unref(chooser->cancellable);
+    g_hash_table_unref(chooser->rows);
+    if (chooser->entries)
+        g_ptr_array_unref(chooser->entries);
+    virConnectClose(chooser->conn);
+    g_free(chooser);
+}
+
+static void
+domain_chooser_set_state(DomainChooser *chooser, const gchar *name, const gchar *state)
+{
+    GtkTreeIter *iter = g_hash_table_lookup(chooser->rows, name);
+
+    if (iter != NULL) {
+        gtk_list_store_set(chooser->model, iter, CHOOSER_COLUMN_STATE, state, -1);
+        return;
+    }
+
+    iter = g_new0(GtkTreeIter, 1);
+    gtk_list_store_insert_with_values(chooser->model, iter, -1,
+                                      CHOOSER_COLUMN_NAME, name,
+                                      CHOOSER_COLUMN_STATE, state,
+                                      -1);
+    g_hash_table_insert(chooser->rows, g_strdup(name), iter);
+}
+
+static void
+domain_chooser_remove(DomainChooser *chooser, const gchar *name)
+{
+    GtkTreeIter *iter = g_hash_table_lookup(chooser->rows, name);
+
+    if (iter != NULL)
+        gtk_list_store_remove(chooser->model, iter);
+    /* remember it so that a pending listing doesn't add it back */
+    g_hash_table_insert(chooser->rows, g_strdup(name), NULL);
+}
+
+static int
+domain_chooser_event(virConnectPtr conn G_GNUC_UNUSED,
+                     virDomainPtr dom,
+                     int event,
+                     int detail G_GNUC_UNUSED,
+                     void *opaque)
+{
+    DomainChooser *chooser = opaque;
+    const char *name = virDomainGetName(dom);
+
+    if (chooser->dialog == NULL || name == NULL)
+        return 0;
+
+    switch (event) {
+    case VIR_DOMAIN_EVENT_STARTED:
+    case VIR_DOMAIN_EVENT_RESUMED:
+        domain_chooser_set_state(chooser, name, _("running"));
+        break;
+    case VIR_DOMAIN_EVENT_SUSPENDED:
+        domain_chooser_set_state(chooser, name, _("paused"));
+        break;
+    case VIR_DOMAIN_EVENT_STOPPED:
+        domain_chooser_remove(chooser, name);
+        break;
+    }
+
+    return 0;
+}
+
+static gboolean
+domain_chooser_add_batch(gpointer user_data)
+{
+    DomainChooser *chooser = user_data;
+    guint last = MIN(chooser->next_entry + CHOOSER_BATCH_SIZE, chooser->entries->len);
+
+    for (; chooser->next_entry < last; chooser->next_entry++) {
+        ChooserEntry *entry = g_ptr_array_index(chooser->entries, chooser->next_entry);
+
+        /* events are more recent than the listing */
+        if (!g_hash_table_contains(chooser->rows, entry->name))
+            domain_chooser_set_state(chooser, entry->name, entry->state);
+    }
+
+    if (chooser->next_entry < chooser->entries->len)
+        return G_SOURCE_CONTINUE;
+
+    if (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(chooser->model), NULL) == 0)
+        virt_viewer_vm_connection_dialog_set_status(chooser->dialog,
+                                                    _("No virtual machine found"));
+    else
+        virt_viewer_vm_connection_dialog_set_status(chooser->dialog, NULL);
+
+    chooser->batch_id = 0;
+    domain_chooser_unref(chooser);
+    return G_SOURCE_REMOVE;
+}
+
+/* Lists the running and paused domains of @conn as ChooserEntry */
+static GPtrArray *
+list_domain_entries(virConnectPtr conn, GError **error)
+{
+    /* asking for each state in turn gives the state of all the domains
+     * without a round trip per domain */
+    const struct {
+        unsigned int flags;
+        const gchar *state;
+    } lists[] = {
+        { VIR_CONNECT_LIST_DOMAINS_RUNNING, N_("running") },
+        { VIR_CONNECT_LIST_DOMAINS_PAUSED, N_("paused") },
+    };
+    GPtrArray *entries = g_ptr_array_new_with_free_func((GDestroyNotify)chooser_entry_free);
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(lists); i++) {
+        virDomainPtr *domains;
+        int j, n;
+
+        n = virConnectListAllDomains(conn, &domains, lists[i].flags);
+        if (n < 0) {
+            virErrorPtr err = virGetLastError();
+            g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                                err && err->message ? err->message : "unknown libvirt error");
+            g_ptr_array_unref(entries);
+            return NULL;
+        }
+        for (j = 0; j < n; j++) {
+            ChooserEntry *entry = g_new0(ChooserEntry, 1);
+            char uuid[VIR_UUID_STRING_BUFLEN];
+
+            entry->name = g_strdup(virDomainGetName(domains[j]));
+            entry->state = _(lists[i].state);
+            if (virDomainGetUUIDString(domains[j], uuid) == 0)
+                entry->uuid = g_strdup(uuid);
+            entry->id = g_strdup_printf("%u", virDomainGetID(domains[j]));
+            g_ptr_array_add(entries, entry);
+            virDomainFree(domains[j]);
+        }
+        free(domains);
+    }
+
+    return entries;
+}
+
+static void
+domain_chooser_list(GTask *task,
+                    gpointer source_object G_GNUC_UNUSED,
+                    gpointer task_data,
+                    GCancellable *cancellable G_GNUC_UNUSED)
+{
+    DomainChooser *chooser = task_data;
+    GError *error = NULL;
+    GPtrArray *entries = list_domain_entries(chooser->conn, &error);
+
+    if (entries == NULL)
+        g_task_return_error(task, error);
+    else
+        g_task_return_pointer(task, entries, (GDestroyNotify)g_ptr_array_unref);
+}
+
+static void
+domain_chooser_listed(GObject *source G_GNUC_UNUSED,
+                      GAsyncResult *result,
+                      gpointer user_data)
+{
+    DomainChooser *chooser = user_data;
+    GError *error = NULL;
+
+    chooser->entries = g_task_propagate_pointer(G_TASK(result), &error);
+    if (chooser->dialog == NULL) {
+        /* the dialog was closed meanwhile */
+        g_clear_error(&error);
+    } else if (error != NULL) {
+        g_debug("Failed to list domains: %s", error->message);
+        virt_viewer_vm_connection_dialog_set_status(chooser->dialog, error->message);
+        g_clear_error(&error);
+    } else {
+        g_debug("Listed %u domains", chooser->entries->len);
+        /* adding the rows in batches keeps the dialog responsive */
+        chooser->batch_id = g_idle_add(domain_chooser_add_batch, chooser);
+        return;
+    }
+
+    domain_chooser_unref(chooser);
+}
+
+static void
+domain_chooser_stop(DomainChooser *chooser)
+{
+    chooser->dialog = NULL;
+    g_cancellable_cancel(chooser->cancellable);
+    if (chooser->batch_id != 0) {
+        g_source_remove(chooser->batch_id);
+        chooser->batch_id = 0;
+        domain_chooser_unref(chooser);
+    }
+    if (chooser->domain_event >= 0) {
+        virConnectDomainEventDeregisterAny(chooser->conn, chooser->domain_event);
+        chooser->domain_event = -1;
+    }
+}
+
 static virDomainPtr
 choose_vm(GtkWindow *main_window,
           char **vm_name,
           virConnectPtr conn,
           GError **error)
 {
-    GtkListStore *model;
-    GtkTreeIter iter;
-    virDomainPtr *domains, dom = NULL;
-    int i, vms_running;
-    unsigned int flags = VIR_CONNECT_LIST_DOMAINS_RUNNING;
+    DomainChooser *chooser;
+    GTask *task;
+    virDomainPtr dom = NULL;
+    int state;
 
     g_return_val_if_fail(vm_name != NULL, NULL);
     free(*vm_name);
 
-    model = gtk_list_store_new(1, G_TYPE_STRING);
-
-    vms_running = virConnectListAllDomains(conn, &domains, flags);
-    for (i = 0; i < vms_running; i++) {
-        gtk_list_store_append(model, &iter);
-        gtk_list_store_set(model, &iter, 0, virDomainGetName(domains[i]), -1);
-        virDomainFree(domains[i]);
+    chooser = g_new0(DomainChooser, 1);
+    chooser->refs = 1;
+    chooser->conn = conn;
+    virConnectRef(conn);
+    chooser->model = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
+    chooser->cancellable = g_cancellable_new();
+    chooser->rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    chooser->dialog = virt_viewer_vm_connection_dialog_new(main_window,
+                                                           GTK_TREE_MODEL(chooser->model));
+    virt_viewer_vm_connection_dialog_set_status(chooser->dialog,
+                                                _("Looking up virtual machines..."));
+
+    chooser->domain_event = virConnectDomainEventRegisterAny(conn, NULL,
+                                                             VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                                             VIR_DOMAIN_EVENT_CALLBACK(domain_chooser_event),
+                                                             domain_chooser_ref(chooser),
+                                                             (virFreeCallback)domain_chooser_unref);
+    if (chooser->domain_event < 0) {
+        g_debug("No domain events, the chooser will not be updated");
+        domain_chooser_unref(chooser);
     }
-    free(domains);
 
-    *vm_name = virt_viewer_vm_connection_choose_name_dialog(main_window,
-                                                            GTK_TREE_MODEL(model),
-                                                            error);
-    g_object_unref(G_OBJECT(model));
+    task = g_task_new(NULL, chooser->cancellable, domain_chooser_listed,
+                      domain_chooser_ref(chooser));
+    g_task_set_task_data(task, chooser, NULL);
+    g_task_run_in_thread(task, domain_chooser_list);
+    g_object_unref(task);
+
+    *vm_name = virt_viewer_vm_connection_dialog_run(chooser->dialog, error);
+    domain_chooser_stop(chooser);
+    domain_chooser_unref(chooser);
     if (*vm_name == NULL)
         return NULL;
 
@@ -833,7 +1146,8 @@ choose_vm(GtkWindow *main_window,
         g_set_error_literal(error,
                             VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
                             err && err->message ? err->message : "unknown libvirt error");
-    } else if (virDomainGetState(dom, &i, NULL, 0) < 0 || i != VIR_DOMAIN_RUNNING) {
+    } else if (virDomainGetState(dom, &state, NULL, 0) < 0 ||
+               (state != VIR_DOMAIN_RUNNING && state != VIR_DOMAIN_PAUSED)) {
         g_set_error(error,
                     VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
                     _("Virtual machine %s is not running"), *vm_name);
@@ -844,6 +1158,399 @@ choose_vm(GtkWindow *main_window,
     return dom;
 }
 
+/*
+ * With several hypervisor URIs, the domains of all the hosts are listed in
+ * a single chooser. The hosts are queried by a bounded pool of threads and
+ * their domains are added as each of them answers, so that slow or dead
+ * hosts don't hold the others back.
+ */
+#define HOST_CHOOSER_WORKERS 8
+
+enum {
+    HOST_CHOOSER_COLUMN_NAME,
+    HOST_CHOOSER_COLUMN_STATE,
+    HOST_CHOOSER_COLUMN_URI,
+    /* not shown, so that a --uuid or --id given with the hosts matches */
+    HOST_CHOOSER_COLUMN_UUID,
+    HOST_CHOOSER_COLUMN_ID,
+};
+
+typedef struct {
+    gint refs;
+    GtkListStore *model;
+    GtkWidget *dialog;
+    GThreadPool *pool;
+    guint pending;
+    gboolean cancelled;
+} HostChooser;
+
+typedef struct {
+    HostChooser *chooser;
+    gchar *uri;
+    GPtrArray *entries;
+    GError *error;
+} HostListing;
+
+static HostChooser *
+host_chooser_ref(HostChooser *chooser)
+{
+    g_atomic_int_inc(&chooser->refs);
+    return chooser;
+}
+
+static void
+host_chooser_unref(HostChooser *chooser)
+{
+    if (!g_atomic_int_dec_and_test(&chooser->refs))
+        return;
+
+    g_object_unref(chooser->model);
+    g_free(chooser);
+}
+
+static void
+host_listing_free(HostListing *listing)
+{
+    host_chooser_unref(listing->chooser);
+    g_free(listing->uri);
+    if (listing->entries)
+        g_ptr_array_unref(listing->entries);
+    g_clear_error(&listing->error);
+    g_free(listing);
+}
+
+static gboolean
+host_chooser_listed(gpointer user_data)
+{
+    HostListing *listing = user_data;
+    HostChooser *chooser = listing->chooser;
+    guint i;
+
+    if (chooser->dialog == NULL)
+        goto end;
+
+    if (listing->error != NULL) {
+        g_debug("Failed to list the domains of %s: %s", listing->uri, listing->error->message);
+    } else {
+        g_debug("Listed %u domains on %s", listing->entries->len, listing->uri);
+        for (i = 0; i < listing->entries->len; i++) {
+            ChooserEntry *entry = g_ptr_array_index(listing->entries, i);
+
+            gtk_list_store_insert_with_values(chooser->model, NULL, -1,
+                                              HOST_CHOOSER_COLUMN_NAME, entry->name,
+                                              HOST_CHOOSER_COLUMN_STATE, entry->state,
+                                              HOST_CHOOSER_COLUMN_URI, listing->uri,
+                                              HOST_CHOOSER_COLUMN_UUID, entry->uuid,
+                                              HOST_CHOOSER_COLUMN_ID, entry->id,
+                                              -1);
+        }
+    }
+
+    chooser->pending--;
+    if (chooser->pending == 0) {
+        if (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(chooser->model), NULL) == 0)
+            virt_viewer_vm_connection_dialog_set_status(chooser->dialog,
+                                                        _("No virtual machine found"));
+        else
+            virt_viewer_vm_connection_dialog_set_status(chooser->dialog, NULL);
+    } else {
+        gchar *status = g_strdup_printf(ngettext("Waiting for %u host...",
+                                                 "Waiting for %u hosts...",
+                                                 chooser->pending),
+                                        chooser->pending);
+        virt_viewer_vm_connection_dialog_set_status(chooser->dialog, status);
+        g_free(status);
+    }
+
+end:
+    host_listing_free(listing);
+    return G_SOURCE_REMOVE;
+}
+
+/* Runs in a thread of the pool */
+static void
+host_chooser_list(gpointer data, gpointer user_data G_GNUC_UNUSED)
+{
+    HostListing *listing = data;
+    virConnectPtr conn;
+
+    /* the dialog was closed before this host was reached. The listing
+     * may hold the last reference to the chooser, whose model must be
+     * released on the main thread */
+    if (g_atomic_int_get(&listing->chooser->cancelled)) {
+        g_idle_add(host_chooser_listed, listing);
+        return;
+    }
+
+    /* credentials can't be asked from here, hosts requiring them are
+     * skipped */
+    conn = virConnectOpenReadOnly(listing->uri);
+    if (conn == NULL) {
+        virErrorPtr err = virGetLastError();
+        g_set_error_literal(&listing->error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            err && err->message ? err->message : "unknown libvirt error");
+    } else {
+        listing->entries = list_domain_entries(conn, &listing->error);
+        virConnectClose(conn);
+    }
+
+    g_idle_add(host_chooser_listed, listing);
+}
+
+static gboolean
+choose_host_vm(GtkWindow *main_window,
+               gchar **uris,
+               const gchar *filter,
+               gchar **uri,
+               gchar **vm_name,
+               GError **error)
+{
+    HostChooser *chooser;
+    GtkTreeIter iter;
+    gboolean chosen;
+    guint i;
+
+    chooser = g_new0(HostChooser, 1);
+    chooser->refs = 1;
+    chooser->model = gtk_list_store_new(5, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                        G_TYPE_STRING, G_TYPE_STRING);
+    chooser->dialog = virt_viewer_vm_connection_dialog_new(main_window,
+                                                           GTK_TREE_MODEL(chooser->model));
+    virt_viewer_vm_connection_dialog_set_status(chooser->dialog,
+                                                _("Looking up virtual machines..."));
+    virt_viewer_vm_connection_dialog_set_filter(chooser->dialog, filter);
+
+    chooser->pool = g_thread_pool_new(host_chooser_list, NULL,
+                                      HOST_CHOOSER_WORKERS, FALSE, NULL);
+    for (i = 0; uris[i] != NULL; i++) {
+        HostListing *listing = g_new0(HostListing, 1);
+
+        listing->chooser = host_chooser_ref(chooser);
+        listing->uri = g_strdup(uris[i]);
+        chooser->pending++;
+        g_thread_pool_push(chooser->pool, listing, NULL);
+    }
+
+    chosen = virt_viewer_vm_connection_dialog_run_for_iter(chooser->dialog, &iter, error);
+    if (chosen)
+        gtk_tree_model_get(GTK_TREE_MODEL(chooser->model), &iter,
+                           HOST_CHOOSER_COLUMN_NAME, vm_name,
+                           HOST_CHOOSER_COLUMN_URI, uri,
+                           -1);
+
+    /* the queued hosts are skipped, the hosts being queried are left to
+     * finish on their own */
+    chooser->dialog = NULL;
+    g_atomic_int_set(&chooser->cancelled, TRUE);
+    g_thread_pool_free(chooser->pool, FALSE, FALSE);
+    host_chooser_unref(chooser);
+
+    return chosen;
+}
+
+/*
+ * --screenshot-all saves the screen of every running domain of the given
+ * hypervisors without opening any window. The screenshots are fetched
+ * and encoded by a pool of threads, the libvirt streams being used in
+ * blocking mode.
+ */
+#define SCREENSHOT_WORKERS 4
+
+typedef struct {
+    virDomainPtr dom;
+    gchar *name;
+    gchar *filename;
+    /* set by the worker */
+    GError *error;
+    gint64 fetch_time;
+    gint64 encode_time;
+} ScreenshotJob;
+
+static void
+screenshot_job_free(ScreenshotJob *job)
+{
+    virDomainFree(job->dom);
+    g_free(job->name);
+    g_free(job->filename);
+    g_clear_error(&job->error);
+    g_free(job);
+}
+
+static void
+screenshot_set_libvirt_error(ScreenshotJob *job)
+{
+    virErrorPtr err = virGetLastError();
+
+    g_set_error_literal(&job->error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                        err && err->message ? err->message : "unknown libvirt error");
+}
+
+/* Receives the screenshot of the domain, decoding it as it arrives */
+static GdkPixbuf *
+screenshot_fetch(ScreenshotJob *job)
+{
+    GdkPixbufLoader *loader = NULL;
+    GdkPixbuf *pixbuf = NULL;
+    virStreamPtr stream;
+    char *mime = NULL;
+    char buf[64 * 1024];
+    int got = 0;
+
+    stream = virStreamNew(virDomainGetConnect(job->dom), 0);
+    if (stream == NULL) {
+        screenshot_set_libvirt_error(job);
+        return NULL;
+    }
+
+    mime = virDomainScreenshot(job->dom, stream, 0, 0);
+    if (mime == NULL) {
+        screenshot_set_libvirt_error(job);
+        goto end;
+    }
+
+    loader = gdk_pixbuf_loader_new_with_mime_type(mime, &job->error);
+    if (loader == NULL) {
+        virStreamAbort(stream);
+        goto end;
+    }
+
+    while ((got = virStreamRecv(stream, buf, sizeof(buf))) > 0) {
+        if (!gdk_pixbuf_loader_write(loader, (const guchar *)buf, got, &job->error))
+            break;
+    }
+
+    if (job->error != NULL) {
+        virStreamAbort(stream);
+        gdk_pixbuf_loader_close(loader, NULL);
+    } else if (got < 0 || virStreamFinish(stream) < 0) {
+        screenshot_set_libvirt_error(job);
+        gdk_pixbuf_loader_close(loader, NULL);
+    } else if (gdk_pixbuf_loader_close(loader, &job->error)) {
+        pixbuf = g_object_ref(gdk_pixbuf_loader_get_pixbuf(loader));
+    }
+
+end:
+    if (loader != NULL)
+        g_object_unref(loader);
+    virStreamFree(stream);
+    free(mime);
+
+    return pixbuf;
+}
+
+/* Runs in a thread of the pool */
+static void
+screenshot_job_run(gpointer data, gpointer user_data)
+{
+    ScreenshotJob *job = data;
+    GAsyncQueue *done = user_data;
+    gint64 start = g_get_monotonic_time();
+    GdkPixbuf *pixbuf = screenshot_fetch(job);
+
+    job->fetch_time = g_get_monotonic_time() - start;
+    if (pixbuf != NULL) {
+        start = g_get_monotonic_time();
+        gdk_pixbuf_save(pixbuf, job->filename, "png", &job->error, NULL);
+        job->encode_time = g_get_monotonic_time() - start;
+        g_object_unref(pixbuf);
+    }
+
+    g_async_queue_push(done, job);
+}
+
+static gboolean
+virt_viewer_screenshot_all(gchar **uris, const gchar *dir)
+{
+    GAsyncQueue *done = g_async_queue_new();
+    GThreadPool *pool;
+    gint64 start = g_get_monotonic_time();
+    guint njobs = 0, nsaved = 0, nfailed = 0, i;
+    gboolean multiple_hosts = g_strv_length(uris) > 1;
+
+    if (g_mkdir_with_parents(dir, 0755) < 0) {
+        g_printerr(_("Cannot create directory %s\n"), dir);
+        g_async_queue_unref(done);
+        return FALSE;
+    }
+
+    pool = g_thread_pool_new(screenshot_job_run, done, SCREENSHOT_WORKERS, FALSE, NULL);
+
+    for (i = 0; uris[i] != NULL; i++) {
+        const gchar *uri = *uris[i] != '\0' ? uris[i] : NULL;
+        virConnectPtr conn;
+        virDomainPtr *domains;
+        char *hostname = NULL;
+        int j, n;
+
+        /* screenshots can't be taken over a read-only connection */
+        conn = virConnectOpenAuth(uri, virConnectAuthPtrDefault, 0);
+        if (conn == NULL) {
+            virErrorPtr err = virGetLastError();
+            g_printerr(_("Unable to connect to libvirt with URI: %s: %s\n"),
+                       uri ? uri : _("[none]"),
+                       err && err->message ? err->message : "unknown libvirt error");
+            nfailed++;
+            continue;
+        }
+        if (multiple_hosts)
+            hostname = virConnectGetHostname(conn);
+
+        n = virConnectListAllDomains(conn, &domains, VIR_CONNECT_LIST_DOMAINS_RUNNING);
+        if (n < 0) {
+            virErrorPtr err = virGetLastError();
+            g_printerr(_("Unable to list the domains of %s: %s\n"),
+                       uri ? uri : _("[none]"),
+                       err && err->message ? err->message : "unknown libvirt error");
+            nfailed++;
+        }
+        for (j = 0; j < n; j++) {
+            ScreenshotJob *job = g_new0(ScreenshotJob, 1);
+            gchar *basename;
+
+            job->dom = domains[j];
+            job->name = g_strdup(virDomainGetName(domains[j]));
+            if (hostname != NULL)
+                basename = g_strdup_printf("%s-%s.png", hostname, job->name);
+            else
+                basename = g_strdup_printf("%s.png", job->name);
+            job->filename = g_build_filename(dir, basename, NULL);
+            g_free(basename);
+
+            g_thread_pool_push(pool, job, NULL);
+            njobs++;
+        }
+        if (n >= 0)
+            free(domains);
+
+        free(hostname);
+        /* the domains keep the connection alive */
+        virConnectClose(conn);
+    }
+
+    for (i = 0; i < njobs; i++) {
+        ScreenshotJob *job = g_async_queue_pop(done);
+
+        if (job->error != NULL) {
+            g_print(_("%s: failed after %" G_GINT64_FORMAT " ms: %s\n"),
+                    job->name, job->fetch_time / 1000, job->error->message);
+            nfailed++;
+        } else {
+            g_print(_("%s: saved to %s, fetched in %" G_GINT64_FORMAT " ms, encoded in %" G_GINT64_FORMAT " ms\n"),
+                    job->name, job->filename, job->fetch_time / 1000, job->encode_time / 1000);
+            nsaved++;
+        }
+        screenshot_job_free(job);
+    }
+
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_async_queue_unref(done);
+
+    g_print(_("%u screenshots, %u failures, in %" G_GINT64_FORMAT " ms\n"),
+            nsaved, nfailed, (g_get_monotonic_time() - start) / 1000);
+
+    return nfailed == 0;
+}
+
 static gboolean
 virt_viewer_initial_connect(VirtViewerApp *app, GError **error)
 {
@@ -1118,13 +1825,159 @@ virt_viewer_connect(VirtViewerApp *app, GError **err)
     return 0;
 }
 
+/*
+ * Describes how to reach the display of a domain for --dashboard and
+ * --load-test. Only direct TCP connections are supported: the sessions are
+ * opened without going through the app, so there is no tunnel nor libvirt
+ * fd.
+ */
+static VirtViewerFile *
+virt_viewer_domain_file_new(virConnectPtr conn, virDomainPtr dom, GError **error)
+{
+    VirtViewerFile *file = NULL;
+    char *xmldesc = virDomainGetXMLDesc(dom, 0);
+    char *uri = NULL;
+    gchar *type = NULL, *xpath;
+    gchar *gport = NULL, *gtlsport = NULL, *ghost = NULL;
+    gchar *host = NULL, *transport = NULL;
+
+    if (xmldesc == NULL ||
+        (type = virt_viewer_extract_xpath_string(xmldesc, "string(/domain/devices/graphics/@type)")) == NULL) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Cannot determine the graphic type"));
+        goto cleanup;
+    }
+
+    xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@port)", type);
+    gport = virt_viewer_extract_xpath_string(xmldesc, xpath);
+    g_free(xpath);
+    if (g_str_equal(type, "spice")) {
+        xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@tlsPort)", type);
+        gtlsport = virt_viewer_extract_xpath_string(xmldesc, xpath);
+        g_free(xpath);
+    }
+    if (gport == NULL && gtlsport == NULL) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("The display isn't listening on TCP"));
+        goto cleanup;
+    }
+    xpath = g_strdup_printf("string(/domain/devices/graphics[@type='%s']/@listen)", type);
+    ghost = virt_viewer_extract_xpath_string(xmldesc, xpath);
+    g_free(xpath);
+
+    uri = virConnectGetURI(conn);
+    if (virt_viewer_util_extract_host(uri, NULL, &host, &transport, NULL, NULL) < 0) {
+        g_set_error_literal(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                            _("Cannot determine the host"));
+        goto cleanup;
+    }
+    if (virt_viewer_replace_host(ghost)) {
+        g_free(ghost);
+        ghost = g_strdup(host ? host : "localhost");
+    }
+    if (!virt_viewer_is_reachable(ghost, transport, host, TRUE)) {
+        g_set_error(error, VIRT_VIEWER_ERROR, VIRT_VIEWER_ERROR_FAILED,
+                    _("The display at %s is not reachable"), ghost);
+        goto cleanup;
+    }
+
+    file = g_object_new(VIRT_VIEWER_TYPE_FILE, NULL);
+    virt_viewer_file_set_type(file, type);
+    virt_viewer_file_set_host(file, ghost);
+    if (gport != NULL)
+        virt_viewer_file_set_port(file, atoi(gport));
+    if (gtlsport != NULL)
+        virt_viewer_file_set_tls_port(file, atoi(gtlsport));
+    virt_viewer_file_set_title(file, virDomainGetName(dom));
+
+cleanup:
+    g_free(type);
+    g_free(gport);
+    g_free(gtlsport);
+    g_free(ghost);
+    g_free(host);
+    g_free(transport);
+    free(uri);
+    free(xmldesc);
+    return file;
+}
+
+/* Opens a session to the running domains of every hypervisor */
+static gboolean
+virt_viewer_start_sessions(VirtViewerApp *app, GError **error)
+{
+    VirtViewerPrivate *priv = VIRT_VIEWER(app)->priv;
+    gchar *default_uris[] = { priv->uri, NULL };
+    gchar **uris = priv->uris ? priv->uris : default_uris;
+    int i;
+
+    /* the first URI may be NULL, meaning the default hypervisor */
+    for (i = 0; i == 0 || uris[i] != NULL; i++) {
+        virConnectPtr conn = virConnectOpenReadOnly(uris[i]);
+        virDomainPtr *domains = NULL;
+        int j, n;
+
+        if (conn == NULL) {
+            g_printerr(_("Unable to connect to libvirt with URI: %s\n"),
+                       uris[i] ? uris[i] : _("[none]"));
+            continue;
+        }
+
+        n = virConnectListAllDomains(conn, &domains, VIR_CONNECT_LIST_DOMAINS_RUNNING);
+        for (j = 0; j < n; j++) {
+            const char *name = virDomainGetName(domains[j]);
+            GError *err = NULL;
+            VirtViewerFile *file;
+
+            if (priv->domkey != NULL && g_strcmp0(priv->domkey, name) != 0) {
+                virDomainFree(domains[j]);
+                continue;
+            }
+
+            file = virt_viewer_domain_file_new(conn, domains[j], &err);
+            if (file != NULL) {
+                virt_viewer_app_add_session_file(app, name, file);
+                g_object_unref(file);
+            } else {
+                g_printerr(_("Skipping %s: %s\n"), name, err->message);
+                g_clear_error(&err);
+            }
+            virDomainFree(domains[j]);
+        }
+        free(domains);
+        virConnectClose(conn);
+    }
+
+    return virt_viewer_app_start_sessions(app, error);
+}
+
 static gboolean
 virt_viewer_start(VirtViewerApp *app, GError **error)
 {
+    VirtViewerPrivate *priv = VIRT_VIEWER(app)->priv;
+
     gvir_event_register();
 
     virSetErrorFunc(NULL, virt_viewer_error_func);
 
+    if (virt_viewer_app_get_multi_session(app))
+        return virt_viewer_start_sessions(app, error);
+
+    if (priv->uris != NULL) {
+        VirtViewerWindow *main_window = virt_viewer_app_get_main_window(app);
+        gchar *uri = NULL, *name = NULL;
+
+        if (!choose_host_vm(virt_viewer_window_get_window(main_window),
+                            priv->uris, priv->domkey, &uri, &name, error))
+            return FALSE;
+
+        g_free(priv->uri);
+        priv->uri = uri;
+        g_free(priv->domkey);
+        priv->domkey = name;
+        domain_selection_type = DOMAIN_SELECTION_NAME;
+    }
+
     if (virt_viewer_connect(app, error) < 0)
         return FALSE;
 
@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# Compares the time from starting remote-viewer to the first frame of a
+# guest display, with a cold start and through a resident launcher.
+#
+# Usage: launcher-benchmark.sh [-n RUNS] URI|VV-FILE
+#
+# REMOTE_VIEWER can point to the binary to test, remote-viewer from $PATH
+# is used by default. The resident instance needs a D-Bus session bus.
+# PROBE_TIMEOUT is the --probe-timeout of each run, 30 seconds by default.
+
+VIEWER=${REMOTE_VIEWER:-remote-viewer}
+RUNS=10
+PROBE_TIMEOUT=${PROBE_TIMEOUT:-30}
+
+if test "$1" = "-n"; then
+    RUNS=$2
+    shift 2
+fi
+if test $# -ne 1; then
+    echo "Usage: $0 [-n RUNS] URI|VV-FILE" >&2
+    exit 1
+fi
+TARGET=$1
+
+trap 'test -n "$RESIDENT" && kill $RESIDENT' EXIT
+
+# startup + first-frame, from the JSON printed by --probe
+click_to_frame() {
+    sed -n 's/.*"startup": \([0-9.]*\).*"first-frame": \([0-9.]*\).*/\1 \2/p' |
+        awk '{ print $1 + $2 }'
+}
+
+summary() {
+    sort -n | awk -v name="$1" '
+        { v[NR] = $1; total += $1 }
+        END {
+            if (NR == 0) { printf "%-5s no successful run\n", name; exit }
+            printf "%-5s runs %d  min %.1f ms  median %.1f ms  avg %.1f ms  max %.1f ms\n",
+                   name, NR, v[1], v[int((NR + 1) / 2)], total / NR, v[NR]
+        }'
+}
+
+i=0
+while test $i -lt "$RUNS"; do
+    "$VIEWER" --probe --probe-timeout "$PROBE_TIMEOUT" "$TARGET" | click_to_frame
+    i=$((i + 1))
+done | summary cold
+
+"$VIEWER" --resident > /dev/null &
+RESIDENT=$!
+# only the reports of the launcher carry the uri, a cold start's don't
+tries=0
+while ! "$VIEWER" --use-launcher --probe "$TARGET" 2> /dev/null | grep -q '"uri"'; do
+    tries=$((tries + 1))
+    if test $tries -ge 50; then
+        echo "$0: the launcher didn't answer" >&2
+        exit 1
+    fi
+    sleep 0.2
+done
+
+i=0
+while test $i -lt "$RUNS"; do
+    "$VIEWER" --use-launcher --probe --probe-timeout "$PROBE_TIMEOUT" "$TARGET" | click_to_frame
+    i=$((i + 1))
+done | summary warm
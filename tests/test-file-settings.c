@@ -0,0 +1,244 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "virt-viewer-file.h"
+
+static const gchar descriptor[] =
+    "[virt-viewer]\n"
+    "type=spice\n"
+    "host=host.example.com\n"
+    "port=5900\n"
+    "tls-port=5901\n"
+    "password=ticket\n"
+    "title=Guest - Press %s to release\n"
+    "release-cursor=shift+f12\n"
+    "secure-channels=main;inputs;display;\n"
+    "enable-usbredir=1\n"
+    "color-depth=0\n"
+    "versions=rhev-win64:2.0-160;linux:1.0;\n"
+    "version=0.5\n"
+    "\n"
+    "[ovirt]\n"
+    "host=https://engine.example.com\n"
+    "admin=1\n";
+
+static VirtViewerFile *
+file_new(const gchar *data)
+{
+    GInputStream *stream = g_memory_input_stream_new_from_data(data, -1, NULL);
+    GError *error = NULL;
+    VirtViewerFile *file = virt_viewer_file_new_from_stream(stream, NULL, &error);
+
+    g_assert_no_error(error);
+    g_assert(file != NULL);
+    g_object_unref(stream);
+    return file;
+}
+
+static void
+test_file_settings(void)
+{
+    VirtViewerFile *file = file_new(descriptor);
+    const VirtViewerFileSettings *settings = virt_viewer_file_get_settings(file);
+
+    g_assert_cmpstr(settings->type, ==, "spice");
+    g_assert_cmpstr(settings->host, ==, "host.example.com");
+    g_assert_cmpint(settings->port, ==, 5900);
+    g_assert_cmpint(settings->tls_port, ==, 5901);
+    g_assert_cmpstr(settings->release_cursor, ==, "shift+f12");
+    g_assert_cmpint(g_strv_length((gchar **)settings->secure_channels), ==, 3);
+    g_assert_cmpstr(settings->secure_channels[2], ==, "display");
+    g_assert_cmpint(settings->ovirt_admin, ==, 1);
+    g_assert_cmpstr(settings->ovirt_host, ==, "https://engine.example.com");
+
+    /* unset keys and keys set to zero */
+    g_assert_null(settings->username);
+    g_assert_false(virt_viewer_file_is_set(file, "username"));
+    g_assert_cmpint(settings->color_depth, ==, 0);
+    g_assert_true(virt_viewer_file_is_set(file, "color-depth"));
+    g_assert_false(virt_viewer_file_is_set(file, "x-unknown"));
+
+    g_object_unref(file);
+}
+
+static void
+test_file_accessors(void)
+{
+    VirtViewerFile *file = file_new(descriptor);
+    GHashTable *versions;
+    gchar *str, **strv;
+    gsize length;
+    gint port;
+
+    str = virt_viewer_file_get_password(file);
+    g_assert_cmpstr(str, ==, "ticket");
+    g_free(str);
+
+    strv = virt_viewer_file_get_secure_channels(file, &length);
+    g_assert_cmpint(length, ==, 3);
+    g_assert_cmpstr(strv[0], ==, "main");
+    g_strfreev(strv);
+
+    g_object_get(file, "port", &port, "title", &str, NULL);
+    g_assert_cmpint(port, ==, 5900);
+    g_assert_cmpstr(str, ==, "Guest - Press %s to release");
+    g_free(str);
+
+    versions = virt_viewer_file_get_versions(file);
+    g_assert_cmpint(g_hash_table_size(versions), ==, 2);
+    g_assert_cmpstr(g_hash_table_lookup(versions, "linux"), ==, "1.0");
+    g_hash_table_unref(versions);
+
+    g_object_unref(file);
+}
+
+static void
+test_file_modified(void)
+{
+    VirtViewerFile *file = file_new(descriptor);
+    const VirtViewerFileSettings *settings;
+
+    virt_viewer_file_set_port(file, 5910);
+    virt_viewer_file_set_username(file, "user");
+
+    settings = virt_viewer_file_get_settings(file);
+    g_assert_cmpint(settings->port, ==, 5910);
+    g_assert_cmpstr(settings->username, ==, "user");
+    g_assert_true(virt_viewer_file_is_set(file, "username"));
+
+    g_object_unref(file);
+}
+
+/* values which cannot be used are left unset, rather than read as 0 */
+static void
+test_file_invalid(void)
+{
+    VirtViewerFile *file;
+    const VirtViewerFileSettings *settings;
+
+    g_test_expect_message(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Invalid port: *");
+    g_test_expect_message(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "Invalid render-scale: 9");
+    file = file_new("[virt-viewer]\n"
+                    "type=spice\n"
+                    "port=none\n"
+                    "tls-port=5901\n"
+                    "render-scale=9\n");
+    settings = virt_viewer_file_get_settings(file);
+    g_test_assert_expected_messages();
+
+    g_assert_false(virt_viewer_file_is_set(file, "port"));
+    g_assert_false(virt_viewer_file_is_set(file, "render-scale"));
+    g_assert_cmpint(settings->render_scale, ==, 0);
+    g_assert_true(virt_viewer_file_is_set(file, "tls-port"));
+    g_assert_cmpint(settings->tls_port, ==, 5901);
+
+    g_object_unref(file);
+}
+
+/*
+ * Only run with -m perf: parses and applies a few thousand descriptors,
+ * once reading the decoded settings, once through the copying accessors
+ * as the sessions used to.
+ */
+#define PERF_FILES 5000
+
+static void
+apply_settings(VirtViewerFile *file, gsize *sum)
+{
+    const VirtViewerFileSettings *settings = virt_viewer_file_get_settings(file);
+
+    *sum += strlen(settings->host) + strlen(settings->password) +
+        strlen(settings->title) + strlen(settings->release_cursor) +
+        settings->port + settings->tls_port + settings->enable_usbredir +
+        g_strv_length((gchar **)settings->secure_channels);
+}
+
+static void
+apply_accessors(VirtViewerFile *file, gsize *sum)
+{
+    gchar *host = virt_viewer_file_get_host(file);
+    gchar *password = virt_viewer_file_get_password(file);
+    gchar *title = virt_viewer_file_get_title(file);
+    gchar *release_cursor = virt_viewer_file_get_release_cursor(file);
+    gchar **channels = virt_viewer_file_get_secure_channels(file, NULL);
+
+    *sum += strlen(host) + strlen(password) + strlen(title) + strlen(release_cursor) +
+        virt_viewer_file_get_port(file) + virt_viewer_file_get_tls_port(file) +
+        virt_viewer_file_get_enable_usbredir(file) + g_strv_length(channels);
+
+    g_free(host);
+    g_free(password);
+    g_free(title);
+    g_free(release_cursor);
+    g_strfreev(channels);
+}
+
+static void
+test_file_perf(void)
+{
+    void (*apply[])(VirtViewerFile *, gsize *) = { apply_settings, apply_accessors };
+    const gchar *names[] = { "settings", "accessors" };
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(apply); i++) {
+        gsize sum = 0;
+
+        g_test_timer_start();
+        for (j = 0; j < PERF_FILES; j++) {
+            VirtViewerFile *file = file_new(descriptor);
+            apply[i](file, &sum);
+            g_object_unref(file);
+        }
+        g_test_minimized_result(g_test_timer_elapsed(),
+                                "%d descriptors parsed and applied through the %s: %.3f s",
+                                PERF_FILES, names[i], g_test_timer_last());
+        g_assert_cmpuint(sum, >, 0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/virt-viewer/file-settings", test_file_settings);
+    g_test_add_func("/virt-viewer/file-accessors", test_file_accessors);
+    g_test_add_func("/virt-viewer/file-modified", test_file_modified);
+    g_test_add_func("/virt-viewer/file-invalid", test_file_invalid);
+    if (g_test_perf())
+        g_test_add_func("/virt-viewer/file-perf", test_file_perf);
+
+    return g_test_run();
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -206,6 +206,52 @@ test_monitor_align_linear(void)
     test_monitor_align(virt_viewer_align_monitors_linear, test_cases, G_N_ELEMENTS(test_cases));
 }
 
+static void
+monitor_scale_by_two(GHashTable *displays)
+{
+    virt_viewer_scale_monitors(displays, 2);
+}
+
+static void
+test_monitor_scale(void)
+{
+    const GdkRectangle rects[] = {
+                                    {0, 0, 1280, 1024},
+                                    {1280, 0, 1024, 768},
+                                    {0, 0, 640, 512},
+                                    {640, 0, 512, 384},
+                                    {0, 0, 3841, 2161},
+                                    {0, 0, 1920, 1080},
+                                    {3841, 0, 1279, 1023},
+                                    {1920, 0, 640, 511},
+                                 };
+    const TestCase test_cases[] = {
+        {
+            0, {NULL}, {NULL}, 0, {NULL}
+        },{
+            1,
+            {NULL},
+            {NULL},
+            G_LOG_LEVEL_CRITICAL,
+            {"*assertion 'display != NULL' failed"}
+        },{
+            2,
+            {&rects[0], &rects[1]},
+            {&rects[2], &rects[3]},
+            0,
+            {NULL}
+        },{
+            2,
+            {&rects[4], &rects[6]},
+            {&rects[5], &rects[7]},
+            0,
+            {NULL}
+        },
+    };
+
+    test_monitor_align(monitor_scale_by_two, test_cases, G_N_ELEMENTS(test_cases));
+}
+
 int main(int argc, char* argv[])
 {
     gtk_init_check(&argc, &argv);
@@ -213,6 +259,7 @@ int main(int argc, char* argv[])
 
     g_test_add_func("/virt-viewer-util/monitor-shift", test_monitor_shift);
     g_test_add_func("/virt-viewer-util/monitor-align-linear", test_monitor_align_linear);
+    g_test_add_func("/virt-viewer-util/monitor-scale", test_monitor_scale);
 
     return g_test_run();
 }
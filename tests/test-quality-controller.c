@@ -0,0 +1,179 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <virt-viewer-util.h>
+
+gboolean doDebug = FALSE;
+
+#define BUSY (1024 * 1024)
+#define IDLE 0
+
+/* feeds @count identical samples and returns how many changed the level */
+static guint
+feed(VirtViewerQualityController *ctl, guint count, guint64 bytes_per_sec, gint rtt)
+{
+    guint changes = 0;
+
+    while (count--)
+        changes += virt_viewer_quality_controller_sample(ctl, bytes_per_sec, rtt);
+
+    return changes;
+}
+
+static void
+test_quality_level_names(void)
+{
+    VirtViewerQualityLevel level;
+
+    g_assert_cmpstr(virt_viewer_quality_level_to_string(VIRT_VIEWER_QUALITY_MEDIUM), ==, "medium");
+    g_assert_true(virt_viewer_quality_level_from_string("low", &level));
+    g_assert_cmpint(level, ==, VIRT_VIEWER_QUALITY_LOW);
+    g_assert_false(virt_viewer_quality_level_from_string("ultra", &level));
+    g_assert_false(virt_viewer_quality_level_from_string(NULL, &level));
+}
+
+static void
+test_quality_downgrade(void)
+{
+    VirtViewerQualityController ctl;
+
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* establish the base round-trip time */
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 30), ==, 0);
+
+    /* two congested samples are not enough */
+    g_assert_cmpuint(feed(&ctl, 2, BUSY, 300), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 300), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_MEDIUM);
+
+    g_assert_cmpuint(feed(&ctl, 3, BUSY, 300), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_LOW);
+
+    /* there is no level below low */
+    g_assert_cmpuint(feed(&ctl, 10, BUSY, 300), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_LOW);
+}
+
+static void
+test_quality_idle_delay(void)
+{
+    VirtViewerQualityController ctl;
+
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* a high delay is ignored while the displays are idle */
+    g_assert_cmpuint(feed(&ctl, 1, IDLE, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 10, IDLE, 300), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* as is a high but stable latency */
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_HIGH);
+    g_assert_cmpuint(feed(&ctl, 10, BUSY, 600), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* and an unknown one */
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_MEDIUM);
+    g_assert_cmpuint(feed(&ctl, 100, BUSY, -1), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_MEDIUM);
+}
+
+static void
+test_quality_hysteresis(void)
+{
+    VirtViewerQualityController ctl;
+
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_LOW);
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 30), ==, 0);
+
+    /* an intermediate delay interrupts the recovery period */
+    g_assert_cmpuint(feed(&ctl, 10, BUSY, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 80), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 10, BUSY, 30), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_LOW);
+
+    g_assert_cmpuint(feed(&ctl, 5, BUSY, 30), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_MEDIUM);
+
+    /* recovering again needs a full period */
+    g_assert_cmpuint(feed(&ctl, 14, IDLE, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 1, IDLE, 30), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* there is no level above high */
+    g_assert_cmpuint(feed(&ctl, 100, IDLE, 30), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+}
+
+static void
+test_quality_capacity(void)
+{
+    VirtViewerQualityController ctl;
+
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_HIGH);
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 3, BUSY, 300), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_MEDIUM);
+
+    /* the same activity at the next level would congest the link again */
+    g_assert_cmpuint(feed(&ctl, 20, BUSY * 3 / 4, 30), ==, 0);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_MEDIUM);
+
+    /* while a lighter one fits */
+    g_assert_cmpuint(feed(&ctl, 1, BUSY / 4, 30), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+
+    /* a link carrying more than its capacity without delay got better */
+    virt_viewer_quality_controller_init(&ctl, VIRT_VIEWER_QUALITY_HIGH);
+    g_assert_cmpuint(feed(&ctl, 1, BUSY, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 3, BUSY, 300), ==, 1);
+    g_assert_cmpuint(feed(&ctl, 14, BUSY, 30), ==, 0);
+    g_assert_cmpuint(feed(&ctl, 1, BUSY * 2, 30), ==, 1);
+    g_assert_cmpint(ctl.level, ==, VIRT_VIEWER_QUALITY_HIGH);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/virt-viewer-util/quality-level-names", test_quality_level_names);
+    g_test_add_func("/virt-viewer-util/quality-downgrade", test_quality_downgrade);
+    g_test_add_func("/virt-viewer-util/quality-idle-delay", test_quality_idle_delay);
+    g_test_add_func("/virt-viewer-util/quality-hysteresis", test_quality_hysteresis);
+    g_test_add_func("/virt-viewer-util/quality-capacity", test_quality_capacity);
+
+    return g_test_run();
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */
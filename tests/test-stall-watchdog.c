@@ -0,0 +1,105 @@
+/* -*- Mode: C; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Virt Viewer: A virtual machine console viewer
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+ *
+ * Author: agent <agent@local>
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <virt-viewer-util.h>
+
+gboolean doDebug = FALSE;
+
+static void
+test_stall_detection(void)
+{
+    VirtViewerStallWatchdog wd;
+
+    virt_viewer_stall_watchdog_init(&wd, 10000);
+
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 0));
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 4000));
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 9999));
+    g_assert_true(virt_viewer_stall_watchdog_sample(&wd, 10000));
+    g_assert_true(wd.stalled);
+    g_assert_cmpuint(wd.longest_silence, ==, 10000);
+
+    /* a stall is only reported once */
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 11000));
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 0));
+    g_assert_true(wd.stalled);
+}
+
+static void
+test_stall_hiccups(void)
+{
+    VirtViewerStallWatchdog wd;
+
+    virt_viewer_stall_watchdog_init(&wd, 10000);
+
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 6000));
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 7000));
+    g_assert_cmpuint(wd.hiccups, ==, 0);
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 100));
+    g_assert_cmpuint(wd.hiccups, ==, 1);
+
+    /* short silences are not hiccups */
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 4999));
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, 100));
+    g_assert_cmpuint(wd.hiccups, ==, 1);
+    g_assert_cmpuint(wd.longest_silence, ==, 7000);
+    g_assert_false(wd.stalled);
+}
+
+static void
+test_stall_unknown(void)
+{
+    VirtViewerStallWatchdog wd;
+
+    /* samples without a measure are ignored */
+    virt_viewer_stall_watchdog_init(&wd, 10000);
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, -1));
+    g_assert_cmpuint(wd.longest_silence, ==, 0);
+
+    /* a disabled watchdog never fires */
+    virt_viewer_stall_watchdog_init(&wd, 0);
+    g_assert_false(virt_viewer_stall_watchdog_sample(&wd, G_MAXINT));
+    g_assert_false(wd.stalled);
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/virt-viewer-util/stall-detection", test_stall_detection);
+    g_test_add_func("/virt-viewer-util/stall-hiccups", test_stall_hiccups);
+    g_test_add_func("/virt-viewer-util/stall-unknown", test_stall_unknown);
+
+    return g_test_run();
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 4
+ *  c-basic-offset: 4
+ *  indent-tabs-mode: nil
+ * End:
+ */